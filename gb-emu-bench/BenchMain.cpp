@@ -0,0 +1,131 @@
+#include <pch.hpp>
+#include <Emulator.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+/*
+    Benchmark
+
+    Runs each ROM headless for a fixed number of emulated cycles, a frame's worth at a time like the
+    front end, and reports how fast the core runs it. Each ROM is run several times and the fastest
+    run is kept, as the others only measure the noise of the machine.
+
+    The cores are compared by building the benchmark once per configuration, for example:
+        make run_bench
+        make run_bench C_FLAGS="-Wall -std=c++14 -g -O2 -pthread -DCPU_SWITCH_DISPATCH=0"
+
+    Usage: gb-emu-bench [-c cycles] [-r runs] [ROM...]
+*/
+
+#define ClockSpeed 4194304
+#define CyclesPerFrame 70224
+#define DefaultCycles (ClockSpeed * 60ULL)
+#define DefaultRuns 3
+
+static const char* DefaultROMs[] =
+{
+    "res/tests/cpu_instrs.gb",
+    "res/tests/instr_timing.gb",
+    "res/tests/mem_timing.gb",
+    "res/tests/02-interrupts.gb",
+};
+
+// Runs the ROM for the given number of cycles, returns the time taken in seconds or a negative value
+static double RunROM(const char* path, unsigned long long cycles)
+{
+    // The ROMs report their results over the serial port, keep them out of the results
+    std::streambuf* pOutput = std::cout.rdbuf(nullptr);
+
+    Emulator emulator;
+    double seconds = -1.0;
+    if (emulator.Initialize(nullptr, path))
+    {
+        auto start = std::chrono::steady_clock::now();
+
+        unsigned long long cyclesRun = 0;
+        while (cyclesRun < cycles)
+        {
+            cyclesRun += emulator.RunCycles(CyclesPerFrame);
+        }
+
+        auto end = std::chrono::steady_clock::now();
+        seconds = std::chrono::duration<double>(end - start).count();
+        emulator.Stop();
+    }
+
+    std::cout.rdbuf(pOutput);
+    std::cout.clear();
+    return seconds;
+}
+
+int main(int argc, char** argv)
+{
+    unsigned long long cycles = DefaultCycles;
+    int runs = DefaultRuns;
+    std::vector<const char*> roms;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-c") == 0 && i + 1 < argc)
+        {
+            cycles = strtoull(argv[++i], nullptr, 10);
+        }
+        else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc)
+        {
+            runs = atoi(argv[++i]);
+        }
+        else
+        {
+            roms.push_back(argv[i]);
+        }
+    }
+
+    if (roms.empty())
+    {
+        roms.assign(DefaultROMs, DefaultROMs + ARRAYSIZE(DefaultROMs));
+    }
+
+    if (cycles == 0 || runs <= 0)
+    {
+        std::cout << "Usage: gb-emu-bench [-c cycles] [-r runs] [ROM...]" << std::endl;
+        return 1;
+    }
+
+    std::cout << "----------------------------------" << std::endl;
+    std::cout << "Running " << cycles << " cycles, best of " << runs << std::endl;
+
+    int failed = 0;
+    for (const char* rom : roms)
+    {
+        double best = -1.0;
+        for (int run = 0; run < runs; run++)
+        {
+            double seconds = RunROM(rom, cycles);
+            if (seconds < 0.0)
+            {
+                break;
+            }
+
+            if (best < 0.0 || seconds < best)
+            {
+                best = seconds;
+            }
+        }
+
+        if (best < 0.0)
+        {
+            std::cout << "[FAILED] " << rom << std::endl;
+            failed++;
+            continue;
+        }
+
+        double cyclesPerSecond = cycles / best;
+        printf("%-32s %8.3f s %10.2f MHz %8.1fx\n", rom, best, cyclesPerSecond / 1000000.0, cyclesPerSecond / ClockSpeed);
+    }
+
+    std::cout << "----------------------------------" << std::endl;
+    return (failed == 0) ? 0 : 1;
+}
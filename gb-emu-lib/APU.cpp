@@ -1,78 +1,24 @@
 #include "pch.hpp"
 #include "APU.hpp"
 
-// FF10 - NR10 - Channel 1 Sweep register (R / W)
-// FF11 - NR11 - Channel 1 Sound length/Wave pattern duty (R/W)
-// FF12 - NR12 - Channel 1 Volume Envelope (R/W)
-// FF13 - NR13 - Channel 1 Frequency lo (Write Only)
-// FF14 - NR14 - Channel 1 Frequency hi (R/W)
-// FF16 - NR21 - Channel 2 Sound Length/Wave Pattern Duty (R/W)
-// FF17 - NR22 - Channel 2 Volume Envelope (R/W)
-// FF18 - NR23 - Channel 2 Frequency lo data (W)
-// FF19 - NR24 - Channel 2 Frequency hi data (R/W)
-// FF1A - NR30 - Channel 3 Sound on/off (R/W)
-// FF1B - NR31 - Channel 3 Sound Length
-// FF1C - NR32 - Channel 3 Select output level (R/W)
-// FF1D - NR33 - Channel 3 Frequency's lower data (W)
-// FF1E - NR34 - Channel 3 Frequency's higher data (R/W)
-// FF20 - NR41 - Channel 4 Sound Length (R/W)
-// FF21 - NR42 - Channel 4 Volume Envelope (R/W)
-// FF22 - NR43 - Channel 4 Polynomial Counter (R/W)
-// FF23 - NR44 - Channel 4 Counter/consecutive; Inital (R/W)
-// FF24 - NR50 - Channel control / ON-OFF / Volume (R/W)
-// FF25 - NR51 - Selection of Sound output terminal (R/W)
-// FF26 - NR52 - Sound on/off
-#define Channel1Sweep 0xFF10
-#define Channel1LengthWavePatternDuty 0xFF11
-#define Channel1VolumeEnvelope 0xFF12
-#define Channel1FrequencyLo 0xFF13
-#define Channel1FrequencyHi 0xFF14
-#define Channel2LengthWavePatternDuty 0xFF16
-#define Channel2VolumeEnvelope 0xFF17
-#define Channel2FrequnecyLo 0xFF18
-#define Channel2FrequencyHi 0xFF19
-#define Channel3OnOff 0xFF1A
-#define Channel3Length 0xFF1B
-#define Channel3OutputLevel 0xFF1C
-#define Channel3FrequencyLower 0xFF1D
-#define Channel3FrequnecyHigher 0xFF1E
-#define Channel4Length 0xFF20
-#define Channel4VolumeEnvelope 0xFF21
-#define Channel4PolynomialCounter 0xFF22
-#define Channel4Counter 0xFF23
-#define ChannelControl 0xFF24
-#define OutputTerminalSelection 0xFF25
-#define SoundOnOff 0xFF26
-
-#define CHANNEL1 0
-#define CHANNEL2 1
-#define CHANNEL3 2
-#define CHANNEL4 3
-
-void Channel1CallbackStatic(void* pUserdata, Uint8* pStream, int length)
-{
-    reinterpret_cast<APU*>(pUserdata)->Channel1Callback(
-        pStream,
-        length);
-}
+#include <algorithm>
+#include <climits>
 
-void Channel2CallbackStatic(void* pUserdata, Uint8* pStream, int length)
+// The duty cycles of channels 1 and 2, one bit per step: 12.5%, 25%, 50%, 75%
+const byte DutyCycles[]
 {
-    reinterpret_cast<APU*>(pUserdata)->Channel2Callback(
-        pStream,
-        length);
-}
+    0x01, 0x81, 0x87, 0x7E
+};
 
-void Channel3CallbackStatic(void* pUserdata, Uint8* pStream, int length)
+// Channel 3's volume shifts for its output levels: mute, 100%, 50%, 25%
+const byte WaveVolumeShifts[]
 {
-    reinterpret_cast<APU*>(pUserdata)->Channel3Callback(
-        pStream,
-        length);
-}
+    4, 0, 1, 2
+};
 
-void Channel4CallbackStatic(void* pUserdata, Uint8* pStream, int length)
+void AudioCallbackStatic(void* pUserdata, Uint8* pStream, int length)
 {
-    reinterpret_cast<APU*>(pUserdata)->Channel4Callback(
+    reinterpret_cast<APU*>(pUserdata)->AudioCallback(
         pStream,
         length);
 }
@@ -98,102 +44,165 @@ APU::APU() :
     m_Channel4Counter(0x00),
     m_ChannelControlOnOffVolume(0x00),
     m_OutputTerminal(0x00),
-    m_SoundOnOff(0x00)
+    m_SoundOnOff(0x00),
+    m_Device(0),
+    m_SweepFrequency(0),
+    m_SweepTimer(0),
+    m_IsSweepEnabled(false),
+    m_LFSR(0x7FFF),
+    m_FrameSequencerTimer(FrameSequencerCycles),
+    m_FrameSequencerStep(0),
+    m_LeftBlip(APUClockRate, AudioSampleRate, AudioBufferSamples),
+    m_RightBlip(APUClockRate, AudioSampleRate, AudioBufferSamples),
+    m_ClockTime(0),
+    m_Ring(AudioBufferSamples)
 {
-    memset(m_Initialized, false, ARRAYSIZE(m_Initialized));
-    memset(m_DeviceChannel, 0, ARRAYSIZE(m_DeviceChannel));
+    memset(m_Channels, 0, sizeof(m_Channels));
     memset(m_WavePatternRAM, 0x00, ARRAYSIZE(m_WavePatternRAM));
-
-    if (SDL_Init(SDL_INIT_AUDIO))
-    {
-        Logger::LogError("[SDL] Failed to initialize: %s", SDL_GetError());
-    }
-    else
-    {
-        LoadChannel(CHANNEL1, Channel1CallbackStatic);
-        LoadChannel(CHANNEL2, Channel2CallbackStatic);
-        LoadChannel(CHANNEL3, Channel3CallbackStatic);
-        LoadChannel(CHANNEL4, Channel4CallbackStatic);
-    }
 }
 
 APU::~APU()
 {
-    for (int index = CHANNEL1; index <= CHANNEL4; index++)
+    CloseDevice();
+}
+
+/*
+    Runs the channels from one event to the next (a step of a channel's waveform or a clock of
+    the frame sequencer) and adds each change of a channel's output to the blip buffer. The result
+    is the same however the cycles are split between calls.
+*/
+void APU::Step(unsigned long cycles)
+{
+    while (cycles > 0)
     {
-        if (m_Initialized[index])
+        unsigned long run = std::min(cycles, m_FrameSequencerTimer);
+        for (int channel = CHANNEL1; channel <= CHANNEL4; channel++)
         {
-            SDL_PauseAudioDevice(m_DeviceChannel[index], 1);
-            SDL_CloseAudioDevice(m_DeviceChannel[index]);
+            if (m_Channels[channel].isEnabled && (m_Channels[channel].timer < run))
+            {
+                run = m_Channels[channel].timer;
+            }
         }
-    }
 
-    SDL_Quit();
-}
+        cycles -= run;
+        m_ClockTime += run;
 
-void APU::Step(unsigned long cycles)
-{
-    // TODO: Create audio here based on cycles, etc.
-}
+        for (int channel = CHANNEL1; channel <= CHANNEL4; channel++)
+        {
+            if (m_Channels[channel].isEnabled)
+            {
+                m_Channels[channel].timer -= run;
+                if (m_Channels[channel].timer == 0)
+                {
+                    m_Channels[channel].timer = GetTimerPeriod(channel);
+                    ClockWaveform(channel);
+                }
+            }
+        }
 
-void APU::Channel1Callback(Uint8* pStream, int length)
-{
-    SDL_memset(pStream, 0x00, length);
+        m_FrameSequencerTimer -= run;
+        if (m_FrameSequencerTimer == 0)
+        {
+            m_FrameSequencerTimer = FrameSequencerCycles;
+            ClockFrameSequencer();
 
-    if (!ISBITSET(m_SoundOnOff, 7))
-        return;
+            // Keep the blip buffers' frames short
+            m_LeftBlip.EndFrame(m_ClockTime);
+            m_RightBlip.EndFrame(m_ClockTime);
+            m_ClockTime = 0;
+        }
+    }
+
+    m_LeftBlip.EndFrame(m_ClockTime);
+    m_RightBlip.EndFrame(m_ClockTime);
+    m_ClockTime = 0;
 
-    /*int v = 0;
-    for (int index = 0; index < length; index++)
+    if (m_Device != 0)
     {
-        pStream[index] = (Uint8)(0xFF * std::sin(v * 2 * M_PI / 44100));
-        v += 300;
-    }*/
+        QueueSamples();
+    }
 }
 
-void APU::Channel2Callback(Uint8* pStream, int length)
+/*
+    The APU raises no interrupts, it catches up over all the cycles since its last step when its
+    registers or samples are needed. Without a device only a register access or ReadSamples needs
+    them. A playing device needs them on time, so the APU tops up its ring every half a device
+    buffer of samples.
+*/
+unsigned long APU::GetCyclesUntilNextEvent()
 {
-    SDL_memset(pStream, 0x00, length);
+    if (m_Device == 0)
+    {
+        return ULONG_MAX;
+    }
 
-    if (!ISBITSET(m_SoundOnOff, 7))
-        return;
+    return static_cast<unsigned long>(((AudioDeviceSamples / 2) * static_cast<unsigned long long>(APUClockRate)) / AudioSampleRate);
+}
 
-    /*int v = 0;
-    for (int index = 0; index < length; index++)
+/*
+    Plays the mix on the default audio device, a single stereo device for all four channels. The
+    device then takes the samples, ReadSamples is left with none.
+*/
+bool APU::SetAudioOutput(bool isEnabled)
+{
+    if (isEnabled && (m_Device == 0))
+    {
+        return OpenDevice();
+    }
+    else if (!isEnabled)
     {
-        pStream[index] = (Uint8)(0xFF * std::sin(v * 2 * M_PI / 44100));
-        v += 400;
-    }*/
+        CloseDevice();
+    }
+
+    return true;
 }
 
-void APU::Channel3Callback(Uint8* pStream, int length)
+/*
+    Reads up to count stereo samples at AudioSampleRate into pSamples, left and right interleaved
+    (2 shorts per sample). Returns the number read.
+*/
+unsigned int APU::ReadSamples(short* pSamples, unsigned int count)
 {
-    SDL_memset(pStream, 0x00, length);
-
-    if (!ISBITSET(m_SoundOnOff, 7))
-        return;
+    unsigned int read = m_LeftBlip.ReadSamples(pSamples, count, 2);
+    m_RightBlip.ReadSamples(pSamples + 1, read, 2);
+    return read;
+}
 
-    /*int v = 0;
-    for (int index = 0; index < length; index++)
+// Changes the rate samples are made at by up to AudioMaxRateAdjustment, see Emulator::SetAudioRateAdjustment
+bool APU::SetSampleRateAdjustment(int samplesPerSecond)
+{
+    if ((samplesPerSecond < -AudioMaxRateAdjustment) || (samplesPerSecond > AudioMaxRateAdjustment))
     {
-        pStream[index] = (Uint8)(0xFF * std::sin(v * 2 * M_PI / 44100));
-        v += 500;
-    }*/
+        Logger::Log("APU::SetSampleRateAdjustment - Adjustment %d is beyond %d samples per second.", samplesPerSecond, AudioMaxRateAdjustment);
+        return false;
+    }
+
+    // Step always ends the blip buffers' frames, so the new rate starts cleanly
+    m_LeftBlip.SetSampleRate(AudioSampleRate + samplesPerSecond);
+    m_RightBlip.SetSampleRate(AudioSampleRate + samplesPerSecond);
+    return true;
 }
 
-void APU::Channel4Callback(Uint8* pStream, int length)
+// The number of samples waiting for the device, safe to call from any thread
+unsigned int APU::GetQueuedSamples()
 {
-    SDL_memset(pStream, 0x00, length);
+    return m_Ring.GetFillLevel();
+}
 
-    if (!ISBITSET(m_SoundOnOff, 7))
-        return;
+// The number of times the device ran out of samples and played silence, safe to call from any thread
+unsigned int APU::GetUnderrunCount()
+{
+    return m_Ring.GetUnderrunCount();
+}
 
-    /*int v = 0;
-    for (int index = 0; index < length; index++)
-    {
-        pStream[index] = (Uint8)(0xFF * std::sin(v * 2 * M_PI / 44100));
-        v += 600;
-    }*/
+/*
+    Called on SDL's audio thread to fill pStream with interleaved left and right samples. It only
+    takes them from the ring, never touching the rest of the APU, and pads with silence when the
+    emulation is behind.
+*/
+void APU::AudioCallback(Uint8* pStream, int length)
+{
+    m_Ring.Read(reinterpret_cast<short*>(pStream), length / (2 * sizeof(short)));
 }
 
 // IMemoryUnit
@@ -250,7 +259,19 @@ byte APU::ReadByte(const ushort& address)
     case OutputTerminalSelection:
         return m_OutputTerminal;
     case SoundOnOff:
-        return m_SoundOnOff;
+        {
+            // Bits 0-3 tell which channels are on
+            byte val = m_SoundOnOff;
+            for (int channel = CHANNEL1; channel <= CHANNEL4; channel++)
+            {
+                if (m_Channels[channel].isEnabled)
+                {
+                    val = SETBIT(val, channel);
+                }
+            }
+
+            return val;
+        }
     default:
         Logger::Log("APU::ReadByte cannot read from address 0x%04X", address);
         return 0x00;
@@ -265,6 +286,12 @@ bool APU::WriteByte(const ushort& address, const byte val)
         return true;
     }
 
+    // While the sound is off, only NR52 can be written to
+    if (!ISBITSET(m_SoundOnOff, 7) && (address != SoundOnOff))
+    {
+        return true;
+    }
+
     switch (address)
     {
     case Channel1Sweep:
@@ -272,33 +299,56 @@ bool APU::WriteByte(const ushort& address, const byte val)
         return true;
     case Channel1LengthWavePatternDuty:
         m_Channel1SoundLength = val;
+        m_Channels[CHANNEL1].length = 64 - (val & 0x3F);
         return true;
     case Channel1VolumeEnvelope:
         m_Channel1VolumeEnvelope = val;
+        if (!IsDACEnabled(CHANNEL1))
+        {
+            DisableChannel(CHANNEL1);
+        }
         return true;
     case Channel1FrequencyLo:
         m_Channel1FrequencyLo = val;
         return true;
     case Channel1FrequencyHi:
         m_Channel1FrequencyHi = val;
+        if (ISBITSET(val, 7))
+        {
+            TriggerChannel(CHANNEL1);
+        }
         return true;
     case Channel2LengthWavePatternDuty:
         m_Channel2SoundLength = val;
+        m_Channels[CHANNEL2].length = 64 - (val & 0x3F);
         return true;
     case Channel2VolumeEnvelope:
         m_Channel2VolumeEnvelope = val;
+        if (!IsDACEnabled(CHANNEL2))
+        {
+            DisableChannel(CHANNEL2);
+        }
         return true;
     case Channel2FrequnecyLo:
         m_Channel2FrequencyLo = val;
         return true;
     case Channel2FrequencyHi:
         m_Channel2FrequencyHi = val;
+        if (ISBITSET(val, 7))
+        {
+            TriggerChannel(CHANNEL2);
+        }
         return true;
     case Channel3OnOff:
         m_Channel3SoundOnOff = val;
+        if (!IsDACEnabled(CHANNEL3))
+        {
+            DisableChannel(CHANNEL3);
+        }
         return true;
     case Channel3Length:
         m_Channel3SoundLength = val;
+        m_Channels[CHANNEL3].length = 256 - val;
         return true;
     case Channel3OutputLevel:
         m_Channel3SelectOutputLevel = val;
@@ -308,24 +358,39 @@ bool APU::WriteByte(const ushort& address, const byte val)
         return true;
     case Channel3FrequnecyHigher:
         m_Channel3FreuqencyHi = val;
+        if (ISBITSET(val, 7))
+        {
+            TriggerChannel(CHANNEL3);
+        }
         return true;
     case Channel4Length:
         m_Channel4SoundLength = val;
+        m_Channels[CHANNEL4].length = 64 - (val & 0x3F);
         return true;
     case Channel4VolumeEnvelope:
         m_Channel4VolumeEnvelope = val;
+        if (!IsDACEnabled(CHANNEL4))
+        {
+            DisableChannel(CHANNEL4);
+        }
         return true;
     case Channel4PolynomialCounter:
         m_Channel4PolynomialCounter = val;
         return true;
     case Channel4Counter:
         m_Channel4Counter = val;
+        if (ISBITSET(val, 7))
+        {
+            TriggerChannel(CHANNEL4);
+        }
         return true;
     case ChannelControl:
         m_ChannelControlOnOffVolume = val;
+        UpdateMixer();
         return true;
     case OutputTerminalSelection:
         m_OutputTerminal = val;
+        UpdateMixer();
         return true;
     case SoundOnOff:
         /*
@@ -335,6 +400,16 @@ bool APU::WriteByte(const ushort& address, const byte val)
         Bit 1 - Sound 2 ON flag (Read Only)
         Bit 0 - Sound 1 ON flag (Read Only)
         */
+        if (ISBITSET(m_SoundOnOff, 7) && !ISBITSET(val, 7))
+        {
+            PowerOff();
+        }
+        else if (!ISBITSET(m_SoundOnOff, 7) && ISBITSET(val, 7))
+        {
+            // The frame sequencer starts over
+            m_FrameSequencerStep = 0;
+        }
+
         m_SoundOnOff = val & 0x80;
         return true;
     default:
@@ -343,28 +418,418 @@ bool APU::WriteByte(const ushort& address, const byte val)
     }
 }
 
-void APU::LoadChannel(int index, SDL_AudioCallback callback)
+// Opens the stereo device at AudioSampleRate, which starts pulling samples right away
+bool APU::OpenDevice()
 {
-    // Audio is currently disabled
-    /*
+    if (SDL_InitSubSystem(SDL_INIT_AUDIO) != 0)
+    {
+        Logger::LogError("[SDL] Failed to initialize audio: %s", SDL_GetError());
+        return false;
+    }
+
     SDL_AudioSpec want, have;
 
     SDL_memset(&want, 0, sizeof(want));
-    want.freq = 48000;
-    want.format = AUDIO_U8;
+    want.freq = AudioSampleRate;
+    want.format = AUDIO_S16SYS;
     want.channels = 2;
-    want.samples = 1024 * 2;
-    want.callback = callback;
+    want.samples = AudioDeviceSamples;
+    want.callback = AudioCallbackStatic;
     want.userdata = this;
 
-    m_DeviceChannel[index] = SDL_OpenAudioDevice(nullptr, 0, &want, &have, 0);
-    if (m_DeviceChannel[index] == 0)
+    // SDL converts the samples if the device wants another format
+    m_Device = SDL_OpenAudioDevice(nullptr, 0, &want, &have, 0);
+    if (m_Device == 0)
+    {
+        Logger::LogError("[SDL] Failed to open audio device: %s", SDL_GetError());
+        SDL_QuitSubSystem(SDL_INIT_AUDIO);
+        return false;
+    }
+
+    SDL_PauseAudioDevice(m_Device, 0);
+    return true;
+}
+
+// Moves the finished samples to the ring, those that don't fit wait in the blip buffers
+void APU::QueueSamples()
+{
+    short samples[AudioQueueChunk * 2];
+    unsigned int count = std::min(m_LeftBlip.GetSamplesAvailable(), m_Ring.GetFreeSpace());
+    while (count > 0)
+    {
+        unsigned int chunk = std::min(count, static_cast<unsigned int>(AudioQueueChunk));
+        m_LeftBlip.ReadSamples(samples, chunk, 2);
+        m_RightBlip.ReadSamples(samples + 1, chunk, 2);
+        m_Ring.Write(samples, chunk);
+        count -= chunk;
+    }
+}
+
+void APU::CloseDevice()
+{
+    if (m_Device != 0)
+    {
+        SDL_PauseAudioDevice(m_Device, 1);
+        SDL_CloseAudioDevice(m_Device);
+        SDL_QuitSubSystem(SDL_INIT_AUDIO);
+        m_Device = 0;
+    }
+}
+
+// Turning the sound off clears every register but NR52, and stops the channels
+void APU::PowerOff()
+{
+    m_Channel1Sweep = 0x00;
+    m_Channel1SoundLength = 0x00;
+    m_Channel1VolumeEnvelope = 0x00;
+    m_Channel1FrequencyLo = 0x00;
+    m_Channel1FrequencyHi = 0x00;
+    m_Channel2SoundLength = 0x00;
+    m_Channel2VolumeEnvelope = 0x00;
+    m_Channel2FrequencyLo = 0x00;
+    m_Channel2FrequencyHi = 0x00;
+    m_Channel3SoundOnOff = 0x00;
+    m_Channel3SoundLength = 0x00;
+    m_Channel3SelectOutputLevel = 0x00;
+    m_Channel3FreuqencyLo = 0x00;
+    m_Channel3FreuqencyHi = 0x00;
+    m_Channel4SoundLength = 0x00;
+    m_Channel4VolumeEnvelope = 0x00;
+    m_Channel4PolynomialCounter = 0x00;
+    m_Channel4Counter = 0x00;
+    m_ChannelControlOnOffVolume = 0x00;
+    m_OutputTerminal = 0x00;
+
+    for (int channel = CHANNEL1; channel <= CHANNEL4; channel++)
+    {
+        DisableChannel(channel);
+        m_Channels[channel].length = 0;
+    }
+}
+
+void APU::TriggerChannel(int channel)
+{
+    Channel& state = m_Channels[channel];
+    state.isEnabled = IsDACEnabled(channel);
+    state.timer = GetTimerPeriod(channel);
+    if (state.length == 0)
+    {
+        state.length = (channel == CHANNEL3) ? 256 : 64;
+    }
+
+    if (channel == CHANNEL3)
+    {
+        state.position = 0;
+    }
+    else
+    {
+        byte envelope = GetVolumeEnvelope(channel);
+        state.volume = envelope >> 4;
+        state.envelopeTimer = envelope & 0x07;
+    }
+
+    if (channel == CHANNEL4)
+    {
+        m_LFSR = 0x7FFF;
+    }
+    else if (channel == CHANNEL1)
+    {
+        // Bits 6-4 are the sweep time, bits 2-0 the sweep shift
+        byte sweepTime = (m_Channel1Sweep >> 4) & 0x07;
+        m_SweepFrequency = GetFrequency(CHANNEL1);
+        m_SweepTimer = (sweepTime != 0) ? sweepTime : 8;
+        m_IsSweepEnabled = (sweepTime != 0) || ((m_Channel1Sweep & 0x07) != 0);
+        if ((m_Channel1Sweep & 0x07) != 0)
+        {
+            // Only checks for an overflow
+            CalculateSweepFrequency();
+        }
+    }
+
+    UpdateOutput(channel);
+}
+
+void APU::DisableChannel(int channel)
+{
+    m_Channels[channel].isEnabled = false;
+    UpdateOutput(channel);
+}
+
+/*
+    The frame sequencer's 8 steps clock the lengths on steps 0, 2, 4, and 6, channel 1's sweep on
+    steps 2 and 6, and the envelopes on step 7.
+*/
+void APU::ClockFrameSequencer()
+{
+    if ((m_FrameSequencerStep % 2) == 0)
+    {
+        for (int channel = CHANNEL1; channel <= CHANNEL4; channel++)
+        {
+            ClockLength(channel);
+        }
+
+        if ((m_FrameSequencerStep % 4) == 2)
+        {
+            ClockSweep();
+        }
+    }
+    else if (m_FrameSequencerStep == 7)
+    {
+        ClockEnvelope(CHANNEL1);
+        ClockEnvelope(CHANNEL2);
+        ClockEnvelope(CHANNEL4);
+    }
+
+    m_FrameSequencerStep = (m_FrameSequencerStep + 1) % 8;
+}
+
+void APU::ClockLength(int channel)
+{
+    Channel& state = m_Channels[channel];
+    if (IsLengthEnabled(channel) && (state.length > 0))
+    {
+        state.length--;
+        if (state.length == 0)
+        {
+            DisableChannel(channel);
+        }
+    }
+}
+
+void APU::ClockEnvelope(int channel)
+{
+    Channel& state = m_Channels[channel];
+    byte envelope = GetVolumeEnvelope(channel);
+    byte period = envelope & 0x07;
+    if (!state.isEnabled || (period == 0))
     {
-        Logger::Log("[SDL] Failed to open audio device for channel %d - %s", index + 1, SDL_GetError());
         return;
     }
 
-    SDL_PauseAudioDevice(m_DeviceChannel[index], 0);
-    m_Initialized[index] = true;
-    */
+    if (state.envelopeTimer > 0)
+    {
+        state.envelopeTimer--;
+    }
+
+    if (state.envelopeTimer == 0)
+    {
+        // Bit 3 is the direction (1 = increase)
+        state.envelopeTimer = period;
+        if (ISBITSET(envelope, 3) && (state.volume < 15))
+        {
+            state.volume++;
+            UpdateOutput(channel);
+        }
+        else if (!ISBITSET(envelope, 3) && (state.volume > 0))
+        {
+            state.volume--;
+            UpdateOutput(channel);
+        }
+    }
+}
+
+void APU::ClockSweep()
+{
+    if (m_SweepTimer > 0)
+    {
+        m_SweepTimer--;
+    }
+
+    if (m_SweepTimer == 0)
+    {
+        byte sweepTime = (m_Channel1Sweep >> 4) & 0x07;
+        m_SweepTimer = (sweepTime != 0) ? sweepTime : 8;
+        if (m_IsSweepEnabled && (sweepTime != 0))
+        {
+            ushort frequency = CalculateSweepFrequency();
+            if ((frequency <= 2047) && ((m_Channel1Sweep & 0x07) != 0))
+            {
+                m_SweepFrequency = frequency;
+                m_Channel1FrequencyLo = static_cast<byte>(frequency);
+                m_Channel1FrequencyHi = (m_Channel1FrequencyHi & 0xF8) | static_cast<byte>(frequency >> 8);
+
+                // The new frequency is checked for an overflow again
+                CalculateSweepFrequency();
+            }
+        }
+    }
+}
+
+// Returns channel 1's next frequency, it stops if that is past 2047
+ushort APU::CalculateSweepFrequency()
+{
+    // Bit 3 is the direction (1 = decrease)
+    ushort delta = m_SweepFrequency >> (m_Channel1Sweep & 0x07);
+    ushort frequency = ISBITSET(m_Channel1Sweep, 3) ? m_SweepFrequency - delta : m_SweepFrequency + delta;
+    if (frequency > 2047)
+    {
+        DisableChannel(CHANNEL1);
+    }
+
+    return frequency;
+}
+
+// Moves a channel's waveform to its next step
+void APU::ClockWaveform(int channel)
+{
+    Channel& state = m_Channels[channel];
+    if (channel == CHANNEL4)
+    {
+        // Shift the XOR of the low 2 bits in from the top, bit 3 of NR43 selects the 7 bit width
+        ushort bit = (m_LFSR ^ (m_LFSR >> 1)) & 0x01;
+        m_LFSR = (m_LFSR >> 1) | (bit << 14);
+        if (ISBITSET(m_Channel4PolynomialCounter, 3))
+        {
+            m_LFSR = (m_LFSR & ~0x40) | (bit << 6);
+        }
+    }
+    else
+    {
+        state.position = (state.position + 1) % ((channel == CHANNEL3) ? 32 : 8);
+    }
+
+    UpdateOutput(channel);
+}
+
+/*
+    Adds the change of a channel's output to the blip buffers. NR51 sends each channel to the left
+    (bits 4-7) and right (bits 0-3) outputs, and NR50 sets their master volumes (bits 4-6 left, bits
+    0-2 right) from 1/8 to 8/8.
+*/
+void APU::UpdateOutput(int channel)
+{
+    Channel& state = m_Channels[channel];
+    int level = state.isEnabled ? GetDigitalOutput(channel) * (ChannelVolumeUnit / 8) : 0;
+
+    int leftAmplitude = 0;
+    if (ISBITSET(m_OutputTerminal, (channel + 4)))
+    {
+        leftAmplitude = level * (((m_ChannelControlOnOffVolume >> 4) & 0x07) + 1);
+    }
+
+    int rightAmplitude = 0;
+    if (ISBITSET(m_OutputTerminal, channel))
+    {
+        rightAmplitude = level * ((m_ChannelControlOnOffVolume & 0x07) + 1);
+    }
+
+    if (leftAmplitude != state.leftAmplitude)
+    {
+        m_LeftBlip.AddDelta(m_ClockTime, leftAmplitude - state.leftAmplitude);
+        state.leftAmplitude = leftAmplitude;
+    }
+
+    if (rightAmplitude != state.rightAmplitude)
+    {
+        m_RightBlip.AddDelta(m_ClockTime, rightAmplitude - state.rightAmplitude);
+        state.rightAmplitude = rightAmplitude;
+    }
+}
+
+// NR50 or NR51 changed, every channel's output moves to its new place in the mix
+void APU::UpdateMixer()
+{
+    for (int channel = CHANNEL1; channel <= CHANNEL4; channel++)
+    {
+        UpdateOutput(channel);
+    }
+}
+
+// A channel's DAC is on when its volume envelope is not 0 and decreasing, or NR30 turns it on
+bool APU::IsDACEnabled(int channel)
+{
+    if (channel == CHANNEL3)
+    {
+        return ISBITSET(m_Channel3SoundOnOff, 7);
+    }
+
+    return (GetVolumeEnvelope(channel) & 0xF8) != 0x00;
+}
+
+// Bit 6 of NRx4 stops the channel when its length runs out
+bool APU::IsLengthEnabled(int channel)
+{
+    switch (channel)
+    {
+    case CHANNEL1:
+        return ISBITSET(m_Channel1FrequencyHi, 6);
+    case CHANNEL2:
+        return ISBITSET(m_Channel2FrequencyHi, 6);
+    case CHANNEL3:
+        return ISBITSET(m_Channel3FreuqencyHi, 6);
+    default:
+        return ISBITSET(m_Channel4Counter, 6);
+    }
+}
+
+byte APU::GetVolumeEnvelope(int channel)
+{
+    switch (channel)
+    {
+    case CHANNEL1:
+        return m_Channel1VolumeEnvelope;
+    case CHANNEL2:
+        return m_Channel2VolumeEnvelope;
+    case CHANNEL4:
+        return m_Channel4VolumeEnvelope;
+    default:
+        return 0x00;
+    }
+}
+
+// The 11 bit frequency of channels 1-3
+ushort APU::GetFrequency(int channel)
+{
+    switch (channel)
+    {
+    case CHANNEL1:
+        return ((m_Channel1FrequencyHi & 0x07) << 8) | m_Channel1FrequencyLo;
+    case CHANNEL2:
+        return ((m_Channel2FrequencyHi & 0x07) << 8) | m_Channel2FrequencyLo;
+    default:
+        return ((m_Channel3FreuqencyHi & 0x07) << 8) | m_Channel3FreuqencyLo;
+    }
+}
+
+// Cycles between two steps of a channel's waveform
+unsigned long APU::GetTimerPeriod(int channel)
+{
+    switch (channel)
+    {
+    case CHANNEL1:
+    case CHANNEL2:
+        return (2048 - GetFrequency(channel)) * 4;
+    case CHANNEL3:
+        return (2048 - GetFrequency(channel)) * 2;
+    default:
+        {
+            // Bits 7-4 are the shift clock frequency, bits 2-0 the dividing ratio
+            byte ratio = m_Channel4PolynomialCounter & 0x07;
+            unsigned long divisor = (ratio == 0) ? 8 : ratio * 16;
+            return divisor << (m_Channel4PolynomialCounter >> 4);
+        }
+    }
+}
+
+// The 0-15 level of a channel's waveform at its current step
+byte APU::GetDigitalOutput(int channel)
+{
+    Channel& state = m_Channels[channel];
+    byte dutyBit = 7 - state.position;
+    switch (channel)
+    {
+    case CHANNEL1:
+        return ISBITSET(DutyCycles[m_Channel1SoundLength >> 6], dutyBit) ? state.volume : 0;
+    case CHANNEL2:
+        return ISBITSET(DutyCycles[m_Channel2SoundLength >> 6], dutyBit) ? state.volume : 0;
+    case CHANNEL3:
+        {
+            // Two 4 bit samples per byte, the upper one first
+            byte sample = m_WavePatternRAM[state.position / 2];
+            sample = ((state.position % 2) == 0) ? (sample >> 4) : (sample & 0x0F);
+            return sample >> WaveVolumeShifts[(m_Channel3SelectOutputLevel >> 5) & 0x03];
+        }
+    default:
+        return ((m_LFSR & 0x01) == 0) ? state.volume : 0;
+    }
 }
@@ -6,29 +6,109 @@
     #include "SDL2/SDL.h"
 #endif
 
-class APU : public IMemoryUnit
+#include "BlipBuffer.hpp"
+#include "SampleRing.hpp"
+
+// FF10 - NR10 - Channel 1 Sweep register (R / W)
+// FF11 - NR11 - Channel 1 Sound length/Wave pattern duty (R/W)
+// FF12 - NR12 - Channel 1 Volume Envelope (R/W)
+// FF13 - NR13 - Channel 1 Frequency lo (Write Only)
+// FF14 - NR14 - Channel 1 Frequency hi (R/W)
+// FF16 - NR21 - Channel 2 Sound Length/Wave Pattern Duty (R/W)
+// FF17 - NR22 - Channel 2 Volume Envelope (R/W)
+// FF18 - NR23 - Channel 2 Frequency lo data (W)
+// FF19 - NR24 - Channel 2 Frequency hi data (R/W)
+// FF1A - NR30 - Channel 3 Sound on/off (R/W)
+// FF1B - NR31 - Channel 3 Sound Length
+// FF1C - NR32 - Channel 3 Select output level (R/W)
+// FF1D - NR33 - Channel 3 Frequency's lower data (W)
+// FF1E - NR34 - Channel 3 Frequency's higher data (R/W)
+// FF20 - NR41 - Channel 4 Sound Length (R/W)
+// FF21 - NR42 - Channel 4 Volume Envelope (R/W)
+// FF22 - NR43 - Channel 4 Polynomial Counter (R/W)
+// FF23 - NR44 - Channel 4 Counter/consecutive; Inital (R/W)
+// FF24 - NR50 - Channel control / ON-OFF / Volume (R/W)
+// FF25 - NR51 - Selection of Sound output terminal (R/W)
+// FF26 - NR52 - Sound on/off
+#define Channel1Sweep 0xFF10
+#define Channel1LengthWavePatternDuty 0xFF11
+#define Channel1VolumeEnvelope 0xFF12
+#define Channel1FrequencyLo 0xFF13
+#define Channel1FrequencyHi 0xFF14
+#define Channel2LengthWavePatternDuty 0xFF16
+#define Channel2VolumeEnvelope 0xFF17
+#define Channel2FrequnecyLo 0xFF18
+#define Channel2FrequencyHi 0xFF19
+#define Channel3OnOff 0xFF1A
+#define Channel3Length 0xFF1B
+#define Channel3OutputLevel 0xFF1C
+#define Channel3FrequencyLower 0xFF1D
+#define Channel3FrequnecyHigher 0xFF1E
+#define Channel4Length 0xFF20
+#define Channel4VolumeEnvelope 0xFF21
+#define Channel4PolynomialCounter 0xFF22
+#define Channel4Counter 0xFF23
+#define ChannelControl 0xFF24
+#define OutputTerminalSelection 0xFF25
+#define SoundOnOff 0xFF26
+
+#define CHANNEL1 0
+#define CHANNEL2 1
+#define CHANNEL3 2
+#define CHANNEL4 3
+
+#define APUClockRate 4194304
+#define FrameSequencerCycles 8192       // The frame sequencer clocks the lengths, sweep, and envelopes at 512Hz
+#define ChannelVolumeUnit 512           // Output level of a channel per step of its 0-15 volume, at full master volume
+#define AudioBufferSamples (AudioSampleRate / 10)   // Samples kept waiting to be read
+#define AudioQueueChunk 256             // Samples moved from the blip buffers to the device's ring at a time
+#define AudioDeviceSamples 1024         // Samples the device asks for at a time
+
+class APU : public IMemoryUnit, public IScheduledUnit
 {
 public:
     APU();
     ~APU();
 
+    void AudioCallback(Uint8* pStream, int length);
+
+    bool SetAudioOutput(bool isEnabled);
+    unsigned int ReadSamples(short* pSamples, unsigned int count);
+    unsigned int GetQueuedSamples();
+    unsigned int GetUnderrunCount();
+    bool SetSampleRateAdjustment(int samplesPerSecond);
+
+    // IScheduledUnit
     void Step(unsigned long cycles);
-    void Channel1Callback(Uint8* pStream, int length);
-    void Channel2Callback(Uint8* pStream, int length);
-    void Channel3Callback(Uint8* pStream, int length);
-    void Channel4Callback(Uint8* pStream, int length);
+    unsigned long GetCyclesUntilNextEvent();
 
     // IMemoryUnit
     byte ReadByte(const ushort& address);
     bool WriteByte(const ushort& address, const byte val);
 
 private:
-    void LoadChannel(int index, SDL_AudioCallback callback);
+    bool OpenDevice();
+    void CloseDevice();
+    void QueueSamples();
+    void PowerOff();
+    void TriggerChannel(int channel);
+    void DisableChannel(int channel);
+    void ClockFrameSequencer();
+    void ClockLength(int channel);
+    void ClockEnvelope(int channel);
+    void ClockSweep();
+    ushort CalculateSweepFrequency();
+    void ClockWaveform(int channel);
+    void UpdateOutput(int channel);
+    void UpdateMixer();
+    bool IsDACEnabled(int channel);
+    bool IsLengthEnabled(int channel);
+    byte GetVolumeEnvelope(int channel);
+    ushort GetFrequency(int channel);
+    unsigned long GetTimerPeriod(int channel);
+    byte GetDigitalOutput(int channel);
 
 private:
-    bool m_Initialized[4];
-    SDL_AudioDeviceID m_DeviceChannel[4];
-
     byte m_Channel1Sweep;
     byte m_Channel1SoundLength;
     byte m_Channel1VolumeEnvelope;
@@ -56,4 +136,32 @@ private:
     byte m_OutputTerminal;
 
     byte m_SoundOnOff;
+
+    SDL_AudioDeviceID m_Device;     // The one stereo device playing the mix, 0 when there is none
+
+    // What a channel is doing, the registers hold its settings
+    struct Channel
+    {
+        bool isEnabled;         // Triggered, and not stopped by its length, sweep, or DAC since
+        int length;             // Length clocks left before the channel stops
+        unsigned long timer;    // Cycles until the next step of the waveform
+        byte position;          // The step of the waveform: duty cycle step or wave sample
+        byte volume;            // 0-15, set by the envelope
+        byte envelopeTimer;     // Envelope clocks until the volume changes
+        int leftAmplitude;      // The output levels last added to the blip buffers
+        int rightAmplitude;
+    };
+
+    Channel m_Channels[4];
+    ushort m_SweepFrequency;    // Channel 1's frequency as the sweep sees it
+    byte m_SweepTimer;
+    bool m_IsSweepEnabled;
+    ushort m_LFSR;              // Channel 4's linear feedback shift register
+    unsigned long m_FrameSequencerTimer;
+    byte m_FrameSequencerStep;
+
+    BlipBuffer m_LeftBlip;
+    BlipBuffer m_RightBlip;
+    unsigned long m_ClockTime;  // Cycles since the start of the blip buffers' frame
+    SampleRing m_Ring;          // The samples on their way to the device
 };
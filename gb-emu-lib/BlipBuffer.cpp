@@ -0,0 +1,176 @@
+#include "pch.hpp"
+#include "BlipBuffer.hpp"
+
+#include <climits>
+#include <cmath>
+
+#define PI 3.14159265358979323846
+
+// One kernel per phase, each holding the band-limited step's share of BlipKernelWidth samples
+static short BlipKernels[BlipPhaseCount][BlipKernelWidth];
+
+/*
+    Builds the kernels: a Blackman windowed sinc with its cutoff just below the output Nyquist
+    frequency, centered between taps BlipKernelWidth / 2 - 1 and BlipKernelWidth / 2 and shifted
+    right by the phase. Each kernel's rounding error is put on its largest tap, so every step adds
+    exactly its delta.
+*/
+static bool BuildBlipKernels()
+{
+    const double cutoff = 0.95;
+    for (int phase = 0; phase < BlipPhaseCount; phase++)
+    {
+        double taps[BlipKernelWidth];
+        double sum = 0.0;
+        for (int tap = 0; tap < BlipKernelWidth; tap++)
+        {
+            double x = tap - ((BlipKernelWidth / 2) - 1) - (static_cast<double>(phase) / BlipPhaseCount) - 0.5;
+            double sinc = (x == 0.0) ? 1.0 : std::sin(PI * cutoff * x) / (PI * cutoff * x);
+            double position = (x + (BlipKernelWidth / 2)) / BlipKernelWidth;
+            double window = 0.42 - (0.5 * std::cos(2 * PI * position)) + (0.08 * std::cos(4 * PI * position));
+            taps[tap] = sinc * window;
+            sum += taps[tap];
+        }
+
+        int total = 0;
+        int largest = 0;
+        for (int tap = 0; tap < BlipKernelWidth; tap++)
+        {
+            BlipKernels[phase][tap] = static_cast<short>(std::lround(taps[tap] * (1 << BlipKernelBits) / sum));
+            total += BlipKernels[phase][tap];
+            if (BlipKernels[phase][tap] > BlipKernels[phase][largest])
+            {
+                largest = tap;
+            }
+        }
+
+        BlipKernels[phase][largest] += static_cast<short>((1 << BlipKernelBits) - total);
+    }
+
+    return true;
+}
+
+/*
+    capacity is the number of samples kept waiting to be read, older ones are dropped. A frame must
+    not be longer than capacity samples.
+*/
+BlipBuffer::BlipBuffer(unsigned int clockRate, unsigned int sampleRate, unsigned int capacity) :
+    m_clockRate(clockRate),
+    m_factor((static_cast<unsigned long long>(sampleRate) << BlipFractionBits) / clockRate),
+    m_offset(0),
+    m_capacity(capacity),
+    m_deltas((capacity * 2) + BlipKernelWidth, 0),
+    m_integrator(0)
+{
+    // Built once, by the first buffer
+    static const bool isBuilt = BuildBlipKernels();
+    (void)isBuilt;
+}
+
+BlipBuffer::~BlipBuffer()
+{
+}
+
+/*
+    Changes the number of samples made per second of clocks, from the next frame on. Only call it
+    between frames, the deltas of the current frame were placed with the old rate.
+*/
+void BlipBuffer::SetSampleRate(unsigned int sampleRate)
+{
+    m_factor = (static_cast<unsigned long long>(sampleRate) << BlipFractionBits) / m_clockRate;
+}
+
+// Adds a step of delta to the output, clockTime clocks after the start of the frame
+void BlipBuffer::AddDelta(unsigned long clockTime, int delta)
+{
+    unsigned long long position = m_offset + (clockTime * m_factor);
+    unsigned int sample = static_cast<unsigned int>(position >> BlipFractionBits);
+    int phase = static_cast<int>(position >> (BlipFractionBits - BlipPhaseBits)) & (BlipPhaseCount - 1);
+
+    int* pDeltas = m_deltas.data() + sample;
+    const short* pKernel = BlipKernels[phase];
+    for (int tap = 0; tap < BlipKernelWidth; tap++)
+    {
+        pDeltas[tap] += pKernel[tap] * delta;
+    }
+}
+
+// Ends the frame after clockDuration clocks, its samples can then be read
+void BlipBuffer::EndFrame(unsigned long clockDuration)
+{
+    m_offset += clockDuration * m_factor;
+
+    unsigned int available = GetSamplesAvailable();
+    if (available > m_capacity)
+    {
+        // Nobody is reading, drop the oldest samples
+        ReadSamples(nullptr, available - m_capacity, 1);
+    }
+}
+
+unsigned int BlipBuffer::GetSamplesAvailable()
+{
+    return static_cast<unsigned int>(m_offset >> BlipFractionBits);
+}
+
+/*
+    Reads up to count samples stride shorts apart, so a stereo pair of buffers can fill every other
+    short, or drops them if pSamples is nullptr. Returns the number read.
+*/
+unsigned int BlipBuffer::ReadSamples(short* pSamples, unsigned int count, unsigned int stride)
+{
+    unsigned int available = GetSamplesAvailable();
+    if (count > available)
+    {
+        count = available;
+    }
+
+    int integrator = m_integrator;
+    for (unsigned int index = 0; index < count; index++)
+    {
+        int sample = integrator >> BlipKernelBits;
+        if (sample > SHRT_MAX)
+        {
+            sample = SHRT_MAX;
+        }
+        else if (sample < SHRT_MIN)
+        {
+            sample = SHRT_MIN;
+        }
+
+        if (pSamples != nullptr)
+        {
+            pSamples[index * stride] = static_cast<short>(sample);
+        }
+
+        integrator += m_deltas[index];
+
+        // Slowly pull the sum back to 0, a high-pass filter removing the DC offset
+        integrator -= sample << (BlipKernelBits - BlipBassShift);
+    }
+
+    m_integrator = integrator;
+    RemoveSamples(count);
+    return count;
+}
+
+void BlipBuffer::Clear()
+{
+    m_offset = 0;
+    m_integrator = 0;
+    std::fill(m_deltas.begin(), m_deltas.end(), 0);
+}
+
+void BlipBuffer::RemoveSamples(unsigned int count)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    // Keep the samples still waiting, and the kernel tails past them
+    unsigned int remaining = GetSamplesAvailable() - count + BlipKernelWidth;
+    memmove(m_deltas.data(), m_deltas.data() + count, remaining * sizeof(int));
+    memset(m_deltas.data() + remaining, 0, count * sizeof(int));
+    m_offset -= static_cast<unsigned long long>(count) << BlipFractionBits;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <vector>
+
+/*
+    BlipBuffer
+
+    Band-limited step synthesis. The APU's channels only change their output on clock edges, so
+    instead of sampling them at the 4MHz clock, each change is added as a step: a delta at a clock
+    time. The step is spread over BlipKernelWidth output samples by a windowed sinc, which keeps
+    it free of aliasing, and the output samples are the running sum of those deltas. Only output
+    rate samples are ever produced.
+
+    The clock time of a delta is relative to the start of the current frame, EndFrame moves the
+    start forward. The samples are the same however the clocks are split into frames.
+*/
+#define BlipPhaseBits       5       // 32 kernels, for steps between two output samples
+#define BlipPhaseCount      (1 << BlipPhaseBits)
+#define BlipKernelWidth     16      // Output samples a step is spread over
+#define BlipKernelBits      15      // The kernel sums to 1 << BlipKernelBits
+#define BlipFractionBits    32      // Fraction of the output sample positions
+#define BlipBassShift       9       // Cutoff of the high-pass filter removing the DC offset
+
+class BlipBuffer
+{
+public:
+    BlipBuffer(unsigned int clockRate, unsigned int sampleRate, unsigned int capacity);
+    ~BlipBuffer();
+
+    void SetSampleRate(unsigned int sampleRate);
+    void AddDelta(unsigned long clockTime, int delta);
+    void EndFrame(unsigned long clockDuration);
+    unsigned int GetSamplesAvailable();
+    unsigned int ReadSamples(short* pSamples, unsigned int count, unsigned int stride);
+    void Clear();
+
+private:
+    void RemoveSamples(unsigned int count);
+
+private:
+    unsigned int m_clockRate;
+    unsigned long long m_factor;    // Output samples per clock, with BlipFractionBits of fraction
+    unsigned long long m_offset;    // The position of the frame start in output samples, with fraction
+    unsigned int m_capacity;
+    std::vector<int> m_deltas;
+    int m_integrator;
+};
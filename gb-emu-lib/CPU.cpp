@@ -1,612 +1,679 @@
 #include "pch.hpp"
 #include "CPU.hpp"
 
-#include <vector>
+#include <algorithm>
 
-CPU::CPU() :
-    m_cycles(0),
-    m_isHalted(false),
-    m_AF(0x0000),
-    m_BC(0x0000),
-    m_DE(0x0000),
-    m_HL(0x0000),
-    m_SP(0x0000),
-    m_PC(0x0000),
-    m_IME(0x00)
-{
-    for (unsigned int index = 0; index < ARRAYSIZE(m_operationMap); index++)
-    {
-        m_operationMap[index] = nullptr;
-    }
-    for (unsigned int index = 0; index < ARRAYSIZE(m_operationMapCB); index++)
-    {
-        m_operationMapCB[index] = nullptr;
-    }
+#if WINDOWS
+#include <intrin.h>
+#endif
 
-    /*
-        Z80 Command Set
-    */
+// Longest run of instructions decoded into a single block
+#define MaxBlockInstructions 32
 
+// Number of runs before a block of ROM code is compiled by the JIT
+#define JITThreshold 16
+
+// Most cycles a halted CPU skips at once, one scanline
+#define MaxHaltCycles 456
+
+// Length of a frame while the LCD is off, so the front end is still paced
+#define CyclesPerFrame 70224
+
+// Longest polling loop recognized by the idle loop detector
+#define MaxIdleLoopInstructions 4
+
+// ALU operations recorded for lazy flag evaluation
+#define LazyFlagsNone   0   // F is up to date
+#define LazyFlagsAdd    1   // ADD, ADC
+#define LazyFlagsSub    2   // SUB, SBC, CP
+#define LazyFlagsAnd    3   // AND
+#define LazyFlagsOr     4   // OR, XOR
+
+/*
+    Instruction lengths in bytes, as consumed by the handlers (STOP does not read its operand).
+    The CB prefixed instructions are all 2 bytes long.
+*/
+const byte InstructionLengths[] =
+{
+    1,3,1,1,1,1,2,1,3,1,1,1,1,1,2,1,
+    1,3,1,1,1,1,2,1,2,1,1,1,1,1,2,1,
+    2,3,1,1,1,1,2,1,2,1,1,1,1,1,2,1,
+    2,3,1,1,1,1,2,1,2,1,1,1,1,1,2,1,
+    1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
+    1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
+    1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
+    1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
+    1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
+    1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
+    1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
+    1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
+    1,1,3,3,3,1,2,1,1,1,3,2,3,3,2,1,
+    1,1,3,1,3,1,2,1,1,1,3,1,3,1,2,1,
+    2,1,1,1,1,1,2,1,2,1,3,1,1,1,2,1,
+    2,1,1,1,1,1,2,1,2,1,3,1,1,1,2,1
+};
+
+/*
+    OpCode Function Maps
+
+    Both maps are built at compile time. The handlers that work on registers, conditions, or bits
+    are specialized for each OpCode, with the register indices as template parameters, so they do
+    not decode the OpCode or go through the register maps when they run.
+*/
+
+/*
+    Z80 Command Set
+*/
+const CPU::opCodeFunction CPU::m_operationMap[] =
+{
     // 00
-    m_operationMap[0x00] = &CPU::NOP;
-    m_operationMap[0x01] = &CPU::LDrrnn;
-    m_operationMap[0x02] = &CPU::LD_BC_A;
-    m_operationMap[0x03] = &CPU::INCrr;
-    m_operationMap[0x04] = &CPU::INCr;
-    m_operationMap[0x05] = &CPU::DECr;
-    m_operationMap[0x06] = &CPU::LDrn;
-    m_operationMap[0x07] = &CPU::RLCA;
-    m_operationMap[0x08] = &CPU::LD_nn_SP;
-    m_operationMap[0x09] = &CPU::ADDHLss;
-    m_operationMap[0x0A] = &CPU::LDA_BC_;
-    m_operationMap[0x0B] = &CPU::DECrr;
-    m_operationMap[0x0C] = &CPU::INCr;
-    m_operationMap[0x0D] = &CPU::DECr;
-    m_operationMap[0x0E] = &CPU::LDrn;
-    m_operationMap[0x0F] = &CPU::RRCA;
+    &CPU::NOP,                  // 0x00
+    &CPU::LDrrnn<0>,            // 0x01
+    &CPU::LD_BC_A,              // 0x02
+    &CPU::INCrr<0>,             // 0x03
+    &CPU::INCr<0>,              // 0x04
+    &CPU::DECr<0>,              // 0x05
+    &CPU::LDrn<0>,              // 0x06
+    &CPU::RLCA,                 // 0x07
+    &CPU::LD_nn_SP,             // 0x08
+    &CPU::ADDHLss<0>,           // 0x09
+    &CPU::LDA_BC_,              // 0x0A
+    &CPU::DECrr<0>,             // 0x0B
+    &CPU::INCr<1>,              // 0x0C
+    &CPU::DECr<1>,              // 0x0D
+    &CPU::LDrn<1>,              // 0x0E
+    &CPU::RRCA,                 // 0x0F
 
     // 10
-    m_operationMap[0x10] = &CPU::STOP;
-    m_operationMap[0x11] = &CPU::LDrrnn;
-    m_operationMap[0x12] = &CPU::LD_DE_A;
-    m_operationMap[0x13] = &CPU::INCrr;
-    m_operationMap[0x14] = &CPU::INCr;
-    m_operationMap[0x15] = &CPU::DECr;
-    m_operationMap[0x16] = &CPU::LDrn;
-    m_operationMap[0x17] = &CPU::RLA;
-    m_operationMap[0x18] = &CPU::JRe;
-    m_operationMap[0x19] = &CPU::ADDHLss;
-    m_operationMap[0x1A] = &CPU::LDA_DE_;
-    m_operationMap[0x1B] = &CPU::DECrr;
-    m_operationMap[0x1C] = &CPU::INCr;
-    m_operationMap[0x1D] = &CPU::DECr;
-    m_operationMap[0x1E] = &CPU::LDrn;
-    m_operationMap[0x1F] = &CPU::RRA;
+    &CPU::STOP,                 // 0x10
+    &CPU::LDrrnn<1>,            // 0x11
+    &CPU::LD_DE_A,              // 0x12
+    &CPU::INCrr<1>,             // 0x13
+    &CPU::INCr<2>,              // 0x14
+    &CPU::DECr<2>,              // 0x15
+    &CPU::LDrn<2>,              // 0x16
+    &CPU::RLA,                  // 0x17
+    &CPU::JRe,                  // 0x18
+    &CPU::ADDHLss<1>,           // 0x19
+    &CPU::LDA_DE_,              // 0x1A
+    &CPU::DECrr<1>,             // 0x1B
+    &CPU::INCr<3>,              // 0x1C
+    &CPU::DECr<3>,              // 0x1D
+    &CPU::LDrn<3>,              // 0x1E
+    &CPU::RRA,                  // 0x1F
 
     // 20
-    m_operationMap[0x20] = &CPU::JRcce;
-    m_operationMap[0x21] = &CPU::LDrrnn;
-    m_operationMap[0x22] = &CPU::LDI_HL_A;
-    m_operationMap[0x23] = &CPU::INCrr;
-    m_operationMap[0x24] = &CPU::INCr;
-    m_operationMap[0x25] = &CPU::DECr;
-    m_operationMap[0x26] = &CPU::LDrn;
-    m_operationMap[0x27] = &CPU::DAA;
-    m_operationMap[0x28] = &CPU::JRcce;
-    m_operationMap[0x29] = &CPU::ADDHLss;
-    m_operationMap[0x2A] = &CPU::LDIA_HL_;
-    m_operationMap[0x2B] = &CPU::DECrr;
-    m_operationMap[0x2C] = &CPU::INCr;
-    m_operationMap[0x2D] = &CPU::DECr;
-    m_operationMap[0x2E] = &CPU::LDrn;
-    m_operationMap[0x2F] = &CPU::CPL;
+    &CPU::JRcce<0>,             // 0x20
+    &CPU::LDrrnn<2>,            // 0x21
+    &CPU::LDI_HL_A,             // 0x22
+    &CPU::INCrr<2>,             // 0x23
+    &CPU::INCr<4>,              // 0x24
+    &CPU::DECr<4>,              // 0x25
+    &CPU::LDrn<4>,              // 0x26
+    &CPU::DAA,                  // 0x27
+    &CPU::JRcce<1>,             // 0x28
+    &CPU::ADDHLss<2>,           // 0x29
+    &CPU::LDIA_HL_,             // 0x2A
+    &CPU::DECrr<2>,             // 0x2B
+    &CPU::INCr<5>,              // 0x2C
+    &CPU::DECr<5>,              // 0x2D
+    &CPU::LDrn<5>,              // 0x2E
+    &CPU::CPL,                  // 0x2F
 
     // 30
-    m_operationMap[0x30] = &CPU::JRcce;
-    m_operationMap[0x31] = &CPU::LDrrnn;
-    m_operationMap[0x32] = &CPU::LDD_HL_A;
-    m_operationMap[0x33] = &CPU::INCrr;
-    m_operationMap[0x34] = &CPU::INC_HL_;
-    m_operationMap[0x35] = &CPU::DEC_HL_;
-    m_operationMap[0x36] = &CPU::LD_HL_n;
-    m_operationMap[0x37] = &CPU::SCF;
-    m_operationMap[0x38] = &CPU::JRcce;
-    m_operationMap[0x39] = &CPU::ADDHLss;
-    m_operationMap[0x3A] = &CPU::LDDA_HL_;
-    m_operationMap[0x3B] = &CPU::DECrr;
-    m_operationMap[0x3C] = &CPU::INCr;
-    m_operationMap[0x3D] = &CPU::DECr;
-    m_operationMap[0x3E] = &CPU::LDrn;
-    m_operationMap[0x3F] = &CPU::CCF;
+    &CPU::JRcce<2>,             // 0x30
+    &CPU::LDrrnn<3>,            // 0x31
+    &CPU::LDD_HL_A,             // 0x32
+    &CPU::INCrr<3>,             // 0x33
+    &CPU::INC_HL_,              // 0x34
+    &CPU::DEC_HL_,              // 0x35
+    &CPU::LD_HL_n,              // 0x36
+    &CPU::SCF,                  // 0x37
+    &CPU::JRcce<3>,             // 0x38
+    &CPU::ADDHLss<3>,           // 0x39
+    &CPU::LDDA_HL_,             // 0x3A
+    &CPU::DECrr<3>,             // 0x3B
+    &CPU::INCr<7>,              // 0x3C
+    &CPU::DECr<7>,              // 0x3D
+    &CPU::LDrn<7>,              // 0x3E
+    &CPU::CCF,                  // 0x3F
 
     // 40
-    m_operationMap[0x40] = &CPU::LDrR;
-    m_operationMap[0x41] = &CPU::LDrR;
-    m_operationMap[0x42] = &CPU::LDrR;
-    m_operationMap[0x43] = &CPU::LDrR;
-    m_operationMap[0x44] = &CPU::LDrR;
-    m_operationMap[0x45] = &CPU::LDrR;
-    m_operationMap[0x46] = &CPU::LDr_HL_;
-    m_operationMap[0x47] = &CPU::LDrR;
-    m_operationMap[0x48] = &CPU::LDrR;
-    m_operationMap[0x49] = &CPU::LDrR;
-    m_operationMap[0x4A] = &CPU::LDrR;
-    m_operationMap[0x4B] = &CPU::LDrR;
-    m_operationMap[0x4C] = &CPU::LDrR;
-    m_operationMap[0x4D] = &CPU::LDrR;
-    m_operationMap[0x4E] = &CPU::LDr_HL_;
-    m_operationMap[0x4F] = &CPU::LDrR;
+    &CPU::LDrR<0, 0>,           // 0x40
+    &CPU::LDrR<0, 1>,           // 0x41
+    &CPU::LDrR<0, 2>,           // 0x42
+    &CPU::LDrR<0, 3>,           // 0x43
+    &CPU::LDrR<0, 4>,           // 0x44
+    &CPU::LDrR<0, 5>,           // 0x45
+    &CPU::LDr_HL_<0>,           // 0x46
+    &CPU::LDrR<0, 7>,           // 0x47
+    &CPU::LDrR<1, 0>,           // 0x48
+    &CPU::LDrR<1, 1>,           // 0x49
+    &CPU::LDrR<1, 2>,           // 0x4A
+    &CPU::LDrR<1, 3>,           // 0x4B
+    &CPU::LDrR<1, 4>,           // 0x4C
+    &CPU::LDrR<1, 5>,           // 0x4D
+    &CPU::LDr_HL_<1>,           // 0x4E
+    &CPU::LDrR<1, 7>,           // 0x4F
 
     // 50
-    m_operationMap[0x50] = &CPU::LDrR;
-    m_operationMap[0x51] = &CPU::LDrR;
-    m_operationMap[0x52] = &CPU::LDrR;
-    m_operationMap[0x53] = &CPU::LDrR;
-    m_operationMap[0x54] = &CPU::LDrR;
-    m_operationMap[0x55] = &CPU::LDrR;
-    m_operationMap[0x56] = &CPU::LDr_HL_;
-    m_operationMap[0x57] = &CPU::LDrR;
-    m_operationMap[0x58] = &CPU::LDrR;
-    m_operationMap[0x59] = &CPU::LDrR;
-    m_operationMap[0x5A] = &CPU::LDrR;
-    m_operationMap[0x5B] = &CPU::LDrR;
-    m_operationMap[0x5C] = &CPU::LDrR;
-    m_operationMap[0x5D] = &CPU::LDrR;
-    m_operationMap[0x5E] = &CPU::LDr_HL_;
-    m_operationMap[0x5F] = &CPU::LDrR;
+    &CPU::LDrR<2, 0>,           // 0x50
+    &CPU::LDrR<2, 1>,           // 0x51
+    &CPU::LDrR<2, 2>,           // 0x52
+    &CPU::LDrR<2, 3>,           // 0x53
+    &CPU::LDrR<2, 4>,           // 0x54
+    &CPU::LDrR<2, 5>,           // 0x55
+    &CPU::LDr_HL_<2>,           // 0x56
+    &CPU::LDrR<2, 7>,           // 0x57
+    &CPU::LDrR<3, 0>,           // 0x58
+    &CPU::LDrR<3, 1>,           // 0x59
+    &CPU::LDrR<3, 2>,           // 0x5A
+    &CPU::LDrR<3, 3>,           // 0x5B
+    &CPU::LDrR<3, 4>,           // 0x5C
+    &CPU::LDrR<3, 5>,           // 0x5D
+    &CPU::LDr_HL_<3>,           // 0x5E
+    &CPU::LDrR<3, 7>,           // 0x5F
 
     // 60
-    m_operationMap[0x60] = &CPU::LDrR;
-    m_operationMap[0x61] = &CPU::LDrR;
-    m_operationMap[0x62] = &CPU::LDrR;
-    m_operationMap[0x63] = &CPU::LDrR;
-    m_operationMap[0x64] = &CPU::LDrR;
-    m_operationMap[0x65] = &CPU::LDrR;
-    m_operationMap[0x66] = &CPU::LDr_HL_;
-    m_operationMap[0x67] = &CPU::LDrR;
-    m_operationMap[0x68] = &CPU::LDrR;
-    m_operationMap[0x69] = &CPU::LDrR;
-    m_operationMap[0x6A] = &CPU::LDrR;
-    m_operationMap[0x6B] = &CPU::LDrR;
-    m_operationMap[0x6C] = &CPU::LDrR;
-    m_operationMap[0x6D] = &CPU::LDrR;
-    m_operationMap[0x6E] = &CPU::LDr_HL_;
-    m_operationMap[0x6F] = &CPU::LDrR;
+    &CPU::LDrR<4, 0>,           // 0x60
+    &CPU::LDrR<4, 1>,           // 0x61
+    &CPU::LDrR<4, 2>,           // 0x62
+    &CPU::LDrR<4, 3>,           // 0x63
+    &CPU::LDrR<4, 4>,           // 0x64
+    &CPU::LDrR<4, 5>,           // 0x65
+    &CPU::LDr_HL_<4>,           // 0x66
+    &CPU::LDrR<4, 7>,           // 0x67
+    &CPU::LDrR<5, 0>,           // 0x68
+    &CPU::LDrR<5, 1>,           // 0x69
+    &CPU::LDrR<5, 2>,           // 0x6A
+    &CPU::LDrR<5, 3>,           // 0x6B
+    &CPU::LDrR<5, 4>,           // 0x6C
+    &CPU::LDrR<5, 5>,           // 0x6D
+    &CPU::LDr_HL_<5>,           // 0x6E
+    &CPU::LDrR<5, 7>,           // 0x6F
 
     // 70
-    m_operationMap[0x70] = &CPU::LD_HL_r;
-    m_operationMap[0x71] = &CPU::LD_HL_r;
-    m_operationMap[0x72] = &CPU::LD_HL_r;
-    m_operationMap[0x73] = &CPU::LD_HL_r;
-    m_operationMap[0x74] = &CPU::LD_HL_r;
-    m_operationMap[0x75] = &CPU::LD_HL_r;
-    m_operationMap[0x76] = &CPU::HALT;
-    m_operationMap[0x77] = &CPU::LD_HL_r;
-    m_operationMap[0x78] = &CPU::LDrR;
-    m_operationMap[0x79] = &CPU::LDrR;
-    m_operationMap[0x7A] = &CPU::LDrR;
-    m_operationMap[0x7B] = &CPU::LDrR;
-    m_operationMap[0x7C] = &CPU::LDrR;
-    m_operationMap[0x7D] = &CPU::LDrR;
-    m_operationMap[0x7E] = &CPU::LDr_HL_;
-    m_operationMap[0x7F] = &CPU::LDrR;
+    &CPU::LD_HL_r<0>,           // 0x70
+    &CPU::LD_HL_r<1>,           // 0x71
+    &CPU::LD_HL_r<2>,           // 0x72
+    &CPU::LD_HL_r<3>,           // 0x73
+    &CPU::LD_HL_r<4>,           // 0x74
+    &CPU::LD_HL_r<5>,           // 0x75
+    &CPU::HALT,                 // 0x76
+    &CPU::LD_HL_r<7>,           // 0x77
+    &CPU::LDrR<7, 0>,           // 0x78
+    &CPU::LDrR<7, 1>,           // 0x79
+    &CPU::LDrR<7, 2>,           // 0x7A
+    &CPU::LDrR<7, 3>,           // 0x7B
+    &CPU::LDrR<7, 4>,           // 0x7C
+    &CPU::LDrR<7, 5>,           // 0x7D
+    &CPU::LDr_HL_<7>,           // 0x7E
+    &CPU::LDrR<7, 7>,           // 0x7F
 
     // 80
-    m_operationMap[0x80] = &CPU::ADDAr;
-    m_operationMap[0x81] = &CPU::ADDAr;
-    m_operationMap[0x82] = &CPU::ADDAr;
-    m_operationMap[0x83] = &CPU::ADDAr;
-    m_operationMap[0x84] = &CPU::ADDAr;
-    m_operationMap[0x85] = &CPU::ADDAr;
-    m_operationMap[0x86] = &CPU::ADDA_HL_;
-    m_operationMap[0x87] = &CPU::ADDAr;
-    m_operationMap[0x88] = &CPU::ADCAr;
-    m_operationMap[0x89] = &CPU::ADCAr;
-    m_operationMap[0x8A] = &CPU::ADCAr;
-    m_operationMap[0x8B] = &CPU::ADCAr;
-    m_operationMap[0x8C] = &CPU::ADCAr;
-    m_operationMap[0x8D] = &CPU::ADCAr;
-    m_operationMap[0x8E] = &CPU::ADCA_HL_;
-    m_operationMap[0x8F] = &CPU::ADCAr;
+    &CPU::ADDAr<0>,             // 0x80
+    &CPU::ADDAr<1>,             // 0x81
+    &CPU::ADDAr<2>,             // 0x82
+    &CPU::ADDAr<3>,             // 0x83
+    &CPU::ADDAr<4>,             // 0x84
+    &CPU::ADDAr<5>,             // 0x85
+    &CPU::ADDA_HL_,             // 0x86
+    &CPU::ADDAr<7>,             // 0x87
+    &CPU::ADCAr<0>,             // 0x88
+    &CPU::ADCAr<1>,             // 0x89
+    &CPU::ADCAr<2>,             // 0x8A
+    &CPU::ADCAr<3>,             // 0x8B
+    &CPU::ADCAr<4>,             // 0x8C
+    &CPU::ADCAr<5>,             // 0x8D
+    &CPU::ADCA_HL_,             // 0x8E
+    &CPU::ADCAr<7>,             // 0x8F
 
     // 90
-    m_operationMap[0x90] = &CPU::SUBr;
-    m_operationMap[0x91] = &CPU::SUBr;
-    m_operationMap[0x92] = &CPU::SUBr;
-    m_operationMap[0x93] = &CPU::SUBr;
-    m_operationMap[0x94] = &CPU::SUBr;
-    m_operationMap[0x95] = &CPU::SUBr;
-    m_operationMap[0x96] = &CPU::SUB_HL_;
-    m_operationMap[0x97] = &CPU::SUBr;
-    m_operationMap[0x98] = &CPU::SBCAr;
-    m_operationMap[0x99] = &CPU::SBCAr;
-    m_operationMap[0x9A] = &CPU::SBCAr;
-    m_operationMap[0x9B] = &CPU::SBCAr;
-    m_operationMap[0x9C] = &CPU::SBCAr;
-    m_operationMap[0x9D] = &CPU::SBCAr;
-    m_operationMap[0x9E] = &CPU::SBCA_HL_;
-    m_operationMap[0x9F] = &CPU::SBCAr;
+    &CPU::SUBr<0>,              // 0x90
+    &CPU::SUBr<1>,              // 0x91
+    &CPU::SUBr<2>,              // 0x92
+    &CPU::SUBr<3>,              // 0x93
+    &CPU::SUBr<4>,              // 0x94
+    &CPU::SUBr<5>,              // 0x95
+    &CPU::SUB_HL_,              // 0x96
+    &CPU::SUBr<7>,              // 0x97
+    &CPU::SBCAr<0>,             // 0x98
+    &CPU::SBCAr<1>,             // 0x99
+    &CPU::SBCAr<2>,             // 0x9A
+    &CPU::SBCAr<3>,             // 0x9B
+    &CPU::SBCAr<4>,             // 0x9C
+    &CPU::SBCAr<5>,             // 0x9D
+    &CPU::SBCA_HL_,             // 0x9E
+    &CPU::SBCAr<7>,             // 0x9F
 
     // A0
-    m_operationMap[0xA0] = &CPU::ANDr;
-    m_operationMap[0xA1] = &CPU::ANDr;
-    m_operationMap[0xA2] = &CPU::ANDr;
-    m_operationMap[0xA3] = &CPU::ANDr;
-    m_operationMap[0xA4] = &CPU::ANDr;
-    m_operationMap[0xA5] = &CPU::ANDr;
-    m_operationMap[0xA6] = &CPU::AND_HL_;
-    m_operationMap[0xA7] = &CPU::ANDr;
-    m_operationMap[0xA8] = &CPU::XORr;
-    m_operationMap[0xA9] = &CPU::XORr;
-    m_operationMap[0xAA] = &CPU::XORr;
-    m_operationMap[0xAB] = &CPU::XORr;
-    m_operationMap[0xAC] = &CPU::XORr;
-    m_operationMap[0xAD] = &CPU::XORr;
-    m_operationMap[0xAE] = &CPU::XOR_HL_;
-    m_operationMap[0xAF] = &CPU::XORr;
+    &CPU::ANDr<0>,              // 0xA0
+    &CPU::ANDr<1>,              // 0xA1
+    &CPU::ANDr<2>,              // 0xA2
+    &CPU::ANDr<3>,              // 0xA3
+    &CPU::ANDr<4>,              // 0xA4
+    &CPU::ANDr<5>,              // 0xA5
+    &CPU::AND_HL_,              // 0xA6
+    &CPU::ANDr<7>,              // 0xA7
+    &CPU::XORr<0>,              // 0xA8
+    &CPU::XORr<1>,              // 0xA9
+    &CPU::XORr<2>,              // 0xAA
+    &CPU::XORr<3>,              // 0xAB
+    &CPU::XORr<4>,              // 0xAC
+    &CPU::XORr<5>,              // 0xAD
+    &CPU::XOR_HL_,              // 0xAE
+    &CPU::XORr<7>,              // 0xAF
 
     // B0
-    m_operationMap[0xB0] = &CPU::ORr;
-    m_operationMap[0xB1] = &CPU::ORr;
-    m_operationMap[0xB2] = &CPU::ORr;
-    m_operationMap[0xB3] = &CPU::ORr;
-    m_operationMap[0xB4] = &CPU::ORr;
-    m_operationMap[0xB5] = &CPU::ORr;
-    m_operationMap[0xB6] = &CPU::OR_HL_;
-    m_operationMap[0xB7] = &CPU::ORr;
-    m_operationMap[0xB8] = &CPU::CPr;
-    m_operationMap[0xB9] = &CPU::CPr;
-    m_operationMap[0xBA] = &CPU::CPr;
-    m_operationMap[0xBB] = &CPU::CPr;
-    m_operationMap[0xBC] = &CPU::CPr;
-    m_operationMap[0xBD] = &CPU::CPr;
-    m_operationMap[0xBE] = &CPU::CP_HL_;
-    m_operationMap[0xBF] = &CPU::CPr;
+    &CPU::ORr<0>,               // 0xB0
+    &CPU::ORr<1>,               // 0xB1
+    &CPU::ORr<2>,               // 0xB2
+    &CPU::ORr<3>,               // 0xB3
+    &CPU::ORr<4>,               // 0xB4
+    &CPU::ORr<5>,               // 0xB5
+    &CPU::OR_HL_,               // 0xB6
+    &CPU::ORr<7>,               // 0xB7
+    &CPU::CPr<0>,               // 0xB8
+    &CPU::CPr<1>,               // 0xB9
+    &CPU::CPr<2>,               // 0xBA
+    &CPU::CPr<3>,               // 0xBB
+    &CPU::CPr<4>,               // 0xBC
+    &CPU::CPr<5>,               // 0xBD
+    &CPU::CP_HL_,               // 0xBE
+    &CPU::CPr<7>,               // 0xBF
 
     // C0
-    m_operationMap[0xC0] = &CPU::RETcc;
-    m_operationMap[0xC1] = &CPU::POPrr;
-    m_operationMap[0xC2] = &CPU::JPccnn;
-    m_operationMap[0xC3] = &CPU::JPnn;
-    m_operationMap[0xC4] = &CPU::CALLccnn;
-    m_operationMap[0xC5] = &CPU::PUSHrr;
-    m_operationMap[0xC6] = &CPU::ADDAn;
-    m_operationMap[0xC7] = &CPU::RSTn;
-    m_operationMap[0xC8] = &CPU::RETcc;
-    m_operationMap[0xC9] = &CPU::RET;
-    m_operationMap[0xCA] = &CPU::JPccnn;
-    //m_operationMap[0xCB] MAPPED TO 0xCB MAP
-    m_operationMap[0xCC] = &CPU::CALLccnn;
-    m_operationMap[0xCD] = &CPU::CALLnn;
-    m_operationMap[0xCE] = &CPU::ADCAn;
-    m_operationMap[0xCF] = &CPU::RSTn;
+    &CPU::RETcc<0>,             // 0xC0
+    &CPU::POPrr<0>,             // 0xC1
+    &CPU::JPccnn<0>,            // 0xC2
+    &CPU::JPnn,                 // 0xC3
+    &CPU::CALLccnn<0>,          // 0xC4
+    &CPU::PUSHrr<0>,            // 0xC5
+    &CPU::ADDAn,                // 0xC6
+    &CPU::RSTn<0>,              // 0xC7
+    &CPU::RETcc<1>,             // 0xC8
+    &CPU::RET,                  // 0xC9
+    &CPU::JPccnn<1>,            // 0xCA
+    nullptr,                    // 0xCB MAPPED TO 0xCB MAP
+    &CPU::CALLccnn<1>,          // 0xCC
+    &CPU::CALLnn,               // 0xCD
+    &CPU::ADCAn,                // 0xCE
+    &CPU::RSTn<1>,              // 0xCF
 
     // D0
-    m_operationMap[0xD0] = &CPU::RETcc;
-    m_operationMap[0xD1] = &CPU::POPrr;
-    m_operationMap[0xD2] = &CPU::JPccnn;
-    //m_operationMap[0xD3] UNUSED
-    m_operationMap[0xD4] = &CPU::CALLccnn;
-    m_operationMap[0xD5] = &CPU::PUSHrr;
-    m_operationMap[0xD6] = &CPU::SUBn;
-    m_operationMap[0xD7] = &CPU::RSTn;
-    m_operationMap[0xD8] = &CPU::RETcc;
-    m_operationMap[0xD9] = &CPU::RETI;
-    m_operationMap[0xDA] = &CPU::JPccnn;
-    //m_operationMap[0xDB] UNUSED
-    m_operationMap[0xDC] = &CPU::CALLccnn;
-    //m_operationMap[0xDD] UNUSED
-    m_operationMap[0xDE] = &CPU::SBCAn;
-    m_operationMap[0xDF] = &CPU::RSTn;
+    &CPU::RETcc<2>,             // 0xD0
+    &CPU::POPrr<1>,             // 0xD1
+    &CPU::JPccnn<2>,            // 0xD2
+    nullptr,                    // 0xD3 UNUSED
+    &CPU::CALLccnn<2>,          // 0xD4
+    &CPU::PUSHrr<1>,            // 0xD5
+    &CPU::SUBn,                 // 0xD6
+    &CPU::RSTn<2>,              // 0xD7
+    &CPU::RETcc<3>,             // 0xD8
+    &CPU::RETI,                 // 0xD9
+    &CPU::JPccnn<3>,            // 0xDA
+    nullptr,                    // 0xDB UNUSED
+    &CPU::CALLccnn<3>,          // 0xDC
+    nullptr,                    // 0xDD UNUSED
+    &CPU::SBCAn,                // 0xDE
+    &CPU::RSTn<3>,              // 0xDF
 
     // E0
-    m_operationMap[0xE0] = &CPU::LD_0xFF00n_A;
-    m_operationMap[0xE1] = &CPU::POPrr;
-    m_operationMap[0xE2] = &CPU::LD_0xFF00C_A;
-    //m_operationMap[0xE3] UNUSED
-    //m_operationMap[0xE4] UNUSED
-    m_operationMap[0xE5] = &CPU::PUSHrr;
-    m_operationMap[0xE6] = &CPU::ANDn;
-    m_operationMap[0xE7] = &CPU::RSTn;
-    m_operationMap[0xE8] = &CPU::ADDSPdd;
-    m_operationMap[0xE9] = &CPU::JP_HL_;
-    m_operationMap[0xEA] = &CPU::LD_nn_A;
-    //m_operationMap[0xEB] UNUSED
-    //m_operationMap[0xEC] UNUSED
-    //m_operationMap[0xED] UNUSED
-    m_operationMap[0xEE] = &CPU::XORn;
-    m_operationMap[0xEF] = &CPU::RSTn;
+    &CPU::LD_0xFF00n_A,         // 0xE0
+    &CPU::POPrr<2>,             // 0xE1
+    &CPU::LD_0xFF00C_A,         // 0xE2
+    nullptr,                    // 0xE3 UNUSED
+    nullptr,                    // 0xE4 UNUSED
+    &CPU::PUSHrr<2>,            // 0xE5
+    &CPU::ANDn,                 // 0xE6
+    &CPU::RSTn<4>,              // 0xE7
+    &CPU::ADDSPdd,              // 0xE8
+    &CPU::JP_HL_,               // 0xE9
+    &CPU::LD_nn_A,              // 0xEA
+    nullptr,                    // 0xEB UNUSED
+    nullptr,                    // 0xEC UNUSED
+    nullptr,                    // 0xED UNUSED
+    &CPU::XORn,                 // 0xEE
+    &CPU::RSTn<5>,              // 0xEF
 
     // F0
-    m_operationMap[0xF0] = &CPU::LDA_0xFF00n_;
-    m_operationMap[0xF1] = &CPU::POPrr;
-    m_operationMap[0xF2] = &CPU::LDA_0xFF00C_;
-    m_operationMap[0xF3] = &CPU::DI;
-    //m_operationMap[0xF4] UNUSED
-    m_operationMap[0xF5] = &CPU::PUSHrr;
-    m_operationMap[0xF6] = &CPU::ORn;
-    m_operationMap[0xF7] = &CPU::RSTn;
-    m_operationMap[0xF8] = &CPU::LDHLSPe;
-    m_operationMap[0xF9] = &CPU::LDSPHL;
-    m_operationMap[0xFA] = &CPU::LDA_nn_;
-    m_operationMap[0xFB] = &CPU::EI;
-    //m_operationMap[0xFC] UNUSED
-    //m_operationMap[0xFD] UNUSED
-    m_operationMap[0xFE] = &CPU::CPn;
-    m_operationMap[0xFF] = &CPU::RSTn;
-
-    /*
-        Z80 Command Set - CB
-    */
+    &CPU::LDA_0xFF00n_,         // 0xF0
+    &CPU::POPrr<3>,             // 0xF1
+    &CPU::LDA_0xFF00C_,         // 0xF2
+    &CPU::DI,                   // 0xF3
+    nullptr,                    // 0xF4 UNUSED
+    &CPU::PUSHrr<3>,            // 0xF5
+    &CPU::ORn,                  // 0xF6
+    &CPU::RSTn<6>,              // 0xF7
+    &CPU::LDHLSPe,              // 0xF8
+    &CPU::LDSPHL,               // 0xF9
+    &CPU::LDA_nn_,              // 0xFA
+    &CPU::EI,                   // 0xFB
+    nullptr,                    // 0xFC UNUSED
+    nullptr,                    // 0xFD UNUSED
+    &CPU::CPn,                  // 0xFE
+    &CPU::RSTn<7>               // 0xFF
+};
 
+/*
+    Z80 Command Set - CB
+*/
+const CPU::opCodeFunction CPU::m_operationMapCB[] =
+{
     // 00
-    m_operationMapCB[0x00] = &CPU::RLCr;
-    m_operationMapCB[0x01] = &CPU::RLCr;
-    m_operationMapCB[0x02] = &CPU::RLCr;
-    m_operationMapCB[0x03] = &CPU::RLCr;
-    m_operationMapCB[0x04] = &CPU::RLCr;
-    m_operationMapCB[0x05] = &CPU::RLCr;
-    m_operationMapCB[0x06] = &CPU::RLC_HL_;
-    m_operationMapCB[0x07] = &CPU::RLCr;
-    m_operationMapCB[0x08] = &CPU::RRCr;
-    m_operationMapCB[0x09] = &CPU::RRCr;
-    m_operationMapCB[0x0A] = &CPU::RRCr;
-    m_operationMapCB[0x0B] = &CPU::RRCr;
-    m_operationMapCB[0x0C] = &CPU::RRCr;
-    m_operationMapCB[0x0D] = &CPU::RRCr;
-    m_operationMapCB[0x0E] = &CPU::RRC_HL_;
-    m_operationMapCB[0x0F] = &CPU::RRCr;
+    &CPU::RLCr<0>,              // 0x00
+    &CPU::RLCr<1>,              // 0x01
+    &CPU::RLCr<2>,              // 0x02
+    &CPU::RLCr<3>,              // 0x03
+    &CPU::RLCr<4>,              // 0x04
+    &CPU::RLCr<5>,              // 0x05
+    &CPU::RLC_HL_,              // 0x06
+    &CPU::RLCr<7>,              // 0x07
+    &CPU::RRCr<0>,              // 0x08
+    &CPU::RRCr<1>,              // 0x09
+    &CPU::RRCr<2>,              // 0x0A
+    &CPU::RRCr<3>,              // 0x0B
+    &CPU::RRCr<4>,              // 0x0C
+    &CPU::RRCr<5>,              // 0x0D
+    &CPU::RRC_HL_,              // 0x0E
+    &CPU::RRCr<7>,              // 0x0F
 
     // 10
-    m_operationMapCB[0x10] = &CPU::RLr;
-    m_operationMapCB[0x11] = &CPU::RLr;
-    m_operationMapCB[0x12] = &CPU::RLr;
-    m_operationMapCB[0x13] = &CPU::RLr;
-    m_operationMapCB[0x14] = &CPU::RLr;
-    m_operationMapCB[0x15] = &CPU::RLr;
-    m_operationMapCB[0x16] = &CPU::RL_HL_;
-    m_operationMapCB[0x17] = &CPU::RLr;
-    m_operationMapCB[0x18] = &CPU::RRr;
-    m_operationMapCB[0x19] = &CPU::RRr;
-    m_operationMapCB[0x1A] = &CPU::RRr;
-    m_operationMapCB[0x1B] = &CPU::RRr;
-    m_operationMapCB[0x1C] = &CPU::RRr;
-    m_operationMapCB[0x1D] = &CPU::RRr;
-    m_operationMapCB[0x1E] = &CPU::RR_HL_;
-    m_operationMapCB[0x1F] = &CPU::RRr;
+    &CPU::RLr<0>,               // 0x10
+    &CPU::RLr<1>,               // 0x11
+    &CPU::RLr<2>,               // 0x12
+    &CPU::RLr<3>,               // 0x13
+    &CPU::RLr<4>,               // 0x14
+    &CPU::RLr<5>,               // 0x15
+    &CPU::RL_HL_,               // 0x16
+    &CPU::RLr<7>,               // 0x17
+    &CPU::RRr<0>,               // 0x18
+    &CPU::RRr<1>,               // 0x19
+    &CPU::RRr<2>,               // 0x1A
+    &CPU::RRr<3>,               // 0x1B
+    &CPU::RRr<4>,               // 0x1C
+    &CPU::RRr<5>,               // 0x1D
+    &CPU::RR_HL_,               // 0x1E
+    &CPU::RRr<7>,               // 0x1F
 
     // 20
-    m_operationMapCB[0x20] = &CPU::SLAr;
-    m_operationMapCB[0x21] = &CPU::SLAr;
-    m_operationMapCB[0x22] = &CPU::SLAr;
-    m_operationMapCB[0x23] = &CPU::SLAr;
-    m_operationMapCB[0x24] = &CPU::SLAr;
-    m_operationMapCB[0x25] = &CPU::SLAr;
-    m_operationMapCB[0x26] = &CPU::SLA_HL_;
-    m_operationMapCB[0x27] = &CPU::SLAr;
-    m_operationMapCB[0x28] = &CPU::SRAr;
-    m_operationMapCB[0x29] = &CPU::SRAr;
-    m_operationMapCB[0x2A] = &CPU::SRAr;
-    m_operationMapCB[0x2B] = &CPU::SRAr;
-    m_operationMapCB[0x2C] = &CPU::SRAr;
-    m_operationMapCB[0x2D] = &CPU::SRAr;
-    m_operationMapCB[0x2E] = &CPU::SRA_HL_;
-    m_operationMapCB[0x2F] = &CPU::SRAr;
+    &CPU::SLAr<0>,              // 0x20
+    &CPU::SLAr<1>,              // 0x21
+    &CPU::SLAr<2>,              // 0x22
+    &CPU::SLAr<3>,              // 0x23
+    &CPU::SLAr<4>,              // 0x24
+    &CPU::SLAr<5>,              // 0x25
+    &CPU::SLA_HL_,              // 0x26
+    &CPU::SLAr<7>,              // 0x27
+    &CPU::SRAr<0>,              // 0x28
+    &CPU::SRAr<1>,              // 0x29
+    &CPU::SRAr<2>,              // 0x2A
+    &CPU::SRAr<3>,              // 0x2B
+    &CPU::SRAr<4>,              // 0x2C
+    &CPU::SRAr<5>,              // 0x2D
+    &CPU::SRA_HL_,              // 0x2E
+    &CPU::SRAr<7>,              // 0x2F
 
     // 30
-    m_operationMapCB[0x30] = &CPU::SWAPr;
-    m_operationMapCB[0x31] = &CPU::SWAPr;
-    m_operationMapCB[0x32] = &CPU::SWAPr;
-    m_operationMapCB[0x33] = &CPU::SWAPr;
-    m_operationMapCB[0x34] = &CPU::SWAPr;
-    m_operationMapCB[0x35] = &CPU::SWAPr;
-    m_operationMapCB[0x36] = &CPU::SWAP_HL_;
-    m_operationMapCB[0x37] = &CPU::SWAPr;
-    m_operationMapCB[0x38] = &CPU::SRLr;
-    m_operationMapCB[0x39] = &CPU::SRLr;
-    m_operationMapCB[0x3A] = &CPU::SRLr;
-    m_operationMapCB[0x3B] = &CPU::SRLr;
-    m_operationMapCB[0x3C] = &CPU::SRLr;
-    m_operationMapCB[0x3D] = &CPU::SRLr;
-    m_operationMapCB[0x3E] = &CPU::SRL_HL_;
-    m_operationMapCB[0x3F] = &CPU::SRLr;
+    &CPU::SWAPr<0>,             // 0x30
+    &CPU::SWAPr<1>,             // 0x31
+    &CPU::SWAPr<2>,             // 0x32
+    &CPU::SWAPr<3>,             // 0x33
+    &CPU::SWAPr<4>,             // 0x34
+    &CPU::SWAPr<5>,             // 0x35
+    &CPU::SWAP_HL_,             // 0x36
+    &CPU::SWAPr<7>,             // 0x37
+    &CPU::SRLr<0>,              // 0x38
+    &CPU::SRLr<1>,              // 0x39
+    &CPU::SRLr<2>,              // 0x3A
+    &CPU::SRLr<3>,              // 0x3B
+    &CPU::SRLr<4>,              // 0x3C
+    &CPU::SRLr<5>,              // 0x3D
+    &CPU::SRL_HL_,              // 0x3E
+    &CPU::SRLr<7>,              // 0x3F
 
     // 40
-    m_operationMapCB[0x40] = &CPU::BITbr;
-    m_operationMapCB[0x41] = &CPU::BITbr;
-    m_operationMapCB[0x42] = &CPU::BITbr;
-    m_operationMapCB[0x43] = &CPU::BITbr;
-    m_operationMapCB[0x44] = &CPU::BITbr;
-    m_operationMapCB[0x45] = &CPU::BITbr;
-    m_operationMapCB[0x46] = &CPU::BITb_HL_;
-    m_operationMapCB[0x47] = &CPU::BITbr;
-    m_operationMapCB[0x48] = &CPU::BITbr;
-    m_operationMapCB[0x49] = &CPU::BITbr;
-    m_operationMapCB[0x4A] = &CPU::BITbr;
-    m_operationMapCB[0x4B] = &CPU::BITbr;
-    m_operationMapCB[0x4C] = &CPU::BITbr;
-    m_operationMapCB[0x4D] = &CPU::BITbr;
-    m_operationMapCB[0x4E] = &CPU::BITb_HL_;
-    m_operationMapCB[0x4F] = &CPU::BITbr;
+    &CPU::BITbr<0, 0>,          // 0x40
+    &CPU::BITbr<0, 1>,          // 0x41
+    &CPU::BITbr<0, 2>,          // 0x42
+    &CPU::BITbr<0, 3>,          // 0x43
+    &CPU::BITbr<0, 4>,          // 0x44
+    &CPU::BITbr<0, 5>,          // 0x45
+    &CPU::BITb_HL_<0>,          // 0x46
+    &CPU::BITbr<0, 7>,          // 0x47
+    &CPU::BITbr<1, 0>,          // 0x48
+    &CPU::BITbr<1, 1>,          // 0x49
+    &CPU::BITbr<1, 2>,          // 0x4A
+    &CPU::BITbr<1, 3>,          // 0x4B
+    &CPU::BITbr<1, 4>,          // 0x4C
+    &CPU::BITbr<1, 5>,          // 0x4D
+    &CPU::BITb_HL_<1>,          // 0x4E
+    &CPU::BITbr<1, 7>,          // 0x4F
 
     // 50
-    m_operationMapCB[0x50] = &CPU::BITbr;
-    m_operationMapCB[0x51] = &CPU::BITbr;
-    m_operationMapCB[0x52] = &CPU::BITbr;
-    m_operationMapCB[0x53] = &CPU::BITbr;
-    m_operationMapCB[0x54] = &CPU::BITbr;
-    m_operationMapCB[0x55] = &CPU::BITbr;
-    m_operationMapCB[0x56] = &CPU::BITb_HL_;
-    m_operationMapCB[0x57] = &CPU::BITbr;
-    m_operationMapCB[0x58] = &CPU::BITbr;
-    m_operationMapCB[0x59] = &CPU::BITbr;
-    m_operationMapCB[0x5A] = &CPU::BITbr;
-    m_operationMapCB[0x5B] = &CPU::BITbr;
-    m_operationMapCB[0x5C] = &CPU::BITbr;
-    m_operationMapCB[0x5D] = &CPU::BITbr;
-    m_operationMapCB[0x5E] = &CPU::BITb_HL_;
-    m_operationMapCB[0x5F] = &CPU::BITbr;
+    &CPU::BITbr<2, 0>,          // 0x50
+    &CPU::BITbr<2, 1>,          // 0x51
+    &CPU::BITbr<2, 2>,          // 0x52
+    &CPU::BITbr<2, 3>,          // 0x53
+    &CPU::BITbr<2, 4>,          // 0x54
+    &CPU::BITbr<2, 5>,          // 0x55
+    &CPU::BITb_HL_<2>,          // 0x56
+    &CPU::BITbr<2, 7>,          // 0x57
+    &CPU::BITbr<3, 0>,          // 0x58
+    &CPU::BITbr<3, 1>,          // 0x59
+    &CPU::BITbr<3, 2>,          // 0x5A
+    &CPU::BITbr<3, 3>,          // 0x5B
+    &CPU::BITbr<3, 4>,          // 0x5C
+    &CPU::BITbr<3, 5>,          // 0x5D
+    &CPU::BITb_HL_<3>,          // 0x5E
+    &CPU::BITbr<3, 7>,          // 0x5F
 
     // 60
-    m_operationMapCB[0x60] = &CPU::BITbr;
-    m_operationMapCB[0x61] = &CPU::BITbr;
-    m_operationMapCB[0x62] = &CPU::BITbr;
-    m_operationMapCB[0x63] = &CPU::BITbr;
-    m_operationMapCB[0x64] = &CPU::BITbr;
-    m_operationMapCB[0x65] = &CPU::BITbr;
-    m_operationMapCB[0x66] = &CPU::BITb_HL_;
-    m_operationMapCB[0x67] = &CPU::BITbr;
-    m_operationMapCB[0x68] = &CPU::BITbr;
-    m_operationMapCB[0x69] = &CPU::BITbr;
-    m_operationMapCB[0x6A] = &CPU::BITbr;
-    m_operationMapCB[0x6B] = &CPU::BITbr;
-    m_operationMapCB[0x6C] = &CPU::BITbr;
-    m_operationMapCB[0x6D] = &CPU::BITbr;
-    m_operationMapCB[0x6E] = &CPU::BITb_HL_;
-    m_operationMapCB[0x6F] = &CPU::BITbr;
+    &CPU::BITbr<4, 0>,          // 0x60
+    &CPU::BITbr<4, 1>,          // 0x61
+    &CPU::BITbr<4, 2>,          // 0x62
+    &CPU::BITbr<4, 3>,          // 0x63
+    &CPU::BITbr<4, 4>,          // 0x64
+    &CPU::BITbr<4, 5>,          // 0x65
+    &CPU::BITb_HL_<4>,          // 0x66
+    &CPU::BITbr<4, 7>,          // 0x67
+    &CPU::BITbr<5, 0>,          // 0x68
+    &CPU::BITbr<5, 1>,          // 0x69
+    &CPU::BITbr<5, 2>,          // 0x6A
+    &CPU::BITbr<5, 3>,          // 0x6B
+    &CPU::BITbr<5, 4>,          // 0x6C
+    &CPU::BITbr<5, 5>,          // 0x6D
+    &CPU::BITb_HL_<5>,          // 0x6E
+    &CPU::BITbr<5, 7>,          // 0x6F
 
     // 70
-    m_operationMapCB[0x70] = &CPU::BITbr;
-    m_operationMapCB[0x71] = &CPU::BITbr;
-    m_operationMapCB[0x72] = &CPU::BITbr;
-    m_operationMapCB[0x73] = &CPU::BITbr;
-    m_operationMapCB[0x74] = &CPU::BITbr;
-    m_operationMapCB[0x75] = &CPU::BITbr;
-    m_operationMapCB[0x76] = &CPU::BITb_HL_;
-    m_operationMapCB[0x77] = &CPU::BITbr;
-    m_operationMapCB[0x78] = &CPU::BITbr;
-    m_operationMapCB[0x79] = &CPU::BITbr;
-    m_operationMapCB[0x7A] = &CPU::BITbr;
-    m_operationMapCB[0x7B] = &CPU::BITbr;
-    m_operationMapCB[0x7C] = &CPU::BITbr;
-    m_operationMapCB[0x7D] = &CPU::BITbr;
-    m_operationMapCB[0x7E] = &CPU::BITb_HL_;
-    m_operationMapCB[0x7F] = &CPU::BITbr;
+    &CPU::BITbr<6, 0>,          // 0x70
+    &CPU::BITbr<6, 1>,          // 0x71
+    &CPU::BITbr<6, 2>,          // 0x72
+    &CPU::BITbr<6, 3>,          // 0x73
+    &CPU::BITbr<6, 4>,          // 0x74
+    &CPU::BITbr<6, 5>,          // 0x75
+    &CPU::BITb_HL_<6>,          // 0x76
+    &CPU::BITbr<6, 7>,          // 0x77
+    &CPU::BITbr<7, 0>,          // 0x78
+    &CPU::BITbr<7, 1>,          // 0x79
+    &CPU::BITbr<7, 2>,          // 0x7A
+    &CPU::BITbr<7, 3>,          // 0x7B
+    &CPU::BITbr<7, 4>,          // 0x7C
+    &CPU::BITbr<7, 5>,          // 0x7D
+    &CPU::BITb_HL_<7>,          // 0x7E
+    &CPU::BITbr<7, 7>,          // 0x7F
 
     // 80
-    m_operationMapCB[0x80] = &CPU::RESbr;
-    m_operationMapCB[0x81] = &CPU::RESbr;
-    m_operationMapCB[0x82] = &CPU::RESbr;
-    m_operationMapCB[0x83] = &CPU::RESbr;
-    m_operationMapCB[0x84] = &CPU::RESbr;
-    m_operationMapCB[0x85] = &CPU::RESbr;
-    m_operationMapCB[0x86] = &CPU::RESb_HL_;
-    m_operationMapCB[0x87] = &CPU::RESbr;
-    m_operationMapCB[0x88] = &CPU::RESbr;
-    m_operationMapCB[0x89] = &CPU::RESbr;
-    m_operationMapCB[0x8A] = &CPU::RESbr;
-    m_operationMapCB[0x8B] = &CPU::RESbr;
-    m_operationMapCB[0x8C] = &CPU::RESbr;
-    m_operationMapCB[0x8D] = &CPU::RESbr;
-    m_operationMapCB[0x8E] = &CPU::RESb_HL_;
-    m_operationMapCB[0x8F] = &CPU::RESbr;
+    &CPU::RESbr<0, 0>,          // 0x80
+    &CPU::RESbr<0, 1>,          // 0x81
+    &CPU::RESbr<0, 2>,          // 0x82
+    &CPU::RESbr<0, 3>,          // 0x83
+    &CPU::RESbr<0, 4>,          // 0x84
+    &CPU::RESbr<0, 5>,          // 0x85
+    &CPU::RESb_HL_<0>,          // 0x86
+    &CPU::RESbr<0, 7>,          // 0x87
+    &CPU::RESbr<1, 0>,          // 0x88
+    &CPU::RESbr<1, 1>,          // 0x89
+    &CPU::RESbr<1, 2>,          // 0x8A
+    &CPU::RESbr<1, 3>,          // 0x8B
+    &CPU::RESbr<1, 4>,          // 0x8C
+    &CPU::RESbr<1, 5>,          // 0x8D
+    &CPU::RESb_HL_<1>,          // 0x8E
+    &CPU::RESbr<1, 7>,          // 0x8F
 
     // 90
-    m_operationMapCB[0x90] = &CPU::RESbr;
-    m_operationMapCB[0x91] = &CPU::RESbr;
-    m_operationMapCB[0x92] = &CPU::RESbr;
-    m_operationMapCB[0x93] = &CPU::RESbr;
-    m_operationMapCB[0x94] = &CPU::RESbr;
-    m_operationMapCB[0x95] = &CPU::RESbr;
-    m_operationMapCB[0x96] = &CPU::RESb_HL_;
-    m_operationMapCB[0x97] = &CPU::RESbr;
-    m_operationMapCB[0x98] = &CPU::RESbr;
-    m_operationMapCB[0x99] = &CPU::RESbr;
-    m_operationMapCB[0x9A] = &CPU::RESbr;
-    m_operationMapCB[0x9B] = &CPU::RESbr;
-    m_operationMapCB[0x9C] = &CPU::RESbr;
-    m_operationMapCB[0x9D] = &CPU::RESbr;
-    m_operationMapCB[0x9E] = &CPU::RESb_HL_;
-    m_operationMapCB[0x9F] = &CPU::RESbr;
+    &CPU::RESbr<2, 0>,          // 0x90
+    &CPU::RESbr<2, 1>,          // 0x91
+    &CPU::RESbr<2, 2>,          // 0x92
+    &CPU::RESbr<2, 3>,          // 0x93
+    &CPU::RESbr<2, 4>,          // 0x94
+    &CPU::RESbr<2, 5>,          // 0x95
+    &CPU::RESb_HL_<2>,          // 0x96
+    &CPU::RESbr<2, 7>,          // 0x97
+    &CPU::RESbr<3, 0>,          // 0x98
+    &CPU::RESbr<3, 1>,          // 0x99
+    &CPU::RESbr<3, 2>,          // 0x9A
+    &CPU::RESbr<3, 3>,          // 0x9B
+    &CPU::RESbr<3, 4>,          // 0x9C
+    &CPU::RESbr<3, 5>,          // 0x9D
+    &CPU::RESb_HL_<3>,          // 0x9E
+    &CPU::RESbr<3, 7>,          // 0x9F
 
     // A0
-    m_operationMapCB[0xA0] = &CPU::RESbr;
-    m_operationMapCB[0xA1] = &CPU::RESbr;
-    m_operationMapCB[0xA2] = &CPU::RESbr;
-    m_operationMapCB[0xA3] = &CPU::RESbr;
-    m_operationMapCB[0xA4] = &CPU::RESbr;
-    m_operationMapCB[0xA5] = &CPU::RESbr;
-    m_operationMapCB[0xA6] = &CPU::RESb_HL_;
-    m_operationMapCB[0xA7] = &CPU::RESbr;
-    m_operationMapCB[0xA8] = &CPU::RESbr;
-    m_operationMapCB[0xA9] = &CPU::RESbr;
-    m_operationMapCB[0xAA] = &CPU::RESbr;
-    m_operationMapCB[0xAB] = &CPU::RESbr;
-    m_operationMapCB[0xAC] = &CPU::RESbr;
-    m_operationMapCB[0xAD] = &CPU::RESbr;
-    m_operationMapCB[0xAE] = &CPU::RESb_HL_;
-    m_operationMapCB[0xAF] = &CPU::RESbr;
+    &CPU::RESbr<4, 0>,          // 0xA0
+    &CPU::RESbr<4, 1>,          // 0xA1
+    &CPU::RESbr<4, 2>,          // 0xA2
+    &CPU::RESbr<4, 3>,          // 0xA3
+    &CPU::RESbr<4, 4>,          // 0xA4
+    &CPU::RESbr<4, 5>,          // 0xA5
+    &CPU::RESb_HL_<4>,          // 0xA6
+    &CPU::RESbr<4, 7>,          // 0xA7
+    &CPU::RESbr<5, 0>,          // 0xA8
+    &CPU::RESbr<5, 1>,          // 0xA9
+    &CPU::RESbr<5, 2>,          // 0xAA
+    &CPU::RESbr<5, 3>,          // 0xAB
+    &CPU::RESbr<5, 4>,          // 0xAC
+    &CPU::RESbr<5, 5>,          // 0xAD
+    &CPU::RESb_HL_<5>,          // 0xAE
+    &CPU::RESbr<5, 7>,          // 0xAF
 
     // B0
-    m_operationMapCB[0xB0] = &CPU::RESbr;
-    m_operationMapCB[0xB1] = &CPU::RESbr;
-    m_operationMapCB[0xB2] = &CPU::RESbr;
-    m_operationMapCB[0xB3] = &CPU::RESbr;
-    m_operationMapCB[0xB4] = &CPU::RESbr;
-    m_operationMapCB[0xB5] = &CPU::RESbr;
-    m_operationMapCB[0xB6] = &CPU::RESb_HL_;
-    m_operationMapCB[0xB7] = &CPU::RESbr;
-    m_operationMapCB[0xB8] = &CPU::RESbr;
-    m_operationMapCB[0xB9] = &CPU::RESbr;
-    m_operationMapCB[0xBA] = &CPU::RESbr;
-    m_operationMapCB[0xBB] = &CPU::RESbr;
-    m_operationMapCB[0xBC] = &CPU::RESbr;
-    m_operationMapCB[0xBD] = &CPU::RESbr;
-    m_operationMapCB[0xBE] = &CPU::RESb_HL_;
-    m_operationMapCB[0xBF] = &CPU::RESbr;
+    &CPU::RESbr<6, 0>,          // 0xB0
+    &CPU::RESbr<6, 1>,          // 0xB1
+    &CPU::RESbr<6, 2>,          // 0xB2
+    &CPU::RESbr<6, 3>,          // 0xB3
+    &CPU::RESbr<6, 4>,          // 0xB4
+    &CPU::RESbr<6, 5>,          // 0xB5
+    &CPU::RESb_HL_<6>,          // 0xB6
+    &CPU::RESbr<6, 7>,          // 0xB7
+    &CPU::RESbr<7, 0>,          // 0xB8
+    &CPU::RESbr<7, 1>,          // 0xB9
+    &CPU::RESbr<7, 2>,          // 0xBA
+    &CPU::RESbr<7, 3>,          // 0xBB
+    &CPU::RESbr<7, 4>,          // 0xBC
+    &CPU::RESbr<7, 5>,          // 0xBD
+    &CPU::RESb_HL_<7>,          // 0xBE
+    &CPU::RESbr<7, 7>,          // 0xBF
 
     // C0
-    m_operationMapCB[0xC0] = &CPU::SETbr;
-    m_operationMapCB[0xC1] = &CPU::SETbr;
-    m_operationMapCB[0xC2] = &CPU::SETbr;
-    m_operationMapCB[0xC3] = &CPU::SETbr;
-    m_operationMapCB[0xC4] = &CPU::SETbr;
-    m_operationMapCB[0xC5] = &CPU::SETbr;
-    m_operationMapCB[0xC6] = &CPU::SETb_HL_;
-    m_operationMapCB[0xC7] = &CPU::SETbr;
-    m_operationMapCB[0xC8] = &CPU::SETbr;
-    m_operationMapCB[0xC9] = &CPU::SETbr;
-    m_operationMapCB[0xCA] = &CPU::SETbr;
-    m_operationMapCB[0xCB] = &CPU::SETbr;
-    m_operationMapCB[0xCC] = &CPU::SETbr;
-    m_operationMapCB[0xCD] = &CPU::SETbr;
-    m_operationMapCB[0xCE] = &CPU::SETb_HL_;
-    m_operationMapCB[0xCF] = &CPU::SETbr;
+    &CPU::SETbr<0, 0>,          // 0xC0
+    &CPU::SETbr<0, 1>,          // 0xC1
+    &CPU::SETbr<0, 2>,          // 0xC2
+    &CPU::SETbr<0, 3>,          // 0xC3
+    &CPU::SETbr<0, 4>,          // 0xC4
+    &CPU::SETbr<0, 5>,          // 0xC5
+    &CPU::SETb_HL_<0>,          // 0xC6
+    &CPU::SETbr<0, 7>,          // 0xC7
+    &CPU::SETbr<1, 0>,          // 0xC8
+    &CPU::SETbr<1, 1>,          // 0xC9
+    &CPU::SETbr<1, 2>,          // 0xCA
+    &CPU::SETbr<1, 3>,          // 0xCB
+    &CPU::SETbr<1, 4>,          // 0xCC
+    &CPU::SETbr<1, 5>,          // 0xCD
+    &CPU::SETb_HL_<1>,          // 0xCE
+    &CPU::SETbr<1, 7>,          // 0xCF
 
     // D0
-    m_operationMapCB[0xD0] = &CPU::SETbr;
-    m_operationMapCB[0xD1] = &CPU::SETbr;
-    m_operationMapCB[0xD2] = &CPU::SETbr;
-    m_operationMapCB[0xD3] = &CPU::SETbr;
-    m_operationMapCB[0xD4] = &CPU::SETbr;
-    m_operationMapCB[0xD5] = &CPU::SETbr;
-    m_operationMapCB[0xD6] = &CPU::SETb_HL_;
-    m_operationMapCB[0xD7] = &CPU::SETbr;
-    m_operationMapCB[0xD8] = &CPU::SETbr;
-    m_operationMapCB[0xD9] = &CPU::SETbr;
-    m_operationMapCB[0xDA] = &CPU::SETbr;
-    m_operationMapCB[0xDB] = &CPU::SETbr;
-    m_operationMapCB[0xDC] = &CPU::SETbr;
-    m_operationMapCB[0xDD] = &CPU::SETbr;
-    m_operationMapCB[0xDE] = &CPU::SETb_HL_;
-    m_operationMapCB[0xDF] = &CPU::SETbr;
+    &CPU::SETbr<2, 0>,          // 0xD0
+    &CPU::SETbr<2, 1>,          // 0xD1
+    &CPU::SETbr<2, 2>,          // 0xD2
+    &CPU::SETbr<2, 3>,          // 0xD3
+    &CPU::SETbr<2, 4>,          // 0xD4
+    &CPU::SETbr<2, 5>,          // 0xD5
+    &CPU::SETb_HL_<2>,          // 0xD6
+    &CPU::SETbr<2, 7>,          // 0xD7
+    &CPU::SETbr<3, 0>,          // 0xD8
+    &CPU::SETbr<3, 1>,          // 0xD9
+    &CPU::SETbr<3, 2>,          // 0xDA
+    &CPU::SETbr<3, 3>,          // 0xDB
+    &CPU::SETbr<3, 4>,          // 0xDC
+    &CPU::SETbr<3, 5>,          // 0xDD
+    &CPU::SETb_HL_<3>,          // 0xDE
+    &CPU::SETbr<3, 7>,          // 0xDF
 
     // E0
-    m_operationMapCB[0xE0] = &CPU::SETbr;
-    m_operationMapCB[0xE1] = &CPU::SETbr;
-    m_operationMapCB[0xE2] = &CPU::SETbr;
-    m_operationMapCB[0xE3] = &CPU::SETbr;
-    m_operationMapCB[0xE4] = &CPU::SETbr;
-    m_operationMapCB[0xE5] = &CPU::SETbr;
-    m_operationMapCB[0xE6] = &CPU::SETb_HL_;
-    m_operationMapCB[0xE7] = &CPU::SETbr;
-    m_operationMapCB[0xE8] = &CPU::SETbr;
-    m_operationMapCB[0xE9] = &CPU::SETbr;
-    m_operationMapCB[0xEA] = &CPU::SETbr;
-    m_operationMapCB[0xEB] = &CPU::SETbr;
-    m_operationMapCB[0xEC] = &CPU::SETbr;
-    m_operationMapCB[0xED] = &CPU::SETbr;
-    m_operationMapCB[0xEE] = &CPU::SETb_HL_;
-    m_operationMapCB[0xEF] = &CPU::SETbr;
+    &CPU::SETbr<4, 0>,          // 0xE0
+    &CPU::SETbr<4, 1>,          // 0xE1
+    &CPU::SETbr<4, 2>,          // 0xE2
+    &CPU::SETbr<4, 3>,          // 0xE3
+    &CPU::SETbr<4, 4>,          // 0xE4
+    &CPU::SETbr<4, 5>,          // 0xE5
+    &CPU::SETb_HL_<4>,          // 0xE6
+    &CPU::SETbr<4, 7>,          // 0xE7
+    &CPU::SETbr<5, 0>,          // 0xE8
+    &CPU::SETbr<5, 1>,          // 0xE9
+    &CPU::SETbr<5, 2>,          // 0xEA
+    &CPU::SETbr<5, 3>,          // 0xEB
+    &CPU::SETbr<5, 4>,          // 0xEC
+    &CPU::SETbr<5, 5>,          // 0xED
+    &CPU::SETb_HL_<5>,          // 0xEE
+    &CPU::SETbr<5, 7>,          // 0xEF
 
     // F0
-    m_operationMapCB[0xF0] = &CPU::SETbr;
-    m_operationMapCB[0xF1] = &CPU::SETbr;
-    m_operationMapCB[0xF2] = &CPU::SETbr;
-    m_operationMapCB[0xF3] = &CPU::SETbr;
-    m_operationMapCB[0xF4] = &CPU::SETbr;
-    m_operationMapCB[0xF5] = &CPU::SETbr;
-    m_operationMapCB[0xF6] = &CPU::SETb_HL_;
-    m_operationMapCB[0xF7] = &CPU::SETbr;
-    m_operationMapCB[0xF8] = &CPU::SETbr;
-    m_operationMapCB[0xF9] = &CPU::SETbr;
-    m_operationMapCB[0xFA] = &CPU::SETbr;
-    m_operationMapCB[0xFB] = &CPU::SETbr;
-    m_operationMapCB[0xFC] = &CPU::SETbr;
-    m_operationMapCB[0xFD] = &CPU::SETbr;
-    m_operationMapCB[0xFE] = &CPU::SETb_HL_;
-    m_operationMapCB[0xFF] = &CPU::SETbr;
+    &CPU::SETbr<6, 0>,          // 0xF0
+    &CPU::SETbr<6, 1>,          // 0xF1
+    &CPU::SETbr<6, 2>,          // 0xF2
+    &CPU::SETbr<6, 3>,          // 0xF3
+    &CPU::SETbr<6, 4>,          // 0xF4
+    &CPU::SETbr<6, 5>,          // 0xF5
+    &CPU::SETb_HL_<6>,          // 0xF6
+    &CPU::SETbr<6, 7>,          // 0xF7
+    &CPU::SETbr<7, 0>,          // 0xF8
+    &CPU::SETbr<7, 1>,          // 0xF9
+    &CPU::SETbr<7, 2>,          // 0xFA
+    &CPU::SETbr<7, 3>,          // 0xFB
+    &CPU::SETbr<7, 4>,          // 0xFC
+    &CPU::SETbr<7, 5>,          // 0xFD
+    &CPU::SETb_HL_<7>,          // 0xFE
+    &CPU::SETbr<7, 7>           // 0xFF
+};
 
+CPU::CPU() :
+    m_cycles(0),
+    m_isHalted(false),
+    m_AF(0x0000),
+    m_BC(0x0000),
+    m_DE(0x0000),
+    m_HL(0x0000),
+    m_SP(0x0000),
+    m_PC(0x0000),
+    m_lazyFlagsOp(LazyFlagsNone),
+    m_lazyFlagsA(0x00),
+    m_lazyFlagsB(0x00),
+    m_lazyFlagsCarry(0x00),
+    m_lazyFlagsResult(0x00),
+    m_IME(0x00),
+    m_IE(0x00),
+    m_IF(0x00),
+    m_isBlockCacheEnabled(false),
+    m_isBlockExitRequested(false),
+    m_pDecodedOperand(nullptr),
+    m_ROMBank(0x0001),
+    m_blockCycles(0),
+    m_isIdleLoopSkippingEnabled(false),
+    m_idleCyclesSkipped(0)
+{
     /*
         Initialize the register map.
 
@@ -644,6 +711,10 @@ CPU::CPU() :
     m_UShortRegisterMap[0x01] = &m_DE;
     m_UShortRegisterMap[0x02] = &m_HL;
     m_UShortRegisterMap[0x03] = &m_SP;
+
+#if CPU_JIT
+    InitializeTranslatedInstructions(std::make_index_sequence<0xFF + 1>());
+#endif
 }
 
 CPU::~CPU()
@@ -662,6 +733,20 @@ bool CPU::Initialize(IMMU* pMMU, bool isFromTest)
     // Create the MMU
     m_MMU = std::unique_ptr<IMMU>(pMMU);
 
+    // The tests drive the MMU directly and expect Step to run a single instruction
+    m_isBlockCacheEnabled = !isFromTest;
+
+    // Create the Scheduler, the tests run without any scheduled units
+    m_scheduler = std::make_unique<Scheduler>();
+
+#if CPU_JIT
+    if (!isFromTest)
+    {
+        // Without the JIT, the decoded blocks are interpreted
+        InitializeJIT();
+    }
+#endif
+
     if (!isFromTest)
     {
         // Create the Cartridge
@@ -697,6 +782,10 @@ bool CPU::Initialize(IMMU* pMMU, bool isFromTest)
         m_MMU->RegisterMemoryUnit(0xFF51, 0xFF55, m_GPU.get());
         m_MMU->RegisterMemoryUnit(0xFF57, 0xFF6B, m_GPU.get());
         m_MMU->RegisterMemoryUnit(0xFF6D, 0xFF6F, m_GPU.get());
+
+        m_scheduler->AddUnit(m_GPU.get(), 0xFF40, 0xFF6F, false);
+        m_scheduler->AddUnit(m_timer.get(), 0xFF04, 0xFF07, false);
+        m_scheduler->AddUnit(m_APU.get(), 0xFF10, 0xFF3F, true);
     }
 
     return true;
@@ -730,6 +819,7 @@ bool CPU::LoadROM(const char* bootROMPath, const char* cartridgePath)
         m_MMU->Write(0xFF06, 0x00);  // TMA
         m_MMU->Write(0xFF07, 0x00);  // TAC
 
+        m_MMU->Write(0xFF26, 0xF1);  // NR52 (first, the other sound registers ignore writes while it is off)
         m_MMU->Write(0xFF10, 0x80);  // NR10
         m_MMU->Write(0xFF11, 0xBF);  // NR11
         m_MMU->Write(0xFF12, 0xF3);  // NR12
@@ -747,7 +837,6 @@ bool CPU::LoadROM(const char* bootROMPath, const char* cartridgePath)
         m_MMU->Write(0xFF23, 0xBF);  // NR30
         m_MMU->Write(0xFF24, 0x77);  // NR50
         m_MMU->Write(0xFF25, 0xF3);  // NR51
-        m_MMU->Write(0xFF26, 0xF1);  // NR52
 
         m_MMU->Write(0xFF40, 0x91);  // LCDC
         m_MMU->Write(0xFF42, 0x00);  // SCY
@@ -764,7 +853,19 @@ bool CPU::LoadROM(const char* bootROMPath, const char* cartridgePath)
         m_GPU->PreBoot();
     }
 
-    return m_cartridge->LoadROM(cartridgePath);
+    if (!m_cartridge->LoadROM(cartridgePath))
+    {
+        return false;
+    }
+
+    m_cartridge->MapMemory(m_MMU.get());
+    m_ROMBank = m_cartridge->GetROMBank();
+
+    // The registers above were written without the scheduler, or the copies of IE and IF
+    m_scheduler->Start(m_cycles);
+    m_IE = m_MMU->Read(0xFFFF);
+    m_IF = m_MMU->Read(0xFF0F);
+    return true;
 }
 
 int CPU::Step()
@@ -777,72 +878,123 @@ int CPU::Step()
         // The CPU will be unhalted on any triggered interrupt
         // Thanks to /r/binjimint for finding this pesky bug!
         cycles = NOP(0x00);
+
+        // Nothing changes until the next interrupt producing event, so skip straight to it
+        cycles = std::max(cycles, GetCyclesUntilNextEvent());
     }
     else
     {
-        ushort addr = m_PC;
+        if (m_isBlockCacheEnabled)
+        {
+            // Run the decoded block at m_PC, if the code there can be cached
+            DecodedBlock* pBlock = GetDecodedBlock(m_PC);
+            if (pBlock != nullptr)
+            {
+                if (m_isIdleLoopSkippingEnabled && pBlock->idleLoopAddress != 0x0000)
+                {
+                    return RunIdleLoop(pBlock);
+                }
+
+#if CPU_JIT
+                if (pBlock->pCompiled != nullptr)
+                {
+                    return RunCompiledBlock(pBlock);
+                }
+
+                // Only ROM code is compiled, RAM code may modify itself
+                if (++pBlock->runCount == JITThreshold && pBlock->startAddress <= 0x7FFF && m_JIT != nullptr)
+                {
+                    CompileDecodedBlock(pBlock);
+                }
+#endif
+                return RunDecodedBlock(pBlock);
+            }
+        }
+
         // Read through the memory, starting at m_PC
         byte opCode = ReadBytePC();
-        opCodeFunction instruction; // Execute the correct function for each OpCode
 
+        // Execute the correct function for each OpCode
         if (opCode == 0xCB)
         {
-            opCode = ReadBytePC();
-            instruction = m_operationMapCB[opCode];
+            cycles = ExecuteCB(ReadBytePC());
         }
         else
         {
-            instruction = m_operationMap[opCode];
+            cycles = Execute(opCode);
         }
+    }
 
-        if (instruction != nullptr)
-        {
-            cycles = (this->*instruction)(opCode);
-        }
-        else
-        {
-            Logger::LogError("OpCode 0x%02X at address 0x%04X could not be interpreted.", opCode, addr);
-            HALT(0x76);
-        }
+#if CPU_LAZY_FLAGS
+    // Keep F exact between single stepped instructions
+    MaterializeFlags();
+#endif
+
+    AdvanceCycles(cycles);
+    HandleInterrupts();
+    return cycles;
+}
+
+// Runs for at least the given number of cycles, returns the number of cycles run
+unsigned long CPU::RunCycles(unsigned long cycles)
+{
+    unsigned long long start = m_cycles;
+    while (m_cycles - start < cycles)
+    {
+        CPU::Step();
     }
 
-    m_cycles += cycles;
+    return static_cast<unsigned long>(m_cycles - start);
+}
 
-    if (m_GPU != nullptr)
+/*
+    Runs a single frame, up to the GPU entering VBlank. While the LCD is off there is no VBlank, so
+    the frame is the usual 70224 cycles instead. Returns the number of cycles run.
+*/
+unsigned long CPU::RunFrame()
+{
+    unsigned long cycles = RunUntilVBlank();
+    if (m_GPU == nullptr || !m_GPU->IsLCDEnabled())
     {
-        // Step GPU by # of elapsed cycles
-        m_GPU->Step(cycles);
+        if (cycles < CyclesPerFrame)
+        {
+            cycles += RunCycles(CyclesPerFrame - cycles);
+        }
     }
 
-    if (m_timer != nullptr)
+    return cycles;
+}
+
+// Runs until the GPU enters VBlank or the LCD is off, returns the number of cycles run
+unsigned long CPU::RunUntilVBlank()
+{
+    if (m_GPU == nullptr)
     {
-        // Step the timer by the # of elapsed cycles
-        m_timer->Step(cycles);
+        return 0;
     }
 
-    if (m_APU != nullptr)
+    unsigned long long start = m_cycles;
+    unsigned long long frame = m_GPU->GetFrameCount();
+    while (m_GPU->GetFrameCount() == frame && m_GPU->IsLCDEnabled())
     {
-        // Step the audio processing unit by the # of elapsed cycles
-        m_APU->Step(cycles);
+        CPU::Step();
     }
 
-    HandleInterrupts();
-    return cycles;
+    return static_cast<unsigned long>(m_cycles - start);
 }
 
 void CPU::TriggerInterrupt(byte interrupt)
 {
-    byte IF = m_MMU->Read(0xFF0F);
-    if (interrupt == INT40) IF = SETBIT(IF, 0);
-    else if (interrupt == INT48) IF = SETBIT(IF, 1);
-    else if (interrupt == INT50) IF = SETBIT(IF, 2);
-    else if (interrupt == INT58) IF = SETBIT(IF, 3);
-    else if (interrupt == INT60) IF = SETBIT(IF, 4);
+    if (interrupt == INT40) m_IF = SETBIT(m_IF, 0);
+    else if (interrupt == INT48) m_IF = SETBIT(m_IF, 1);
+    else if (interrupt == INT50) m_IF = SETBIT(m_IF, 2);
+    else if (interrupt == INT58) m_IF = SETBIT(m_IF, 3);
+    else if (interrupt == INT60) m_IF = SETBIT(m_IF, 4);
 
     // If we were halted, wake up
     m_isHalted = false;
 
-    m_MMU->Write(0xFF0F, IF);
+    m_MMU->Write(0xFF0F, m_IF);
 }
 
 byte* CPU::GetCurrentFrame()
@@ -855,11 +1007,79 @@ void CPU::SetInput(byte input, byte buttons)
     m_joypad->SetInput(input, buttons);
 }
 
+void CPU::SetIdleLoopSkipping(bool isEnabled)
+{
+    m_isIdleLoopSkippingEnabled = isEnabled;
+}
+
+unsigned long long CPU::GetIdleCyclesSkipped()
+{
+    return m_idleCyclesSkipped;
+}
+
 void CPU::SetVSyncCallback(void(*pCallback)())
 {
     m_GPU->SetVSyncCallback(pCallback);
 }
 
+void CPU::SetFrameSkip(unsigned int framesToSkip)
+{
+    m_GPU->SetFrameSkip(framesToSkip);
+}
+
+void CPU::RequestFrame()
+{
+    m_GPU->RequestFrame();
+}
+
+void CPU::SetFrameSink(IFrameSink* pSink)
+{
+    m_GPU->SetFrameSink(pSink);
+}
+
+bool CPU::SetPixelFormat(int pixelFormat)
+{
+    return m_GPU->SetPixelFormat(pixelFormat);
+}
+
+void CPU::GetShadePalette(unsigned int* pPalette)
+{
+    m_GPU->GetShadePalette(pPalette);
+}
+
+unsigned int CPU::ReadAudioSamples(short* pSamples, unsigned int count)
+{
+    // Bring the APU up to the current cycle first
+    m_scheduler->Synchronize(SoundOnOff, m_cycles);
+    return m_APU->ReadSamples(pSamples, count);
+}
+
+bool CPU::SetAudioOutput(bool isEnabled)
+{
+    // The APU only has deadlines while the device needs its samples
+    m_scheduler->Synchronize(SoundOnOff, m_cycles);
+    bool result = m_APU->SetAudioOutput(isEnabled);
+    m_scheduler->Reschedule(SoundOnOff);
+    return result;
+}
+
+unsigned int CPU::GetAudioQueueLevel()
+{
+    return m_APU->GetQueuedSamples();
+}
+
+unsigned int CPU::GetAudioUnderrunCount()
+{
+    return m_APU->GetUnderrunCount();
+}
+
+bool CPU::SetAudioRateAdjustment(int samplesPerSecond)
+{
+    // The APU's samples up to now were made at the old rate
+    m_scheduler->Synchronize(SoundOnOff, m_cycles);
+    return m_APU->SetSampleRateAdjustment(samplesPerSecond);
+}
+
 byte CPU::GetHighByte(ushort dest)
 {
     return ((dest >> 8) & 0xFF);
@@ -891,6 +1111,29 @@ ushort* CPU::GetUShortRegister(byte val, bool useAF)
     }
 }
 
+/*
+    Compile time versions of GetByteRegister and GetUShortRegister, used by the specialized handlers.
+    The index is a template parameter, so these fold down to the address of the register.
+*/
+template<byte index>
+byte* CPU::GetByteRegister()
+{
+    static_assert(index <= 0x07, "Byte register index out of range");
+
+    // Same layout as m_ByteRegisterMap, ushort memory is [C][B] and F is the low byte of AF
+    ushort* pair = (index <= 0x01) ? &m_BC : (index <= 0x03) ? &m_DE : (index <= 0x05) ? &m_HL : &m_AF;
+    return reinterpret_cast<byte*>(pair) + (((index & 0x01) == 0x00 && index != 0x06) || index == 0x07 ? 1 : 0);
+}
+
+template<byte index, bool useAF>
+ushort* CPU::GetUShortRegister()
+{
+    static_assert(index <= 0x03, "UShort register index out of range");
+
+    // PUSH rr and POP rr replace 0x03 (normally SP) with AF
+    return (index == 0x00) ? &m_BC : (index == 0x01) ? &m_DE : (index == 0x02) ? &m_HL : useAF ? &m_AF : &m_SP;
+}
+
 void CPU::SetHighByte(ushort* dest, byte val)
 {
     byte low = GetLowByte(*dest);
@@ -905,6 +1148,10 @@ void CPU::SetLowByte(ushort* dest, byte val)
 
 void CPU::SetFlag(byte flag)
 {
+#if CPU_LAZY_FLAGS
+    MaterializeFlags();
+#endif
+
     // This shifts the bit to the left to where the flag is
     // Then ORs it with the Flag register.
     // Finally it filters out the lower 4 bits, as they aren't used on the Gameboy
@@ -913,6 +1160,10 @@ void CPU::SetFlag(byte flag)
 
 void CPU::ClearFlag(byte flag)
 {
+#if CPU_LAZY_FLAGS
+    MaterializeFlags();
+#endif
+
     // This shifts the bit to the left to where the flag is
     // Then it inverts all of the bits
     // Then ANDs it with the Flag register.
@@ -922,19 +1173,80 @@ void CPU::ClearFlag(byte flag)
 
 bool CPU::IsFlagSet(byte flag)
 {
+#if CPU_LAZY_FLAGS
+    MaterializeFlags();
+#endif
+
     return ISBITSET(GetLowByte(m_AF), flag);
 }
 
-void CPU::PushByteToSP(byte val)
+/*
+    Records the operands and result of an 8-bit ALU instruction, which determine all of Z/N/H/C.
+    With CPU_LAZY_FLAGS, the flags are only computed when something needs F, so the flags of an
+    instruction whose flags are overwritten before being read are never computed at all.
+*/
+void CPU::SetALUFlags(byte op, byte a, byte b, byte carry, byte result)
+{
+    m_lazyFlagsOp = op;
+    m_lazyFlagsA = a;
+    m_lazyFlagsB = b;
+    m_lazyFlagsCarry = carry;
+    m_lazyFlagsResult = result;
+
+#if !CPU_LAZY_FLAGS
+    MaterializeFlags();
+#endif
+}
+
+void CPU::MaterializeFlags()
 {
-    m_SP--;
-    m_MMU->Write(m_SP, val);
+    if (m_lazyFlagsOp == LazyFlagsNone)
+    {
+        return;
+    }
+
+    byte flags = (m_lazyFlagsResult == 0x00) ? SETBIT(0x00, ZeroFlag) : 0x00;
+
+    switch (m_lazyFlagsOp)
+    {
+    case LazyFlagsAdd:
+        if (((m_lazyFlagsA & 0x0F) + (m_lazyFlagsB & 0x0F) + m_lazyFlagsCarry) > 0x0F)
+        {
+            flags = SETBIT(flags, HalfCarryFlag);
+        }
+        if ((m_lazyFlagsA + m_lazyFlagsB + m_lazyFlagsCarry) > 0xFF)
+        {
+            flags = SETBIT(flags, CarryFlag);
+        }
+        break;
+    case LazyFlagsSub:
+        flags = SETBIT(flags, SubtractFlag);
+        if ((m_lazyFlagsA & 0x0F) < ((m_lazyFlagsB & 0x0F) + m_lazyFlagsCarry))
+        {
+            flags = SETBIT(flags, HalfCarryFlag);
+        }
+        if (m_lazyFlagsA < (m_lazyFlagsB + m_lazyFlagsCarry))
+        {
+            flags = SETBIT(flags, CarryFlag);
+        }
+        break;
+    case LazyFlagsAnd:
+        // Affects Z, sets H and clears NC
+        flags = SETBIT(flags, HalfCarryFlag);
+        break;
+    case LazyFlagsOr:
+        // Affects Z and clears NHC
+        break;
+    }
+
+    SetLowByte(&m_AF, flags);
+    m_lazyFlagsOp = LazyFlagsNone;
 }
 
 void CPU::PushUShortToSP(ushort val)
 {
-    PushByteToSP(GetHighByte(val));
-    PushByteToSP(GetLowByte(val));
+    m_SP -= 2;
+    WriteUShort(m_SP, val);
 }
 
 ushort CPU::PopUShort()
@@ -946,33 +1258,136 @@ ushort CPU::PopUShort()
 
 byte CPU::PopByte()
 {
-    byte val = m_MMU->Read(m_SP);
+    byte val = ReadByte(m_SP);
     m_SP++;
     return val;
 }
 
 byte CPU::ReadBytePC()
 {
-    byte val = m_MMU->Read(m_PC);
+    byte val;
+    if (m_pDecodedOperand != nullptr)
+    {
+        // The operands of a decoded instruction come from the block cache
+        val = *m_pDecodedOperand++;
+    }
+    else
+    {
+        val = m_MMU->Read(m_PC);
+    }
+
     m_PC++;
     return val;
 }
 
 ushort CPU::ReadUShortPC()
 {
-    ushort val = m_MMU->ReadUShort(m_PC);
+    ushort val;
+    if (m_pDecodedOperand != nullptr)
+    {
+        // The operands of a decoded instruction come from the block cache
+        val = (m_pDecodedOperand[1] << 8) | m_pDecodedOperand[0];
+        m_pDecodedOperand += 2;
+    }
+    else
+    {
+        val = m_MMU->ReadUShort(m_PC);
+    }
+
     m_PC += 2;
     return val;
 }
 
+// Reads memory, after stepping the unit owning the register being read up to the current cycle
+byte CPU::ReadByte(const ushort& address)
+{
+    if (address >= 0xFF00)
+    {
+        m_scheduler->Synchronize(address, m_cycles);
+    }
+
+    return m_MMU->Read(address);
+}
+
+void CPU::WriteByte(const ushort& address, const byte val)
+{
+    if (address >= 0xFF00)
+    {
+        m_scheduler->Synchronize(address, m_cycles);
+        m_MMU->Write(address, val);
+
+        // The write may change when the unit owning the register has its next event
+        m_scheduler->Reschedule(address);
+
+        if (address == 0xFFFF)
+        {
+            m_IE = val;
+        }
+        else if (address == 0xFF0F)
+        {
+            m_IF = val;
+        }
+    }
+    else
+    {
+        m_MMU->Write(address, val);
+    }
+
+    if (address <= 0x7FFF)
+    {
+        // A write to the MBC may switch the ROM bank under the block being run
+        if (m_cartridge != nullptr)
+        {
+            m_cartridge->MapMemory(m_MMU.get());
+            m_ROMBank = m_cartridge->GetROMBank();
+        }
+
+        m_isBlockExitRequested = true;
+    }
+    else if (address >= 0xE000 && address <= 0xFDFF)
+    {
+        // Echo of 0xC000-0xDDFF
+        InvalidateDecodedBlocks(address - 0x2000);
+    }
+    else if (address == 0xFF50)
+    {
+        // The boot ROM is being unmapped, drop any blocks decoded from it
+        for (unsigned int index = 0x0000; index <= 0x00FF; index++)
+        {
+            m_decodedBlocks.erase(index);
+        }
+
+        m_isBlockExitRequested = true;
+    }
+    else
+    {
+        InvalidateDecodedBlocks(address);
+    }
+}
+
+/*
+    Writes the high byte, then the low byte. Within a single page of VRAM, cartridge RAM, or WRAM
+    the MMU stores both bytes at once wherever the page is mapped straight to memory.
+*/
+void CPU::WriteUShort(const ushort& address, const ushort val)
+{
+    if (address >= 0x8000 && address <= 0xDFFE && (address & 0xFF) != 0xFF)
+    {
+        m_MMU->WriteUShort(address, val);
+        InvalidateDecodedBlocks(address);
+        InvalidateDecodedBlocks(address + 1);
+    }
+    else
+    {
+        WriteByte(address + 1, GetHighByte(val));
+        WriteByte(address, GetLowByte(val));
+    }
+}
+
 byte CPU::AddByte(byte b1, byte b2)
 {
     byte val = b1 + b2;
-
-    ClearFlag(SubtractFlag);
-    (val == 0x00) ? SetFlag(ZeroFlag) : ClearFlag(ZeroFlag);
-    (((val ^ b2 ^ b1) & 0x10) == 0x10) ? SetFlag(HalfCarryFlag) : ClearFlag(HalfCarryFlag);
-    (val < b1) ? SetFlag(CarryFlag) : ClearFlag(CarryFlag);
+    SetALUFlags(LazyFlagsAdd, b1, b2, 0x00, val);
 
     return val;
 }
@@ -993,62 +1408,61 @@ void CPU::ADC(byte val)
     byte A = GetHighByte(m_AF);
     byte C = (IsFlagSet(CarryFlag)) ? 0x01 : 0x00;
 
-    ClearFlag(SubtractFlag);
-
-    if (((int)(A & 0x0F) + (int)(val & 0x0F) + (int)C) > 0x0F)
-    {
-        SetFlag(HalfCarryFlag);
-    }
-    else
-    {
-        ClearFlag(HalfCarryFlag);
-    }
-
-    if (((int)(A & 0xFF) + (int)(val & 0xFF) + (int)C) > 0xFF)
-    {
-        SetFlag(CarryFlag);
-    }
-    else
-    {
-        ClearFlag(CarryFlag);
-    }
-
     byte result = A + val + C;
     SetHighByte(&m_AF, result);
-
-    (result == 0x00) ? SetFlag(ZeroFlag) : ClearFlag(ZeroFlag);
+    SetALUFlags(LazyFlagsAdd, A, val, C, result);
 }
 
 void CPU::SBC(byte val)
 {
-    int un = (int)val & 0xFF;
-    int tmpa = (int)GetHighByte(m_AF) & 0xFF;
-    int ua = tmpa;
+    byte A = GetHighByte(m_AF);
+    byte C = (IsFlagSet(CarryFlag)) ? 0x01 : 0x00;
 
-    ua -= un;
+    byte result = A - val - C;
+    SetHighByte(&m_AF, result);
+    SetALUFlags(LazyFlagsSub, A, val, C, result);
+}
 
-    if (IsFlagSet(CarryFlag))
+/*
+    Returns the number of cycles the components can be stepped at once while halted, which is the
+    distance to the next event that can raise an interrupt, rounded up to a whole NOP.
+    The Serial port is not clocked, so it never raises an interrupt on its own.
+*/
+unsigned long CPU::GetCyclesUntilNextEvent()
+{
+    if (m_IME == 0x01)
     {
-        ua -= 1;
-    }
-
-    SetFlag(SubtractFlag);
-    (ua < 0) ? SetFlag(CarryFlag) : ClearFlag(CarryFlag);
-
-    ua &= 0xFF;
+        // An interrupt is about to be handled, see HandleInterrupts
+        if (((m_IE & m_IF) & 0x0F) != 0x00)
+        {
+            return 0;
+        }
+    }
 
-    (ua == 0x00) ? SetFlag(ZeroFlag) : ClearFlag(ZeroFlag);
+    unsigned long cycles = MaxHaltCycles;
 
-    if (((ua ^ un ^ tmpa) & 0x10) == 0x10)
+    unsigned long long nextEvent = m_scheduler->GetNextEvent();
+    if (nextEvent <= m_cycles)
     {
-        SetFlag(HalfCarryFlag);
+        return 0;
     }
-    else
+    else if (nextEvent - m_cycles < cycles)
     {
-        ClearFlag(HalfCarryFlag);
+        cycles = static_cast<unsigned long>(nextEvent - m_cycles);
     }
 
-    SetHighByte(&m_AF, (byte)ua);
+    return (cycles + 0x03) & ~0x03UL;
+}
+
+void CPU::AdvanceCycles(unsigned long cycles)
+{
+    m_cycles += cycles;
+
+    // The GPU, Timer, and APU are only stepped once one of them has an event due
+    if (m_cycles >= m_scheduler->GetNextEvent())
+    {
+        m_scheduler->RunEvents(m_cycles);
+    }
 }
 
 void CPU::HandleInterrupts()
@@ -1057,54 +1471,37 @@ void CPU::HandleInterrupts()
     // an interrupt flag is set, handle the interrupt.
     if (m_IME == 0x01)
     {
-        byte IE = m_MMU->Read(0xFFFF);
-        byte IF = m_MMU->Read(0xFF0F);
-
         // This will only match valid interrupts
-        byte activeInterrupts = ((IE & IF) & 0x0F);
+        byte activeInterrupts = ((m_IE & m_IF) & 0x0F);
         if (activeInterrupts > 0x00)
         {
             m_IME = 0x00; // Disable further interrupts
 
+            byte IF = m_IF;
             PushUShortToSP(m_PC); // Push current PC onto stack
 
-            // Jump to the correct handler
-            if (ISBITSET(activeInterrupts, 0))
-            {
-                // VBlank
-                m_PC = INT40;
-                IF = CLEARBIT(IF, 0);
-            }
-            else if (ISBITSET(activeInterrupts, 1))
-            {
-                // LCD status
-                m_PC = INT48;
-                IF = CLEARBIT(IF, 1);
-            }
-            else if (ISBITSET(activeInterrupts, 2))
-            {
-                // Timer
-                m_PC = INT50;
-                IF = CLEARBIT(IF, 2);
-            }
-            else if (ISBITSET(activeInterrupts, 3))
-            {
-                // Serial
-                m_PC = INT58;
-                IF = CLEARBIT(IF, 3);
-            }
-            else if (ISBITSET(activeInterrupts, 4))
-            {
-                // Joypad
-                m_PC = INT60;
-                IF = CLEARBIT(IF, 4);
-            }
+            // Jump to the handler of the highest priority interrupt, VBlank (bit 0) first
+            byte bit = GetLowestSetBit(activeInterrupts);
+            m_PC = INT40 + (bit * 0x08);
+            m_IF = CLEARBIT(IF, bit);
 
-            m_MMU->Write(0xFF0F, IF);
+            m_MMU->Write(0xFF0F, m_IF);
         }
     }
 }
 
+// Returns the index of the lowest set bit, val must not be 0
+byte CPU::GetLowestSetBit(byte val)
+{
+#if WINDOWS
+    unsigned long index;
+    _BitScanForward(&index, val);
+    return static_cast<byte>(index);
+#else
+    return static_cast<byte>(__builtin_ctz(val));
+#endif
+}
+
 /*
     CPU INSTRUCTION MAP
 */
@@ -1129,7 +1526,7 @@ unsigned long CPU::NOP(const byte& opCode)
 */
 unsigned long CPU::LD_BC_A(const byte& opCode)
 {
-    m_MMU->Write(m_BC, GetHighByte(m_AF));
+    WriteByte(m_BC, GetHighByte(m_AF));
     return 8;
 }
 
@@ -1178,10 +1575,11 @@ unsigned long CPU::RLCA(const byte& opCode)
 
     Flags affected(znhc): ----
 */
+template<byte rIndex>
 unsigned long CPU::LDrn(const byte& opCode)
 {
     byte n = ReadBytePC();
-    byte* r = GetByteRegister(opCode >> 3);
+    byte* r = GetByteRegister<rIndex>();
     (*r) = n;
 
     return 8;
@@ -1198,10 +1596,11 @@ unsigned long CPU::LDrn(const byte& opCode)
 
     Flags affected(znhc): ----
 */
+template<byte rIndex, byte RIndex>
 unsigned long CPU::LDrR(const byte& opCode)
 {
-    byte* r = GetByteRegister(opCode >> 3);
-    byte* R = GetByteRegister(opCode);
+    byte* r = GetByteRegister<rIndex>();
+    byte* R = GetByteRegister<RIndex>();
     (*r) = *R;
 
     return 4;
@@ -1218,11 +1617,12 @@ unsigned long CPU::LDrR(const byte& opCode)
 
     Flags affected(znhc): ----
 */
+template<byte rIndex>
 unsigned long CPU::LDr_HL_(const byte& opCode)
 {
-    byte* r = GetByteRegister(opCode >> 3);
+    byte* r = GetByteRegister<rIndex>();
 
-    (*r) = m_MMU->Read(m_HL);
+    (*r) = ReadByte(m_HL);
 
     return 8;
 }
@@ -1239,10 +1639,11 @@ unsigned long CPU::LDr_HL_(const byte& opCode)
 
     Flags affected(znhc): ----
 */
+template<byte rIndex>
 unsigned long CPU::LD_HL_r(const byte& opCode)
 {
-    byte* r = GetByteRegister(opCode);
-    m_MMU->Write(m_HL, (*r)); // Load r into the address pointed at by HL.
+    byte* r = GetByteRegister<rIndex>();
+    WriteByte(m_HL, (*r)); // Load r into the address pointed at by HL.
 
     return 8;
 }
@@ -1259,9 +1660,10 @@ unsigned long CPU::LD_HL_r(const byte& opCode)
 
     Flags affected(znhc): ----
 */
+template<byte rrIndex>
 unsigned long CPU::LDrrnn(const byte& opCode)
 {
-    ushort* rr = GetUShortRegister(opCode >> 4, false);
+    ushort* rr = GetUShortRegister<rrIndex, false>();
     ushort nn = ReadUShortPC(); // Read nn
     (*rr) = nn;
 
@@ -1278,9 +1680,10 @@ unsigned long CPU::LDrrnn(const byte& opCode)
 
     Flags affected(znhc): z0h-
 */
+template<byte rIndex>
 unsigned long CPU::INCr(const byte& opCode)
 {
-    byte* r = GetByteRegister(opCode >> 3);
+    byte* r = GetByteRegister<rIndex>();
     bool isBit3Before = ISBITSET(*r, 3);
     *r += 1;
     bool isBit3After = ISBITSET(*r, 3);
@@ -1322,12 +1725,13 @@ unsigned long CPU::INCr(const byte& opCode)
 
     Flags affected(znhc): ----
 */
+template<byte cc>
 unsigned long CPU::CALLccnn(const byte& opCode)
 {
     ushort nn = ReadUShortPC();
 
     bool check = false;
-    switch ((opCode >> 3) & 0x03)
+    switch (cc)
     {
     case 0x00:  // NZ
         check = !IsFlagSet(ZeroFlag);
@@ -1369,10 +1773,11 @@ unsigned long CPU::CALLccnn(const byte& opCode)
 
     Flags affected(znhc): ----
 */
+template<byte cc>
 unsigned long CPU::RETcc(const byte& opCode)
 {
     bool check = false;
-    switch ((opCode >> 3) & 0x03)
+    switch (cc)
     {
     case 0x00:  // NZ
         check = !IsFlagSet(ZeroFlag);
@@ -1413,9 +1818,8 @@ unsigned long CPU::LD_nn_SP(const byte& opCode)
 {
     ushort nn = ReadUShortPC();
 
-    // Load A into (nn)
-    m_MMU->Write(nn + 1, GetHighByte(m_SP));
-    m_MMU->Write(nn, GetLowByte(m_SP));
+    // Load SP into (nn)
+    WriteUShort(nn, m_SP);
 
     return 20;
 }
@@ -1431,9 +1835,10 @@ unsigned long CPU::LD_nn_SP(const byte& opCode)
 
     Flags affected(znhc): -0hc
 */
+template<byte ssIndex>
 unsigned long CPU::ADDHLss(const byte& opCode)
 {
-    ushort* ss = GetUShortRegister(opCode >> 4, false);
+    ushort* ss = GetUShortRegister<ssIndex, false>();
 
     m_HL = AddUShort(m_HL, *ss);
 
@@ -1477,12 +1882,13 @@ unsigned long CPU::ADDSPdd(const byte& opCode)
 
     Flags affected(znhc): ----
 */
+template<byte cc>
 unsigned long CPU::JPccnn(const byte& opCode)
 {
     ushort nn = ReadUShortPC();
 
     bool check = false;
-    switch ((opCode >> 3) & 0x03)
+    switch (cc)
     {
     case 0x00:  // NZ
         check = !IsFlagSet(ZeroFlag);
@@ -1521,10 +1927,11 @@ unsigned long CPU::JPccnn(const byte& opCode)
 
     Flags affected(znhc): z0hc
 */
+template<byte rIndex>
 unsigned long CPU::ADDAr(const byte& opCode)
 {
     byte A = GetHighByte(m_AF);
-    byte* r = GetByteRegister(opCode);
+    byte* r = GetByteRegister<rIndex>();
 
     SetHighByte(&m_AF, AddByte(A, *r));
 
@@ -1543,9 +1950,10 @@ unsigned long CPU::ADDAr(const byte& opCode)
 
     Flags affected(znhc): z0hc
 */
+template<byte rIndex>
 unsigned long CPU::ADCAr(const byte& opCode)
 {
-    byte* r = GetByteRegister(opCode);
+    byte* r = GetByteRegister<rIndex>();
     ADC(*r);
     return 4;
 }
@@ -1564,12 +1972,13 @@ unsigned long CPU::ADCAr(const byte& opCode)
 
     Flags affected(znhc): ----
 */
+template<byte cc>
 unsigned long CPU::JRcce(const byte& opCode)
 {
     sbyte arg = static_cast<sbyte>(ReadBytePC());
 
     bool check = false;
-    switch ((opCode >> 3) & 0x03)
+    switch (cc)
     {
     case 0x00:  // NZ
         check = !IsFlagSet(ZeroFlag);
@@ -1613,10 +2022,9 @@ unsigned long CPU::JRcce(const byte& opCode)
 
     Flags affected(znhc): ----
 */
+template<byte t>
 unsigned long CPU::RSTn(const byte& opCode)
 {
-    byte t = ((opCode >> 3) & 0x07);
-
     PushUShortToSP(m_PC);
     m_PC = (ushort)(t * 0x08);
     return 16;
@@ -1634,24 +2042,14 @@ unsigned long CPU::RSTn(const byte& opCode)
 
     Flags affected(znhc): z010
 */
+template<byte rIndex>
 unsigned long CPU::ANDr(const byte& opCode)
 {
-    byte* r = GetByteRegister(opCode);
+    byte* r = GetByteRegister<rIndex>();
     byte result = (*r) & GetHighByte(m_AF);
     SetHighByte(&m_AF, result);
 
-    if (result == 0x00)
-    {
-        SetFlag(ZeroFlag);
-    }
-    else
-    {
-        ClearFlag(ZeroFlag);
-    }
-
-    ClearFlag(SubtractFlag);
-    SetFlag(HalfCarryFlag);
-    ClearFlag(CarryFlag);
+    SetALUFlags(LazyFlagsAnd, 0x00, 0x00, 0x00, result);
 
     return 4;
 }
@@ -1668,16 +2066,14 @@ unsigned long CPU::ANDr(const byte& opCode)
 
     Flags affected(znhc): z1hc
 */
+template<byte rIndex>
 unsigned long CPU::CPr(const byte& opCode)
 {
-    byte* r = GetByteRegister(opCode);
+    byte* r = GetByteRegister<rIndex>();
     byte A = GetHighByte(m_AF);
     byte result = A - (*r);
 
-    (result == 0x00) ? SetFlag(ZeroFlag) : ClearFlag(ZeroFlag);
-    SetFlag(SubtractFlag);
-    ((A & 0xFF) < ((*r) & 0xFF)) ? SetFlag(CarryFlag) : ClearFlag(CarryFlag);
-    ((A & 0x0F) < ((*r) & 0x0F)) ? SetFlag(HalfCarryFlag) : ClearFlag(HalfCarryFlag);
+    SetALUFlags(LazyFlagsSub, A, (*r), 0x00, result);
 
     return 4;
 }
@@ -1692,9 +2088,10 @@ unsigned long CPU::CPr(const byte& opCode)
 
     Flags affected(znhc): ----
 */
+template<byte rrIndex>
 unsigned long CPU::INCrr(const byte& opCode)
 {
-    ushort* rr = GetUShortRegister(opCode >> 4, false);
+    ushort* rr = GetUShortRegister<rrIndex, false>();
     *rr += 1;
 
     return 8;
@@ -1710,9 +2107,10 @@ unsigned long CPU::INCrr(const byte& opCode)
 
     Flags affected(znhc): ----
 */
+template<byte rrIndex>
 unsigned long CPU::DECrr(const byte& opCode)
 {
-    ushort* rr = GetUShortRegister(opCode >> 4, false);
+    ushort* rr = GetUShortRegister<rrIndex, false>();
     *rr -= 1;
 
     return 8;
@@ -1730,24 +2128,14 @@ unsigned long CPU::DECrr(const byte& opCode)
 
     Flags affected(znhc): z000
 */
+template<byte rIndex>
 unsigned long CPU::XORr(const byte& opCode)
 {
-    byte* r = GetByteRegister(opCode);
-    SetHighByte(&m_AF, *r ^ GetHighByte(m_AF));
-
-    // Affects Z and clears NHC
-    if (GetHighByte(m_AF) == 0x00)
-    {
-        SetFlag(ZeroFlag);
-    }
-    else
-    {
-        ClearFlag(ZeroFlag);
-    }
+    byte* r = GetByteRegister<rIndex>();
+    byte result = (*r) ^ GetHighByte(m_AF);
+    SetHighByte(&m_AF, result);
 
-    ClearFlag(SubtractFlag);
-    ClearFlag(HalfCarryFlag);
-    ClearFlag(CarryFlag);
+    SetALUFlags(LazyFlagsOr, 0x00, 0x00, 0x00, result);
 
     return 4;
 }
@@ -1764,22 +2152,11 @@ unsigned long CPU::XORr(const byte& opCode)
 */
 unsigned long CPU::XOR_HL_(const byte& opCode)
 {
-    byte r = m_MMU->Read(m_HL);
-    SetHighByte(&m_AF, r ^ GetHighByte(m_AF));
+    byte HL = ReadByte(m_HL);
+    byte result = HL ^ GetHighByte(m_AF);
+    SetHighByte(&m_AF, result);
 
-    // Affects Z and clears NHC
-    if (GetHighByte(m_AF) == 0x00)
-    {
-        SetFlag(ZeroFlag);
-    }
-    else
-    {
-        ClearFlag(ZeroFlag);
-    }
-
-    ClearFlag(SubtractFlag);
-    ClearFlag(HalfCarryFlag);
-    ClearFlag(CarryFlag);
+    SetALUFlags(LazyFlagsOr, 0x00, 0x00, 0x00, result);
 
     return 8;
 }
@@ -1796,24 +2173,14 @@ unsigned long CPU::XOR_HL_(const byte& opCode)
 
     Flags affected(znhc): z000
 */
+template<byte rIndex>
 unsigned long CPU::ORr(const byte& opCode)
 {
-    byte* r = GetByteRegister(opCode);
-    SetHighByte(&m_AF, *r | GetHighByte(m_AF));
-
-    // Affects Z and clears NHC
-    if (GetHighByte(m_AF) == 0x00)
-    {
-        SetFlag(ZeroFlag);
-    }
-    else
-    {
-        ClearFlag(ZeroFlag);
-    }
+    byte* r = GetByteRegister<rIndex>();
+    byte result = (*r) | GetHighByte(m_AF);
+    SetHighByte(&m_AF, result);
 
-    ClearFlag(SubtractFlag);
-    ClearFlag(HalfCarryFlag);
-    ClearFlag(CarryFlag);
+    SetALUFlags(LazyFlagsOr, 0x00, 0x00, 0x00, result);
 
     return 4;
 }
@@ -1830,22 +2197,11 @@ unsigned long CPU::ORr(const byte& opCode)
 */
 unsigned long CPU::OR_HL_(const byte& opCode)
 {
-    byte r = m_MMU->Read(m_HL);
-    SetHighByte(&m_AF, r | GetHighByte(m_AF));
+    byte HL = ReadByte(m_HL);
+    byte result = HL | GetHighByte(m_AF);
+    SetHighByte(&m_AF, result);
 
-    // Affects Z and clears NHC
-    if (GetHighByte(m_AF) == 0x00)
-    {
-        SetFlag(ZeroFlag);
-    }
-    else
-    {
-        ClearFlag(ZeroFlag);
-    }
-
-    ClearFlag(SubtractFlag);
-    ClearFlag(HalfCarryFlag);
-    ClearFlag(CarryFlag);
+    SetALUFlags(LazyFlagsOr, 0x00, 0x00, 0x00, result);
 
     return 8;
 }
@@ -1865,9 +2221,16 @@ unsigned long CPU::OR_HL_(const byte& opCode)
 
     Flags affected(znhc): ----
 */
+template<byte rrIndex>
 unsigned long CPU::PUSHrr(const byte& opCode)
 {
-    ushort* rr = GetUShortRegister(opCode >> 4, true);
+    if (rrIndex == 0x03)
+    {
+        // PUSH AF needs the flags in F
+        MaterializeFlags();
+    }
+
+    ushort* rr = GetUShortRegister<rrIndex, true>();
     PushUShortToSP(*rr);
 
     return 16;
@@ -1887,14 +2250,10 @@ unsigned long CPU::PUSHrr(const byte& opCode)
 unsigned long CPU::ANDn(const byte& opCode)
 {
     byte n = ReadBytePC();
-
-    byte result = GetHighByte(m_AF) & n;
+    byte result = n & GetHighByte(m_AF);
     SetHighByte(&m_AF, result);
 
-    (result == 0x00) ? SetFlag(ZeroFlag) : ClearFlag(ZeroFlag);
-    ClearFlag(SubtractFlag);
-    SetFlag(HalfCarryFlag);
-    ClearFlag(CarryFlag);
+    SetALUFlags(LazyFlagsAnd, 0x00, 0x00, 0x00, result);
 
     return 8;
 }
@@ -1929,14 +2288,18 @@ unsigned long CPU::JP_HL_(const byte& opCode)
 
     Flags affected(znhc): ----
 */
+template<byte rrIndex>
 unsigned long CPU::POPrr(const byte& opCode)
 {
-    ushort* rr = GetUShortRegister(opCode >> 4, true);
+    ushort* rr = GetUShortRegister<rrIndex, true>();
     (*rr) = PopUShort();
 
-    if (((opCode >> 4) & 0x03) == 0x03)
+    if (rrIndex == 0x03)
     {
         (*rr) &= 0xFFF0;
+
+        // POP AF replaces the flags entirely
+        m_lazyFlagsOp = LazyFlagsNone;
     }
 
     return 12;
@@ -1952,9 +2315,10 @@ unsigned long CPU::POPrr(const byte& opCode)
 
     Flags affected(znhc): z1h-
 */
+template<byte rIndex>
 unsigned long CPU::DECr(const byte& opCode)
 {
-    byte* r = GetByteRegister(opCode >> 3);
+    byte* r = GetByteRegister<rIndex>();
     byte calc = (*r - 1);
 
     SetFlag(SubtractFlag);
@@ -1985,12 +2349,12 @@ unsigned long CPU::DECr(const byte& opCode)
 */
 unsigned long CPU::INC_HL_(const byte& opCode)
 {
-    byte HL = m_MMU->Read(m_HL);
+    byte HL = ReadByte(m_HL);
     bool isBit3Before = ISBITSET(HL, 3);
     HL += 1;
     bool isBit3After = ISBITSET(HL, 3);
 
-    m_MMU->Write(m_HL, HL);
+    WriteByte(m_HL, HL);
 
     if (HL == 0x00)
     {
@@ -2026,7 +2390,7 @@ unsigned long CPU::INC_HL_(const byte& opCode)
 */
 unsigned long CPU::DEC_HL_(const byte& opCode)
 {
-    byte val = m_MMU->Read(m_HL);
+    byte val = ReadByte(m_HL);
     byte calc = (val - 1);
 
     SetFlag(SubtractFlag);
@@ -2041,7 +2405,7 @@ unsigned long CPU::DEC_HL_(const byte& opCode)
         ClearFlag(HalfCarryFlag);
     }
 
-    m_MMU->Write(m_HL, calc);
+    WriteByte(m_HL, calc);
 
     return 12;
 }
@@ -2059,7 +2423,7 @@ unsigned long CPU::DEC_HL_(const byte& opCode)
 unsigned long CPU::LD_HL_n(const byte& opCode)
 {
     byte n = ReadBytePC();
-    m_MMU->Write(m_HL, n); // Load n into the address pointed at by HL.
+    WriteByte(m_HL, n); // Load n into the address pointed at by HL.
 
     return 12;
 }
@@ -2111,17 +2475,15 @@ unsigned long CPU::CCF(const byte& opCode)
 
     Flags affected(znhc): z1hc
 */
+template<byte rIndex>
 unsigned long CPU::SUBr(const byte& opCode)
 {
-    byte* r = GetByteRegister(opCode);
+    byte* r = GetByteRegister<rIndex>();
     byte A = GetHighByte(m_AF);
     byte result = A - (*r);
     SetHighByte(&m_AF, result);
 
-    (result == 0x00) ? SetFlag(ZeroFlag) : ClearFlag(ZeroFlag);
-    SetFlag(SubtractFlag);
-    ((A & 0x0F) < ((*r) & 0x0F)) ? SetFlag(HalfCarryFlag) : ClearFlag(HalfCarryFlag);
-    ((A & 0xFF) < ((*r) & 0xFF)) ? SetFlag(CarryFlag) : ClearFlag(CarryFlag);
+    SetALUFlags(LazyFlagsSub, A, (*r), 0x00, result);
 
     return 4;
 }
@@ -2137,9 +2499,10 @@ unsigned long CPU::SUBr(const byte& opCode)
 
     Flags affected(znhc): z1hc
 */
+template<byte rIndex>
 unsigned long CPU::SBCAr(const byte& opCode)
 {
-    byte* r = GetByteRegister(opCode);
+    byte* r = GetByteRegister<rIndex>();
     SBC(*r);
     return 4;
 }
@@ -2171,7 +2534,7 @@ unsigned long CPU::STOP(const byte& opCode)
 */
 unsigned long CPU::LD_DE_A(const byte& opCode)
 {
-    m_MMU->Write(m_DE, GetHighByte(m_AF));
+    WriteByte(m_DE, GetHighByte(m_AF));
     return 8;
 }
 
@@ -2228,7 +2591,7 @@ unsigned long CPU::JRe(const byte& opCode)
 */
 unsigned long CPU::LDA_DE_(const byte& opCode)
 {
-    byte val = m_MMU->Read(m_DE);
+    byte val = ReadByte(m_DE);
     SetHighByte(&m_AF, val);
     return 8;
 }
@@ -2244,7 +2607,7 @@ unsigned long CPU::LDA_DE_(const byte& opCode)
 */
 unsigned long CPU::LDA_BC_(const byte& opCode)
 {
-    byte val = m_MMU->Read(m_BC);
+    byte val = ReadByte(m_BC);
     SetHighByte(&m_AF, val);
 
     return 8;
@@ -2327,7 +2690,7 @@ unsigned long CPU::RRA(const byte& opCode)
 */
 unsigned long CPU::LDI_HL_A(const byte& opCode)
 {
-    m_MMU->Write(m_HL, GetHighByte(m_AF)); // Load A into the address pointed at by HL.
+    WriteByte(m_HL, GetHighByte(m_AF)); // Load A into the address pointed at by HL.
 
     m_HL++;
 
@@ -2416,7 +2779,7 @@ unsigned long CPU::DAA(const byte& opCode)
 */
 unsigned long CPU::LDIA_HL_(const byte& opCode)
 {
-    SetHighByte(&m_AF, m_MMU->Read(m_HL));
+    SetHighByte(&m_AF, ReadByte(m_HL));
     m_HL++;
 
     return 8;
@@ -2454,7 +2817,7 @@ unsigned long CPU::CPL(const byte& opCode)
 */
 unsigned long CPU::LDD_HL_A(const byte& opCode)
 {
-    m_MMU->Write(m_HL, GetHighByte(m_AF));
+    WriteByte(m_HL, GetHighByte(m_AF));
 
     m_HL--;
     return 8;
@@ -2471,7 +2834,7 @@ unsigned long CPU::LDD_HL_A(const byte& opCode)
 */
 unsigned long CPU::LDDA_HL_(const byte& opCode)
 {
-    byte HL = m_MMU->Read(m_HL);
+    byte HL = ReadByte(m_HL);
     SetHighByte(&m_AF, HL);
 
     m_HL--;
@@ -2506,7 +2869,7 @@ unsigned long CPU::HALT(const byte& opCode)
 unsigned long CPU::ADDA_HL_(const byte& opCode)
 {
     byte A = GetHighByte(m_AF);
-    byte HL = m_MMU->Read(m_HL);
+    byte HL = ReadByte(m_HL);
     SetHighByte(&m_AF, AddByte(A, HL));
 
     return 8;
@@ -2525,7 +2888,7 @@ unsigned long CPU::ADDA_HL_(const byte& opCode)
 */
 unsigned long CPU::ADCA_HL_(const byte& opCode)
 {
-    byte HL = m_MMU->Read(m_HL);
+    byte HL = ReadByte(m_HL);
     ADC(HL);
     return 8;
 }
@@ -2544,14 +2907,11 @@ unsigned long CPU::ADCA_HL_(const byte& opCode)
 unsigned long CPU::SUB_HL_(const byte& opCode)
 {
     byte A = GetHighByte(m_AF);
-    byte HL = m_MMU->Read(m_HL);
+    byte HL = ReadByte(m_HL);
     byte result = A - HL;
     SetHighByte(&m_AF, result);
 
-    (result == 0x00) ? SetFlag(ZeroFlag) : ClearFlag(ZeroFlag);
-    SetFlag(SubtractFlag);
-    ((A & 0x0F) < (result & 0x0F)) ? SetFlag(HalfCarryFlag) : ClearFlag(HalfCarryFlag);
-    ((A & 0xFF) < (result & 0xFF)) ? SetFlag(CarryFlag) : ClearFlag(CarryFlag);
+    SetALUFlags(LazyFlagsSub, A, HL, 0x00, result);
 
     return 8;
 }
@@ -2569,7 +2929,7 @@ unsigned long CPU::SUB_HL_(const byte& opCode)
 */
 unsigned long CPU::SBCA_HL_(const byte& opCode)
 {
-    byte HL = m_MMU->Read(m_HL);
+    byte HL = ReadByte(m_HL);
     SBC(HL);
     return 8;
 }
@@ -2587,22 +2947,11 @@ unsigned long CPU::SBCA_HL_(const byte& opCode)
 */
 unsigned long CPU::AND_HL_(const byte& opCode)
 {
-    byte HL = m_MMU->Read(m_HL);
+    byte HL = ReadByte(m_HL);
     byte result = HL & GetHighByte(m_AF);
     SetHighByte(&m_AF, result);
 
-    if (result == 0x00)
-    {
-        SetFlag(ZeroFlag);
-    }
-    else
-    {
-        ClearFlag(ZeroFlag);
-    }
-
-    ClearFlag(SubtractFlag);
-    SetFlag(HalfCarryFlag);
-    ClearFlag(CarryFlag);
+    SetALUFlags(LazyFlagsAnd, 0x00, 0x00, 0x00, result);
 
     return 8;
 }
@@ -2620,14 +2969,11 @@ unsigned long CPU::AND_HL_(const byte& opCode)
 */
 unsigned long CPU::CP_HL_(const byte& opCode)
 {
-    byte HL = m_MMU->Read(m_HL);
+    byte HL = ReadByte(m_HL);
     byte A = GetHighByte(m_AF);
     byte result = A - HL;
 
-    (result == 0x00) ? SetFlag(ZeroFlag) : ClearFlag(ZeroFlag);
-    SetFlag(SubtractFlag);
-    ((A & 0x0F) < (HL & 0x0F)) ? SetFlag(HalfCarryFlag) : ClearFlag(HalfCarryFlag);
-    ((A & 0xFF) < (HL & 0xFF)) ? SetFlag(CarryFlag) : ClearFlag(CarryFlag);
+    SetALUFlags(LazyFlagsSub, A, HL, 0x00, result);
 
     return 8;
 }
@@ -2737,10 +3083,7 @@ unsigned long CPU::SUBn(const byte& opCode)
     byte result = A - n;
     SetHighByte(&m_AF, result);
 
-    (result == 0x00) ? SetFlag(ZeroFlag) : ClearFlag(ZeroFlag);
-    SetFlag(SubtractFlag);
-    ((A & 0x0F) < (n & 0x0F)) ? SetFlag(HalfCarryFlag) : ClearFlag(HalfCarryFlag);
-    ((A & 0xFF) < (n & 0xFF)) ? SetFlag(CarryFlag) : ClearFlag(CarryFlag);
+    SetALUFlags(LazyFlagsSub, A, n, 0x00, result);
 
     return 8;
 }
@@ -2792,7 +3135,7 @@ unsigned long CPU::LD_0xFF00n_A(const byte& opCode)
 {
     byte n = ReadBytePC(); // Read n
 
-    m_MMU->Write(0xFF00 + n, GetHighByte(m_AF)); // Load A into 0xFF00 + n
+    WriteByte(0xFF00 + n, GetHighByte(m_AF)); // Load A into 0xFF00 + n
 
     return 12;
 }
@@ -2808,7 +3151,7 @@ unsigned long CPU::LD_0xFF00n_A(const byte& opCode)
 */
 unsigned long CPU::LD_0xFF00C_A(const byte& opCode)
 {
-    m_MMU->Write(0xFF00 + GetLowByte(m_BC), GetHighByte(m_AF)); // Load A into 0xFF00 + C
+    WriteByte(0xFF00 + GetLowByte(m_BC), GetHighByte(m_AF)); // Load A into 0xFF00 + C
 
     return 8;
 }
@@ -2827,7 +3170,7 @@ unsigned long CPU::LD_nn_A(const byte& opCode)
 {
     ushort nn = ReadUShortPC();
 
-    m_MMU->Write(nn, GetHighByte(m_AF)); // Load A into (nn)
+    WriteByte(nn, GetHighByte(m_AF)); // Load A into (nn)
 
     return 16;
 }
@@ -2845,21 +3188,10 @@ unsigned long CPU::LD_nn_A(const byte& opCode)
 unsigned long CPU::XORn(const byte& opCode)
 {
     byte n = ReadBytePC();
-    SetHighByte(&m_AF, n ^ GetHighByte(m_AF));
-
-    // Affects Z and clears NHC
-    if (GetHighByte(m_AF) == 0x00)
-    {
-        SetFlag(ZeroFlag);
-    }
-    else
-    {
-        ClearFlag(ZeroFlag);
-    }
+    byte result = n ^ GetHighByte(m_AF);
+    SetHighByte(&m_AF, result);
 
-    ClearFlag(SubtractFlag);
-    ClearFlag(HalfCarryFlag);
-    ClearFlag(CarryFlag);
+    SetALUFlags(LazyFlagsOr, 0x00, 0x00, 0x00, result);
 
     return 8;
 }
@@ -2876,7 +3208,7 @@ unsigned long CPU::XORn(const byte& opCode)
 unsigned long CPU::LDA_0xFF00n_(const byte& opCode)
 {
     byte n = ReadBytePC(); // Read n
-    SetHighByte(&m_AF, m_MMU->Read(0xFF00 + n));
+    SetHighByte(&m_AF, ReadByte(0xFF00 + n));
 
     return 12;
 }
@@ -2892,7 +3224,7 @@ unsigned long CPU::LDA_0xFF00n_(const byte& opCode)
 */
 unsigned long CPU::LDA_0xFF00C_(const byte& opCode)
 {
-    SetHighByte(&m_AF, m_MMU->Read(0xFF00 + GetLowByte(m_BC)));
+    SetHighByte(&m_AF, ReadByte(0xFF00 + GetLowByte(m_BC)));
 
     return 8;
 }
@@ -2926,21 +3258,10 @@ unsigned long CPU::DI(const byte& opCode)
 unsigned long CPU::ORn(const byte& opCode)
 {
     byte n = ReadBytePC();
-    SetHighByte(&m_AF, n | GetHighByte(m_AF));
-
-    // Affects Z and clears NHC
-    if (GetHighByte(m_AF) == 0x00)
-    {
-        SetFlag(ZeroFlag);
-    }
-    else
-    {
-        ClearFlag(ZeroFlag);
-    }
+    byte result = n | GetHighByte(m_AF);
+    SetHighByte(&m_AF, result);
 
-    ClearFlag(SubtractFlag);
-    ClearFlag(HalfCarryFlag);
-    ClearFlag(CarryFlag);
+    SetALUFlags(LazyFlagsOr, 0x00, 0x00, 0x00, result);
 
     return 8;
 }
@@ -3001,7 +3322,7 @@ unsigned long CPU::LDHLSPe(const byte& opCode)
 unsigned long CPU::LDA_nn_(const byte& opCode)
 {
     ushort nn = ReadUShortPC();
-    SetHighByte(&m_AF, m_MMU->Read(nn));
+    SetHighByte(&m_AF, ReadByte(nn));
 
     return 16;
 }
@@ -3039,10 +3360,7 @@ unsigned long CPU::CPn(const byte& opCode)
     byte A = GetHighByte(m_AF);
     byte result = A - n;
 
-    (result == 0x00) ? SetFlag(ZeroFlag) : ClearFlag(ZeroFlag);
-    ((A & 0xFF) < (n & 0xFF)) ? SetFlag(CarryFlag) : ClearFlag(CarryFlag);
-    ((A & 0x0F) < (n & 0x0F)) ? SetFlag(HalfCarryFlag) : ClearFlag(HalfCarryFlag);
-    SetFlag(SubtractFlag);
+    SetALUFlags(LazyFlagsSub, A, n, 0x00, result);
 
     return 8;
 }
@@ -3063,9 +3381,10 @@ unsigned long CPU::CPn(const byte& opCode)
 
     Flags affected(znhc): z00c
 */
+template<byte rIndex>
 unsigned long CPU::RLCr(const byte& opCode)
 {
-    byte* r = GetByteRegister(opCode);
+    byte* r = GetByteRegister<rIndex>();
 
     // Grab bit 7 and store it in the carryflag
     ISBITSET(*r, 7) ? SetFlag(CarryFlag) : ClearFlag(CarryFlag);
@@ -3093,7 +3412,7 @@ unsigned long CPU::RLCr(const byte& opCode)
 */
 unsigned long CPU::RLC_HL_(const byte& opCode)
 {
-    byte r = m_MMU->Read(m_HL);
+    byte r = ReadByte(m_HL);
 
     // Grab bit 7 and store it in the carryflag
     ISBITSET(r, 7) ? SetFlag(CarryFlag) : ClearFlag(CarryFlag);
@@ -3104,7 +3423,7 @@ unsigned long CPU::RLC_HL_(const byte& opCode)
     // Set bit 0 of r to the old CarryFlag
     r = IsFlagSet(CarryFlag) ? SETBIT((r), 0) : CLEARBIT((r), 0);
 
-    m_MMU->Write(m_HL, r);
+    WriteByte(m_HL, r);
 
     // Affects Z, clears N, clears H, affects C
     (r == 0x00) ? SetFlag(ZeroFlag) : ClearFlag(ZeroFlag);
@@ -3126,9 +3445,10 @@ unsigned long CPU::RLC_HL_(const byte& opCode)
 
     Flags affected(znhc): z00c
 */
+template<byte rIndex>
 unsigned long CPU::RRCr(const byte& opCode)
 {
-    byte* r = GetByteRegister(opCode);
+    byte* r = GetByteRegister<rIndex>();
 
     // Grab bit 0 and store it in the carryflag
     ISBITSET(*r, 0) ? SetFlag(CarryFlag) : ClearFlag(CarryFlag);
@@ -3156,7 +3476,7 @@ unsigned long CPU::RRCr(const byte& opCode)
 */
 unsigned long CPU::RRC_HL_(const byte& opCode)
 {
-    byte r = m_MMU->Read(m_HL);
+    byte r = ReadByte(m_HL);
 
     // Grab bit 0 and store it in the carryflag
     ISBITSET(r, 0) ? SetFlag(CarryFlag) : ClearFlag(CarryFlag);
@@ -3167,7 +3487,7 @@ unsigned long CPU::RRC_HL_(const byte& opCode)
     // Set bit 0 of r to the old CarryFlag
     r = IsFlagSet(CarryFlag) ? SETBIT((r), 7) : CLEARBIT((r), 7);
 
-    m_MMU->Write(m_HL, r);
+    WriteByte(m_HL, r);
 
     // Affects Z, clears N, clears H, affects C
     (r == 0x00) ? SetFlag(ZeroFlag) : ClearFlag(ZeroFlag);
@@ -3189,9 +3509,10 @@ unsigned long CPU::RRC_HL_(const byte& opCode)
 
     Flags affected(znhc): z00c
 */
+template<byte rIndex>
 unsigned long CPU::RLr(const byte& opCode)
 {
-    byte* r = GetByteRegister(opCode);
+    byte* r = GetByteRegister<rIndex>();
 
     // Grab the current CarryFlag val
     bool carry = IsFlagSet(CarryFlag);
@@ -3222,7 +3543,7 @@ unsigned long CPU::RLr(const byte& opCode)
 */
 unsigned long CPU::RL_HL_(const byte& opCode)
 {
-    byte r = m_MMU->Read(m_HL);
+    byte r = ReadByte(m_HL);
 
     // Grab the current CarryFlag val
     bool carry = IsFlagSet(CarryFlag);
@@ -3236,7 +3557,7 @@ unsigned long CPU::RL_HL_(const byte& opCode)
     // Set bit 0 of r to the old CarryFlag
     r = carry ? SETBIT((r), 0) : CLEARBIT((r), 0);
 
-    m_MMU->Write(m_HL, r);
+    WriteByte(m_HL, r);
 
     // Affects Z, clears N, clears H, affects C
     (r == 0x00) ? SetFlag(ZeroFlag) : ClearFlag(ZeroFlag);
@@ -3258,9 +3579,10 @@ unsigned long CPU::RL_HL_(const byte& opCode)
 
     Flags affected(znhc): z00c
 */
+template<byte rIndex>
 unsigned long CPU::RRr(const byte& opCode)
 {
-    byte* r = GetByteRegister(opCode);
+    byte* r = GetByteRegister<rIndex>();
 
     // Grab the current CarryFlag val
     bool carry = IsFlagSet(CarryFlag);
@@ -3291,7 +3613,7 @@ unsigned long CPU::RRr(const byte& opCode)
 */
 unsigned long CPU::RR_HL_(const byte& opCode)
 {
-    byte r = m_MMU->Read(m_HL);
+    byte r = ReadByte(m_HL);
 
     // Grab the current CarryFlag val
     bool carry = IsFlagSet(CarryFlag);
@@ -3305,7 +3627,7 @@ unsigned long CPU::RR_HL_(const byte& opCode)
     // Set bit 7 of r to the old CarryFlag
     r = carry ? SETBIT((r), 7) : CLEARBIT((r), 7);
 
-    m_MMU->Write(m_HL, r);
+    WriteByte(m_HL, r);
 
     // Affects Z, clears N, clears H, affects C
     (r == 0x00) ? SetFlag(ZeroFlag) : ClearFlag(ZeroFlag);
@@ -3326,9 +3648,10 @@ unsigned long CPU::RR_HL_(const byte& opCode)
 
     Flags affected(znhc): z00c
 */
+template<byte rIndex>
 unsigned long CPU::SLAr(const byte& opCode)
 {
-    byte* r = GetByteRegister(opCode);
+    byte* r = GetByteRegister<rIndex>();
 
     // Grab bit 7 and store it in the carryflag
     ISBITSET(*r, 7) ? SetFlag(CarryFlag) : ClearFlag(CarryFlag);
@@ -3353,14 +3676,14 @@ unsigned long CPU::SLAr(const byte& opCode)
 */
 unsigned long CPU::SLA_HL_(const byte& opCode)
 {
-    byte r = m_MMU->Read(m_HL);
+    byte r = ReadByte(m_HL);
 
     // Grab bit 7 and store it in the carryflag
     ISBITSET(r, 7) ? SetFlag(CarryFlag) : ClearFlag(CarryFlag);
 
     // Shift r left
     r = r << 1;
-    m_MMU->Write(m_HL, r);
+    WriteByte(m_HL, r);
 
     // Affects Z, clears N, clears H, affects C
     (r == 0x00) ? SetFlag(ZeroFlag) : ClearFlag(ZeroFlag);
@@ -3381,9 +3704,10 @@ unsigned long CPU::SLA_HL_(const byte& opCode)
 
     Flags affected(znhc): z00c
 */
+template<byte rIndex>
 unsigned long CPU::SRAr(const byte& opCode)
 {
-    byte* r = GetByteRegister(opCode);
+    byte* r = GetByteRegister<rIndex>();
 
     // Grab bit 0 and store it in the carryflag
     ISBITSET(*r, 0) ? SetFlag(CarryFlag) : ClearFlag(CarryFlag);
@@ -3408,14 +3732,14 @@ unsigned long CPU::SRAr(const byte& opCode)
 */
 unsigned long CPU::SRA_HL_(const byte& opCode)
 {
-    byte r = m_MMU->Read(m_HL);
+    byte r = ReadByte(m_HL);
 
     // Grab bit 0 and store it in the carryflag
     ISBITSET(r, 0) ? SetFlag(CarryFlag) : ClearFlag(CarryFlag);
 
     // Shift r right
     r = (r >> 1) | (r & 0x80);
-    m_MMU->Write(m_HL, r);
+    WriteByte(m_HL, r);
 
     // Affects Z, clears N, clears H, affects C
     (r == 0x00) ? SetFlag(ZeroFlag) : ClearFlag(ZeroFlag);
@@ -3436,9 +3760,10 @@ unsigned long CPU::SRA_HL_(const byte& opCode)
 
     Flags affected(znhc): z00c
 */
+template<byte rIndex>
 unsigned long CPU::SRLr(const byte& opCode)
 {
-    byte* r = GetByteRegister(opCode);
+    byte* r = GetByteRegister<rIndex>();
 
     // Grab bit 0 and store it in the carryflag
     ISBITSET(*r, 0) ? SetFlag(CarryFlag) : ClearFlag(CarryFlag);
@@ -3464,7 +3789,7 @@ unsigned long CPU::SRLr(const byte& opCode)
 */
 unsigned long CPU::SRL_HL_(const byte& opCode)
 {
-    byte r = m_MMU->Read(m_HL);
+    byte r = ReadByte(m_HL);
 
     // Grab bit 0 and store it in the carryflag
     ISBITSET(r, 0) ? SetFlag(CarryFlag) : ClearFlag(CarryFlag);
@@ -3472,7 +3797,7 @@ unsigned long CPU::SRL_HL_(const byte& opCode)
     // Shift r right
     r = r >> 1;
     r = CLEARBIT(r, 7);
-    m_MMU->Write(m_HL, r);
+    WriteByte(m_HL, r);
 
     // Affects Z, clears N, clears H, affects C
     (r == 0x00) ? SetFlag(ZeroFlag) : ClearFlag(ZeroFlag);
@@ -3492,10 +3817,10 @@ unsigned long CPU::SRL_HL_(const byte& opCode)
 
     Flags affected(znhc): z01-
 */
+template<byte bit, byte rIndex>
 unsigned long CPU::BITbr(const byte& opCode)
 {
-    byte bit = (opCode >> 3) & 0x07;
-    byte* r = GetByteRegister(opCode);
+    byte* r = GetByteRegister<rIndex>();
 
     // Test bit b in r
     (!ISBITSET(*r, bit)) ? SetFlag(ZeroFlag) : ClearFlag(ZeroFlag);
@@ -3513,10 +3838,10 @@ unsigned long CPU::BITbr(const byte& opCode)
 
     Flags affected(znhc): z01-
 */
+template<byte bit>
 unsigned long CPU::BITb_HL_(const byte& opCode)
 {
-    byte bit = (opCode >> 3) & 0x07;
-    byte r = m_MMU->Read(m_HL);
+    byte r = ReadByte(m_HL);
 
     // Test bit b in r
     (!ISBITSET(r, bit)) ? SetFlag(ZeroFlag) : ClearFlag(ZeroFlag);
@@ -3537,10 +3862,10 @@ unsigned long CPU::BITb_HL_(const byte& opCode)
 
     Flags affected(znhc): ----
 */
+template<byte bit, byte rIndex>
 unsigned long CPU::RESbr(const byte& opCode)
 {
-    byte bit = (opCode >> 3) & 0x07;
-    byte* r = GetByteRegister(opCode);
+    byte* r = GetByteRegister<rIndex>();
     *r = CLEARBIT(*r, bit);
 
     return 8;
@@ -3553,11 +3878,11 @@ unsigned long CPU::RESbr(const byte& opCode)
 
     Flags affected(znhc): ----
 */
+template<byte bit>
 unsigned long CPU::RESb_HL_(const byte& opCode)
 {
-    byte bit = (opCode >> 3) & 0x07;
-    byte r = m_MMU->Read(m_HL);
-    m_MMU->Write(m_HL, CLEARBIT(r, bit));
+    byte r = ReadByte(m_HL);
+    WriteByte(m_HL, CLEARBIT(r, bit));
 
     return 16;
 }
@@ -3572,10 +3897,10 @@ unsigned long CPU::RESb_HL_(const byte& opCode)
 
     No flags affected.
 */
+template<byte bit, byte rIndex>
 unsigned long CPU::SETbr(const byte& opCode)
 {
-    byte bit = (opCode >> 3) & 0x07;
-    byte* r = GetByteRegister(opCode);
+    byte* r = GetByteRegister<rIndex>();
     *r = SETBIT(*r, bit);
 
     return 8;
@@ -3588,11 +3913,11 @@ unsigned long CPU::SETbr(const byte& opCode)
 
     Flags affected(znhc): ----
 */
+template<byte bit>
 unsigned long CPU::SETb_HL_(const byte& opCode)
 {
-    byte bit = (opCode >> 3) & 0x07;
-    byte r = m_MMU->Read(m_HL);
-    m_MMU->Write(m_HL, SETBIT(r, bit));
+    byte r = ReadByte(m_HL);
+    WriteByte(m_HL, SETBIT(r, bit));
 
     return 16;
 }
@@ -3609,9 +3934,10 @@ unsigned long CPU::SETb_HL_(const byte& opCode)
 
     Flags affected(znhc): z000
 */
+template<byte rIndex>
 unsigned long CPU::SWAPr(const byte& opCode)
 {
-    byte* r = GetByteRegister(opCode);
+    byte* r = GetByteRegister<rIndex>();
     byte lowNibble = (*r & 0x0F);
     byte highNibble = (*r & 0xF0);
 
@@ -3634,11 +3960,11 @@ unsigned long CPU::SWAPr(const byte& opCode)
 */
 unsigned long CPU::SWAP_HL_(const byte& opCode)
 {
-    byte r = m_MMU->Read(m_HL);
+    byte r = ReadByte(m_HL);
     byte lowNibble = (r & 0x0F);
     byte highNibble = (r & 0xF0);
 
-    m_MMU->Write(m_HL, (lowNibble << 4) | (highNibble >> 4));
+    WriteByte(m_HL, (lowNibble << 4) | (highNibble >> 4));
 
     (r == 0x00) ? SetFlag(ZeroFlag) : ClearFlag(ZeroFlag);
     ClearFlag(SubtractFlag);
@@ -3647,3 +3973,1141 @@ unsigned long CPU::SWAP_HL_(const byte& opCode)
 
     return 16;
 }
+
+/*
+    INTERPRETER CORE
+
+    With CPU_SWITCH_DISPATCH enabled, the opcodes are dispatched through a dense switch over
+    direct calls so the compiler can build a jump table and inline the handlers into the core.
+    Otherwise, the opcodes are dispatched through the member function pointer tables.
+*/
+
+unsigned long CPU::Execute(const byte& opCode)
+{
+#if CPU_SWITCH_DISPATCH
+    switch (opCode)
+    {
+    case 0x00: return NOP(opCode);
+    case 0x01: return LDrrnn<0>(opCode);
+    case 0x02: return LD_BC_A(opCode);
+    case 0x03: return INCrr<0>(opCode);
+    case 0x04: return INCr<0>(opCode);
+    case 0x05: return DECr<0>(opCode);
+    case 0x06: return LDrn<0>(opCode);
+    case 0x07: return RLCA(opCode);
+    case 0x08: return LD_nn_SP(opCode);
+    case 0x09: return ADDHLss<0>(opCode);
+    case 0x0A: return LDA_BC_(opCode);
+    case 0x0B: return DECrr<0>(opCode);
+    case 0x0C: return INCr<1>(opCode);
+    case 0x0D: return DECr<1>(opCode);
+    case 0x0E: return LDrn<1>(opCode);
+    case 0x0F: return RRCA(opCode);
+
+    case 0x10: return STOP(opCode);
+    case 0x11: return LDrrnn<1>(opCode);
+    case 0x12: return LD_DE_A(opCode);
+    case 0x13: return INCrr<1>(opCode);
+    case 0x14: return INCr<2>(opCode);
+    case 0x15: return DECr<2>(opCode);
+    case 0x16: return LDrn<2>(opCode);
+    case 0x17: return RLA(opCode);
+    case 0x18: return JRe(opCode);
+    case 0x19: return ADDHLss<1>(opCode);
+    case 0x1A: return LDA_DE_(opCode);
+    case 0x1B: return DECrr<1>(opCode);
+    case 0x1C: return INCr<3>(opCode);
+    case 0x1D: return DECr<3>(opCode);
+    case 0x1E: return LDrn<3>(opCode);
+    case 0x1F: return RRA(opCode);
+
+    case 0x20: return JRcce<0>(opCode);
+    case 0x21: return LDrrnn<2>(opCode);
+    case 0x22: return LDI_HL_A(opCode);
+    case 0x23: return INCrr<2>(opCode);
+    case 0x24: return INCr<4>(opCode);
+    case 0x25: return DECr<4>(opCode);
+    case 0x26: return LDrn<4>(opCode);
+    case 0x27: return DAA(opCode);
+    case 0x28: return JRcce<1>(opCode);
+    case 0x29: return ADDHLss<2>(opCode);
+    case 0x2A: return LDIA_HL_(opCode);
+    case 0x2B: return DECrr<2>(opCode);
+    case 0x2C: return INCr<5>(opCode);
+    case 0x2D: return DECr<5>(opCode);
+    case 0x2E: return LDrn<5>(opCode);
+    case 0x2F: return CPL(opCode);
+
+    case 0x30: return JRcce<2>(opCode);
+    case 0x31: return LDrrnn<3>(opCode);
+    case 0x32: return LDD_HL_A(opCode);
+    case 0x33: return INCrr<3>(opCode);
+    case 0x34: return INC_HL_(opCode);
+    case 0x35: return DEC_HL_(opCode);
+    case 0x36: return LD_HL_n(opCode);
+    case 0x37: return SCF(opCode);
+    case 0x38: return JRcce<3>(opCode);
+    case 0x39: return ADDHLss<3>(opCode);
+    case 0x3A: return LDDA_HL_(opCode);
+    case 0x3B: return DECrr<3>(opCode);
+    case 0x3C: return INCr<7>(opCode);
+    case 0x3D: return DECr<7>(opCode);
+    case 0x3E: return LDrn<7>(opCode);
+    case 0x3F: return CCF(opCode);
+
+    case 0x40: return LDrR<0, 0>(opCode);
+    case 0x41: return LDrR<0, 1>(opCode);
+    case 0x42: return LDrR<0, 2>(opCode);
+    case 0x43: return LDrR<0, 3>(opCode);
+    case 0x44: return LDrR<0, 4>(opCode);
+    case 0x45: return LDrR<0, 5>(opCode);
+    case 0x46: return LDr_HL_<0>(opCode);
+    case 0x47: return LDrR<0, 7>(opCode);
+    case 0x48: return LDrR<1, 0>(opCode);
+    case 0x49: return LDrR<1, 1>(opCode);
+    case 0x4A: return LDrR<1, 2>(opCode);
+    case 0x4B: return LDrR<1, 3>(opCode);
+    case 0x4C: return LDrR<1, 4>(opCode);
+    case 0x4D: return LDrR<1, 5>(opCode);
+    case 0x4E: return LDr_HL_<1>(opCode);
+    case 0x4F: return LDrR<1, 7>(opCode);
+
+    case 0x50: return LDrR<2, 0>(opCode);
+    case 0x51: return LDrR<2, 1>(opCode);
+    case 0x52: return LDrR<2, 2>(opCode);
+    case 0x53: return LDrR<2, 3>(opCode);
+    case 0x54: return LDrR<2, 4>(opCode);
+    case 0x55: return LDrR<2, 5>(opCode);
+    case 0x56: return LDr_HL_<2>(opCode);
+    case 0x57: return LDrR<2, 7>(opCode);
+    case 0x58: return LDrR<3, 0>(opCode);
+    case 0x59: return LDrR<3, 1>(opCode);
+    case 0x5A: return LDrR<3, 2>(opCode);
+    case 0x5B: return LDrR<3, 3>(opCode);
+    case 0x5C: return LDrR<3, 4>(opCode);
+    case 0x5D: return LDrR<3, 5>(opCode);
+    case 0x5E: return LDr_HL_<3>(opCode);
+    case 0x5F: return LDrR<3, 7>(opCode);
+
+    case 0x60: return LDrR<4, 0>(opCode);
+    case 0x61: return LDrR<4, 1>(opCode);
+    case 0x62: return LDrR<4, 2>(opCode);
+    case 0x63: return LDrR<4, 3>(opCode);
+    case 0x64: return LDrR<4, 4>(opCode);
+    case 0x65: return LDrR<4, 5>(opCode);
+    case 0x66: return LDr_HL_<4>(opCode);
+    case 0x67: return LDrR<4, 7>(opCode);
+    case 0x68: return LDrR<5, 0>(opCode);
+    case 0x69: return LDrR<5, 1>(opCode);
+    case 0x6A: return LDrR<5, 2>(opCode);
+    case 0x6B: return LDrR<5, 3>(opCode);
+    case 0x6C: return LDrR<5, 4>(opCode);
+    case 0x6D: return LDrR<5, 5>(opCode);
+    case 0x6E: return LDr_HL_<5>(opCode);
+    case 0x6F: return LDrR<5, 7>(opCode);
+
+    case 0x70: return LD_HL_r<0>(opCode);
+    case 0x71: return LD_HL_r<1>(opCode);
+    case 0x72: return LD_HL_r<2>(opCode);
+    case 0x73: return LD_HL_r<3>(opCode);
+    case 0x74: return LD_HL_r<4>(opCode);
+    case 0x75: return LD_HL_r<5>(opCode);
+    case 0x76: return HALT(opCode);
+    case 0x77: return LD_HL_r<7>(opCode);
+    case 0x78: return LDrR<7, 0>(opCode);
+    case 0x79: return LDrR<7, 1>(opCode);
+    case 0x7A: return LDrR<7, 2>(opCode);
+    case 0x7B: return LDrR<7, 3>(opCode);
+    case 0x7C: return LDrR<7, 4>(opCode);
+    case 0x7D: return LDrR<7, 5>(opCode);
+    case 0x7E: return LDr_HL_<7>(opCode);
+    case 0x7F: return LDrR<7, 7>(opCode);
+
+    case 0x80: return ADDAr<0>(opCode);
+    case 0x81: return ADDAr<1>(opCode);
+    case 0x82: return ADDAr<2>(opCode);
+    case 0x83: return ADDAr<3>(opCode);
+    case 0x84: return ADDAr<4>(opCode);
+    case 0x85: return ADDAr<5>(opCode);
+    case 0x86: return ADDA_HL_(opCode);
+    case 0x87: return ADDAr<7>(opCode);
+    case 0x88: return ADCAr<0>(opCode);
+    case 0x89: return ADCAr<1>(opCode);
+    case 0x8A: return ADCAr<2>(opCode);
+    case 0x8B: return ADCAr<3>(opCode);
+    case 0x8C: return ADCAr<4>(opCode);
+    case 0x8D: return ADCAr<5>(opCode);
+    case 0x8E: return ADCA_HL_(opCode);
+    case 0x8F: return ADCAr<7>(opCode);
+
+    case 0x90: return SUBr<0>(opCode);
+    case 0x91: return SUBr<1>(opCode);
+    case 0x92: return SUBr<2>(opCode);
+    case 0x93: return SUBr<3>(opCode);
+    case 0x94: return SUBr<4>(opCode);
+    case 0x95: return SUBr<5>(opCode);
+    case 0x96: return SUB_HL_(opCode);
+    case 0x97: return SUBr<7>(opCode);
+    case 0x98: return SBCAr<0>(opCode);
+    case 0x99: return SBCAr<1>(opCode);
+    case 0x9A: return SBCAr<2>(opCode);
+    case 0x9B: return SBCAr<3>(opCode);
+    case 0x9C: return SBCAr<4>(opCode);
+    case 0x9D: return SBCAr<5>(opCode);
+    case 0x9E: return SBCA_HL_(opCode);
+    case 0x9F: return SBCAr<7>(opCode);
+
+    case 0xA0: return ANDr<0>(opCode);
+    case 0xA1: return ANDr<1>(opCode);
+    case 0xA2: return ANDr<2>(opCode);
+    case 0xA3: return ANDr<3>(opCode);
+    case 0xA4: return ANDr<4>(opCode);
+    case 0xA5: return ANDr<5>(opCode);
+    case 0xA6: return AND_HL_(opCode);
+    case 0xA7: return ANDr<7>(opCode);
+    case 0xA8: return XORr<0>(opCode);
+    case 0xA9: return XORr<1>(opCode);
+    case 0xAA: return XORr<2>(opCode);
+    case 0xAB: return XORr<3>(opCode);
+    case 0xAC: return XORr<4>(opCode);
+    case 0xAD: return XORr<5>(opCode);
+    case 0xAE: return XOR_HL_(opCode);
+    case 0xAF: return XORr<7>(opCode);
+
+    case 0xB0: return ORr<0>(opCode);
+    case 0xB1: return ORr<1>(opCode);
+    case 0xB2: return ORr<2>(opCode);
+    case 0xB3: return ORr<3>(opCode);
+    case 0xB4: return ORr<4>(opCode);
+    case 0xB5: return ORr<5>(opCode);
+    case 0xB6: return OR_HL_(opCode);
+    case 0xB7: return ORr<7>(opCode);
+    case 0xB8: return CPr<0>(opCode);
+    case 0xB9: return CPr<1>(opCode);
+    case 0xBA: return CPr<2>(opCode);
+    case 0xBB: return CPr<3>(opCode);
+    case 0xBC: return CPr<4>(opCode);
+    case 0xBD: return CPr<5>(opCode);
+    case 0xBE: return CP_HL_(opCode);
+    case 0xBF: return CPr<7>(opCode);
+
+    case 0xC0: return RETcc<0>(opCode);
+    case 0xC1: return POPrr<0>(opCode);
+    case 0xC2: return JPccnn<0>(opCode);
+    case 0xC3: return JPnn(opCode);
+    case 0xC4: return CALLccnn<0>(opCode);
+    case 0xC5: return PUSHrr<0>(opCode);
+    case 0xC6: return ADDAn(opCode);
+    case 0xC7: return RSTn<0>(opCode);
+    case 0xC8: return RETcc<1>(opCode);
+    case 0xC9: return RET(opCode);
+    case 0xCA: return JPccnn<1>(opCode);
+    case 0xCC: return CALLccnn<1>(opCode);
+    case 0xCD: return CALLnn(opCode);
+    case 0xCE: return ADCAn(opCode);
+    case 0xCF: return RSTn<1>(opCode);
+
+    case 0xD0: return RETcc<2>(opCode);
+    case 0xD1: return POPrr<1>(opCode);
+    case 0xD2: return JPccnn<2>(opCode);
+    case 0xD4: return CALLccnn<2>(opCode);
+    case 0xD5: return PUSHrr<1>(opCode);
+    case 0xD6: return SUBn(opCode);
+    case 0xD7: return RSTn<2>(opCode);
+    case 0xD8: return RETcc<3>(opCode);
+    case 0xD9: return RETI(opCode);
+    case 0xDA: return JPccnn<3>(opCode);
+    case 0xDC: return CALLccnn<3>(opCode);
+    case 0xDE: return SBCAn(opCode);
+    case 0xDF: return RSTn<3>(opCode);
+
+    case 0xE0: return LD_0xFF00n_A(opCode);
+    case 0xE1: return POPrr<2>(opCode);
+    case 0xE2: return LD_0xFF00C_A(opCode);
+    case 0xE5: return PUSHrr<2>(opCode);
+    case 0xE6: return ANDn(opCode);
+    case 0xE7: return RSTn<4>(opCode);
+    case 0xE8: return ADDSPdd(opCode);
+    case 0xE9: return JP_HL_(opCode);
+    case 0xEA: return LD_nn_A(opCode);
+    case 0xEE: return XORn(opCode);
+    case 0xEF: return RSTn<5>(opCode);
+
+    case 0xF0: return LDA_0xFF00n_(opCode);
+    case 0xF1: return POPrr<3>(opCode);
+    case 0xF2: return LDA_0xFF00C_(opCode);
+    case 0xF3: return DI(opCode);
+    case 0xF5: return PUSHrr<3>(opCode);
+    case 0xF6: return ORn(opCode);
+    case 0xF7: return RSTn<6>(opCode);
+    case 0xF8: return LDHLSPe(opCode);
+    case 0xF9: return LDSPHL(opCode);
+    case 0xFA: return LDA_nn_(opCode);
+    case 0xFB: return EI(opCode);
+    case 0xFE: return CPn(opCode);
+    case 0xFF: return RSTn<7>(opCode);
+
+    default: return InvalidOpCode(opCode);
+    }
+#else
+    opCodeFunction instruction = m_operationMap[opCode];
+    if (instruction != nullptr)
+    {
+        return (this->*instruction)(opCode);
+    }
+
+    return InvalidOpCode(opCode);
+#endif
+}
+
+unsigned long CPU::ExecuteCB(const byte& opCode)
+{
+#if CPU_SWITCH_DISPATCH
+    switch (opCode)
+    {
+    case 0x00: return RLCr<0>(opCode);
+    case 0x01: return RLCr<1>(opCode);
+    case 0x02: return RLCr<2>(opCode);
+    case 0x03: return RLCr<3>(opCode);
+    case 0x04: return RLCr<4>(opCode);
+    case 0x05: return RLCr<5>(opCode);
+    case 0x06: return RLC_HL_(opCode);
+    case 0x07: return RLCr<7>(opCode);
+    case 0x08: return RRCr<0>(opCode);
+    case 0x09: return RRCr<1>(opCode);
+    case 0x0A: return RRCr<2>(opCode);
+    case 0x0B: return RRCr<3>(opCode);
+    case 0x0C: return RRCr<4>(opCode);
+    case 0x0D: return RRCr<5>(opCode);
+    case 0x0E: return RRC_HL_(opCode);
+    case 0x0F: return RRCr<7>(opCode);
+
+    case 0x10: return RLr<0>(opCode);
+    case 0x11: return RLr<1>(opCode);
+    case 0x12: return RLr<2>(opCode);
+    case 0x13: return RLr<3>(opCode);
+    case 0x14: return RLr<4>(opCode);
+    case 0x15: return RLr<5>(opCode);
+    case 0x16: return RL_HL_(opCode);
+    case 0x17: return RLr<7>(opCode);
+    case 0x18: return RRr<0>(opCode);
+    case 0x19: return RRr<1>(opCode);
+    case 0x1A: return RRr<2>(opCode);
+    case 0x1B: return RRr<3>(opCode);
+    case 0x1C: return RRr<4>(opCode);
+    case 0x1D: return RRr<5>(opCode);
+    case 0x1E: return RR_HL_(opCode);
+    case 0x1F: return RRr<7>(opCode);
+
+    case 0x20: return SLAr<0>(opCode);
+    case 0x21: return SLAr<1>(opCode);
+    case 0x22: return SLAr<2>(opCode);
+    case 0x23: return SLAr<3>(opCode);
+    case 0x24: return SLAr<4>(opCode);
+    case 0x25: return SLAr<5>(opCode);
+    case 0x26: return SLA_HL_(opCode);
+    case 0x27: return SLAr<7>(opCode);
+    case 0x28: return SRAr<0>(opCode);
+    case 0x29: return SRAr<1>(opCode);
+    case 0x2A: return SRAr<2>(opCode);
+    case 0x2B: return SRAr<3>(opCode);
+    case 0x2C: return SRAr<4>(opCode);
+    case 0x2D: return SRAr<5>(opCode);
+    case 0x2E: return SRA_HL_(opCode);
+    case 0x2F: return SRAr<7>(opCode);
+
+    case 0x30: return SWAPr<0>(opCode);
+    case 0x31: return SWAPr<1>(opCode);
+    case 0x32: return SWAPr<2>(opCode);
+    case 0x33: return SWAPr<3>(opCode);
+    case 0x34: return SWAPr<4>(opCode);
+    case 0x35: return SWAPr<5>(opCode);
+    case 0x36: return SWAP_HL_(opCode);
+    case 0x37: return SWAPr<7>(opCode);
+    case 0x38: return SRLr<0>(opCode);
+    case 0x39: return SRLr<1>(opCode);
+    case 0x3A: return SRLr<2>(opCode);
+    case 0x3B: return SRLr<3>(opCode);
+    case 0x3C: return SRLr<4>(opCode);
+    case 0x3D: return SRLr<5>(opCode);
+    case 0x3E: return SRL_HL_(opCode);
+    case 0x3F: return SRLr<7>(opCode);
+
+    case 0x40: return BITbr<0, 0>(opCode);
+    case 0x41: return BITbr<0, 1>(opCode);
+    case 0x42: return BITbr<0, 2>(opCode);
+    case 0x43: return BITbr<0, 3>(opCode);
+    case 0x44: return BITbr<0, 4>(opCode);
+    case 0x45: return BITbr<0, 5>(opCode);
+    case 0x46: return BITb_HL_<0>(opCode);
+    case 0x47: return BITbr<0, 7>(opCode);
+    case 0x48: return BITbr<1, 0>(opCode);
+    case 0x49: return BITbr<1, 1>(opCode);
+    case 0x4A: return BITbr<1, 2>(opCode);
+    case 0x4B: return BITbr<1, 3>(opCode);
+    case 0x4C: return BITbr<1, 4>(opCode);
+    case 0x4D: return BITbr<1, 5>(opCode);
+    case 0x4E: return BITb_HL_<1>(opCode);
+    case 0x4F: return BITbr<1, 7>(opCode);
+
+    case 0x50: return BITbr<2, 0>(opCode);
+    case 0x51: return BITbr<2, 1>(opCode);
+    case 0x52: return BITbr<2, 2>(opCode);
+    case 0x53: return BITbr<2, 3>(opCode);
+    case 0x54: return BITbr<2, 4>(opCode);
+    case 0x55: return BITbr<2, 5>(opCode);
+    case 0x56: return BITb_HL_<2>(opCode);
+    case 0x57: return BITbr<2, 7>(opCode);
+    case 0x58: return BITbr<3, 0>(opCode);
+    case 0x59: return BITbr<3, 1>(opCode);
+    case 0x5A: return BITbr<3, 2>(opCode);
+    case 0x5B: return BITbr<3, 3>(opCode);
+    case 0x5C: return BITbr<3, 4>(opCode);
+    case 0x5D: return BITbr<3, 5>(opCode);
+    case 0x5E: return BITb_HL_<3>(opCode);
+    case 0x5F: return BITbr<3, 7>(opCode);
+
+    case 0x60: return BITbr<4, 0>(opCode);
+    case 0x61: return BITbr<4, 1>(opCode);
+    case 0x62: return BITbr<4, 2>(opCode);
+    case 0x63: return BITbr<4, 3>(opCode);
+    case 0x64: return BITbr<4, 4>(opCode);
+    case 0x65: return BITbr<4, 5>(opCode);
+    case 0x66: return BITb_HL_<4>(opCode);
+    case 0x67: return BITbr<4, 7>(opCode);
+    case 0x68: return BITbr<5, 0>(opCode);
+    case 0x69: return BITbr<5, 1>(opCode);
+    case 0x6A: return BITbr<5, 2>(opCode);
+    case 0x6B: return BITbr<5, 3>(opCode);
+    case 0x6C: return BITbr<5, 4>(opCode);
+    case 0x6D: return BITbr<5, 5>(opCode);
+    case 0x6E: return BITb_HL_<5>(opCode);
+    case 0x6F: return BITbr<5, 7>(opCode);
+
+    case 0x70: return BITbr<6, 0>(opCode);
+    case 0x71: return BITbr<6, 1>(opCode);
+    case 0x72: return BITbr<6, 2>(opCode);
+    case 0x73: return BITbr<6, 3>(opCode);
+    case 0x74: return BITbr<6, 4>(opCode);
+    case 0x75: return BITbr<6, 5>(opCode);
+    case 0x76: return BITb_HL_<6>(opCode);
+    case 0x77: return BITbr<6, 7>(opCode);
+    case 0x78: return BITbr<7, 0>(opCode);
+    case 0x79: return BITbr<7, 1>(opCode);
+    case 0x7A: return BITbr<7, 2>(opCode);
+    case 0x7B: return BITbr<7, 3>(opCode);
+    case 0x7C: return BITbr<7, 4>(opCode);
+    case 0x7D: return BITbr<7, 5>(opCode);
+    case 0x7E: return BITb_HL_<7>(opCode);
+    case 0x7F: return BITbr<7, 7>(opCode);
+
+    case 0x80: return RESbr<0, 0>(opCode);
+    case 0x81: return RESbr<0, 1>(opCode);
+    case 0x82: return RESbr<0, 2>(opCode);
+    case 0x83: return RESbr<0, 3>(opCode);
+    case 0x84: return RESbr<0, 4>(opCode);
+    case 0x85: return RESbr<0, 5>(opCode);
+    case 0x86: return RESb_HL_<0>(opCode);
+    case 0x87: return RESbr<0, 7>(opCode);
+    case 0x88: return RESbr<1, 0>(opCode);
+    case 0x89: return RESbr<1, 1>(opCode);
+    case 0x8A: return RESbr<1, 2>(opCode);
+    case 0x8B: return RESbr<1, 3>(opCode);
+    case 0x8C: return RESbr<1, 4>(opCode);
+    case 0x8D: return RESbr<1, 5>(opCode);
+    case 0x8E: return RESb_HL_<1>(opCode);
+    case 0x8F: return RESbr<1, 7>(opCode);
+
+    case 0x90: return RESbr<2, 0>(opCode);
+    case 0x91: return RESbr<2, 1>(opCode);
+    case 0x92: return RESbr<2, 2>(opCode);
+    case 0x93: return RESbr<2, 3>(opCode);
+    case 0x94: return RESbr<2, 4>(opCode);
+    case 0x95: return RESbr<2, 5>(opCode);
+    case 0x96: return RESb_HL_<2>(opCode);
+    case 0x97: return RESbr<2, 7>(opCode);
+    case 0x98: return RESbr<3, 0>(opCode);
+    case 0x99: return RESbr<3, 1>(opCode);
+    case 0x9A: return RESbr<3, 2>(opCode);
+    case 0x9B: return RESbr<3, 3>(opCode);
+    case 0x9C: return RESbr<3, 4>(opCode);
+    case 0x9D: return RESbr<3, 5>(opCode);
+    case 0x9E: return RESb_HL_<3>(opCode);
+    case 0x9F: return RESbr<3, 7>(opCode);
+
+    case 0xA0: return RESbr<4, 0>(opCode);
+    case 0xA1: return RESbr<4, 1>(opCode);
+    case 0xA2: return RESbr<4, 2>(opCode);
+    case 0xA3: return RESbr<4, 3>(opCode);
+    case 0xA4: return RESbr<4, 4>(opCode);
+    case 0xA5: return RESbr<4, 5>(opCode);
+    case 0xA6: return RESb_HL_<4>(opCode);
+    case 0xA7: return RESbr<4, 7>(opCode);
+    case 0xA8: return RESbr<5, 0>(opCode);
+    case 0xA9: return RESbr<5, 1>(opCode);
+    case 0xAA: return RESbr<5, 2>(opCode);
+    case 0xAB: return RESbr<5, 3>(opCode);
+    case 0xAC: return RESbr<5, 4>(opCode);
+    case 0xAD: return RESbr<5, 5>(opCode);
+    case 0xAE: return RESb_HL_<5>(opCode);
+    case 0xAF: return RESbr<5, 7>(opCode);
+
+    case 0xB0: return RESbr<6, 0>(opCode);
+    case 0xB1: return RESbr<6, 1>(opCode);
+    case 0xB2: return RESbr<6, 2>(opCode);
+    case 0xB3: return RESbr<6, 3>(opCode);
+    case 0xB4: return RESbr<6, 4>(opCode);
+    case 0xB5: return RESbr<6, 5>(opCode);
+    case 0xB6: return RESb_HL_<6>(opCode);
+    case 0xB7: return RESbr<6, 7>(opCode);
+    case 0xB8: return RESbr<7, 0>(opCode);
+    case 0xB9: return RESbr<7, 1>(opCode);
+    case 0xBA: return RESbr<7, 2>(opCode);
+    case 0xBB: return RESbr<7, 3>(opCode);
+    case 0xBC: return RESbr<7, 4>(opCode);
+    case 0xBD: return RESbr<7, 5>(opCode);
+    case 0xBE: return RESb_HL_<7>(opCode);
+    case 0xBF: return RESbr<7, 7>(opCode);
+
+    case 0xC0: return SETbr<0, 0>(opCode);
+    case 0xC1: return SETbr<0, 1>(opCode);
+    case 0xC2: return SETbr<0, 2>(opCode);
+    case 0xC3: return SETbr<0, 3>(opCode);
+    case 0xC4: return SETbr<0, 4>(opCode);
+    case 0xC5: return SETbr<0, 5>(opCode);
+    case 0xC6: return SETb_HL_<0>(opCode);
+    case 0xC7: return SETbr<0, 7>(opCode);
+    case 0xC8: return SETbr<1, 0>(opCode);
+    case 0xC9: return SETbr<1, 1>(opCode);
+    case 0xCA: return SETbr<1, 2>(opCode);
+    case 0xCB: return SETbr<1, 3>(opCode);
+    case 0xCC: return SETbr<1, 4>(opCode);
+    case 0xCD: return SETbr<1, 5>(opCode);
+    case 0xCE: return SETb_HL_<1>(opCode);
+    case 0xCF: return SETbr<1, 7>(opCode);
+
+    case 0xD0: return SETbr<2, 0>(opCode);
+    case 0xD1: return SETbr<2, 1>(opCode);
+    case 0xD2: return SETbr<2, 2>(opCode);
+    case 0xD3: return SETbr<2, 3>(opCode);
+    case 0xD4: return SETbr<2, 4>(opCode);
+    case 0xD5: return SETbr<2, 5>(opCode);
+    case 0xD6: return SETb_HL_<2>(opCode);
+    case 0xD7: return SETbr<2, 7>(opCode);
+    case 0xD8: return SETbr<3, 0>(opCode);
+    case 0xD9: return SETbr<3, 1>(opCode);
+    case 0xDA: return SETbr<3, 2>(opCode);
+    case 0xDB: return SETbr<3, 3>(opCode);
+    case 0xDC: return SETbr<3, 4>(opCode);
+    case 0xDD: return SETbr<3, 5>(opCode);
+    case 0xDE: return SETb_HL_<3>(opCode);
+    case 0xDF: return SETbr<3, 7>(opCode);
+
+    case 0xE0: return SETbr<4, 0>(opCode);
+    case 0xE1: return SETbr<4, 1>(opCode);
+    case 0xE2: return SETbr<4, 2>(opCode);
+    case 0xE3: return SETbr<4, 3>(opCode);
+    case 0xE4: return SETbr<4, 4>(opCode);
+    case 0xE5: return SETbr<4, 5>(opCode);
+    case 0xE6: return SETb_HL_<4>(opCode);
+    case 0xE7: return SETbr<4, 7>(opCode);
+    case 0xE8: return SETbr<5, 0>(opCode);
+    case 0xE9: return SETbr<5, 1>(opCode);
+    case 0xEA: return SETbr<5, 2>(opCode);
+    case 0xEB: return SETbr<5, 3>(opCode);
+    case 0xEC: return SETbr<5, 4>(opCode);
+    case 0xED: return SETbr<5, 5>(opCode);
+    case 0xEE: return SETb_HL_<5>(opCode);
+    case 0xEF: return SETbr<5, 7>(opCode);
+
+    case 0xF0: return SETbr<6, 0>(opCode);
+    case 0xF1: return SETbr<6, 1>(opCode);
+    case 0xF2: return SETbr<6, 2>(opCode);
+    case 0xF3: return SETbr<6, 3>(opCode);
+    case 0xF4: return SETbr<6, 4>(opCode);
+    case 0xF5: return SETbr<6, 5>(opCode);
+    case 0xF6: return SETb_HL_<6>(opCode);
+    case 0xF7: return SETbr<6, 7>(opCode);
+    case 0xF8: return SETbr<7, 0>(opCode);
+    case 0xF9: return SETbr<7, 1>(opCode);
+    case 0xFA: return SETbr<7, 2>(opCode);
+    case 0xFB: return SETbr<7, 3>(opCode);
+    case 0xFC: return SETbr<7, 4>(opCode);
+    case 0xFD: return SETbr<7, 5>(opCode);
+    case 0xFE: return SETb_HL_<7>(opCode);
+    case 0xFF: return SETbr<7, 7>(opCode);
+    }
+
+    return InvalidOpCode(opCode);
+#else
+    opCodeFunction instruction = m_operationMapCB[opCode];
+    if (instruction != nullptr)
+    {
+        return (this->*instruction)(opCode);
+    }
+
+    return InvalidOpCode(opCode);
+#endif
+}
+
+unsigned long CPU::InvalidOpCode(const byte& opCode)
+{
+    Logger::LogError("OpCode 0x%02X at address 0x%04X could not be interpreted.", opCode, (ushort)(m_PC - 1));
+    return HALT(0x76);
+}
+
+/*
+    BLOCK CACHE
+
+    Straight-line runs of instructions are decoded once into DecodedBlocks, keyed by their address
+    and, for 0x4000-0x7FFF, the ROM bank. A block ends after any instruction that can change m_PC,
+    and never crosses from one memory region into another.
+
+    Only the ROM, WRAM, and HRAM are cached. ROM blocks stay valid across bank switches since they are
+    keyed by bank, but a write to the MBC stops the block being run. RAM blocks are tracked by page and
+    are dropped when a write lands inside them.
+*/
+
+// Returns true if the instruction can change m_PC or halt the CPU
+static bool IsBlockTerminator(const byte& opCode)
+{
+    switch (opCode)
+    {
+    case 0x10: // STOP
+    case 0x18: case 0x20: case 0x28: case 0x30: case 0x38: // JR
+    case 0x76: // HALT
+    case 0xC0: case 0xC8: case 0xC9: case 0xD0: case 0xD8: case 0xD9: // RET
+    case 0xC2: case 0xC3: case 0xCA: case 0xD2: case 0xDA: case 0xE9: // JP
+    case 0xC4: case 0xCC: case 0xCD: case 0xD4: case 0xDC: // CALL
+    case 0xC7: case 0xCF: case 0xD7: case 0xDF: case 0xE7: case 0xEF: case 0xF7: case 0xFF: // RST
+        return true;
+    }
+
+    return false;
+}
+
+// Returns the last address of the cached memory region containing address, or 0x0000 if not cached
+static ushort GetBlockRegionEnd(const ushort& address)
+{
+    if (address <= 0x3FFF)
+    {
+        return 0x3FFF;  // ROM bank 0
+    }
+    else if (address <= 0x7FFF)
+    {
+        return 0x7FFF;  // Switchable ROM bank
+    }
+    else if (address >= 0xC000 && address <= 0xDFFF)
+    {
+        return 0xDFFF;  // WRAM
+    }
+    else if (address >= 0xFF80 && address <= 0xFFFE)
+    {
+        return 0xFFFE;  // HRAM
+    }
+
+    return 0x0000;
+}
+
+CPU::DecodedBlock* CPU::GetDecodedBlock(const ushort& address)
+{
+    ushort regionEnd = GetBlockRegionEnd(address);
+    if (regionEnd == 0x0000)
+    {
+        return nullptr;
+    }
+
+    unsigned int key = address;
+    if (address >= 0x4000 && address <= 0x7FFF)
+    {
+        key |= (m_ROMBank << 16);
+    }
+
+    auto iter = m_decodedBlocks.find(key);
+    if (iter != m_decodedBlocks.end())
+    {
+        return iter->second.get();
+    }
+
+    std::unique_ptr<DecodedBlock> spBlock = DecodeBlock(address, regionEnd);
+    if (spBlock == nullptr)
+    {
+        return nullptr;
+    }
+
+    if (address >= 0x8000)
+    {
+        // Track the RAM pages holding the block, so writes to them can drop it
+        for (unsigned int page = (spBlock->startAddress >> 8); page <= (unsigned int)((spBlock->endAddress - 1) >> 8); page++)
+        {
+            std::vector<unsigned int>& pageBlocks = m_decodedBlockPages[page];
+            if (std::find(pageBlocks.begin(), pageBlocks.end(), key) == pageBlocks.end())
+            {
+                pageBlocks.push_back(key);
+            }
+        }
+    }
+
+    DecodedBlock* pBlock = spBlock.get();
+    m_decodedBlocks[key] = std::move(spBlock);
+    return pBlock;
+}
+
+/*
+    Returns the I/O register polled by the block, if the block is a side-effect free polling loop:
+        LDH A,(n) / LD A,(nn)       Read LY, STAT, or IF
+        CP n / AND n / BIT b,A ...  Test the value, only A and F are changed
+        JR cc / JP cc               Back to the read
+    Returns 0x0000 otherwise. The polled registers only change on the events reported by
+    GetCyclesUntilNextEvent.
+*/
+ushort CPU::GetIdleLoopAddress(const DecodedBlock* pBlock)
+{
+    const std::vector<DecodedInstruction>& instructions = pBlock->instructions;
+    if (instructions.size() < 2 || instructions.size() > MaxIdleLoopInstructions)
+    {
+        return 0x0000;
+    }
+
+    // The first instruction reads the polled register into A
+    ushort address = 0x0000;
+    const DecodedInstruction& read = instructions.front();
+    if (read.opCode == 0xF0) // LDH A,(n)
+    {
+        address = 0xFF00 | read.operands[0];
+    }
+    else if (read.opCode == 0xFA) // LD A,(nn)
+    {
+        address = (read.operands[1] << 8) | read.operands[0];
+    }
+
+    if (address != 0xFF0F && address != 0xFF41 && address != 0xFF44)
+    {
+        return 0x0000;
+    }
+
+    // The last instruction jumps back to the read
+    const DecodedInstruction& jump = instructions.back();
+    switch (jump.opCode)
+    {
+    case 0x20: case 0x28: case 0x30: case 0x38: // JR cc
+        if ((ushort)(pBlock->endAddress + static_cast<sbyte>(jump.operands[0])) != pBlock->startAddress)
+        {
+            return 0x0000;
+        }
+        break;
+    case 0xC2: case 0xCA: case 0xD2: case 0xDA: // JP cc
+        if (((jump.operands[1] << 8) | jump.operands[0]) != pBlock->startAddress)
+        {
+            return 0x0000;
+        }
+        break;
+    default:
+        return 0x0000;
+    }
+
+    // Everything in between only tests A
+    for (size_t index = 1; index < instructions.size() - 1; index++)
+    {
+        const DecodedInstruction& test = instructions[index];
+        switch (test.opCode)
+        {
+        case 0xA7: // AND A
+        case 0xB7: // OR A
+        case 0xE6: // AND n
+        case 0xEE: // XOR n
+        case 0xF6: // OR n
+        case 0xFE: // CP n
+            break;
+        case 0xCB:
+            // BIT b,A
+            if ((test.operands[0] & 0xC7) != 0x47)
+            {
+                return 0x0000;
+            }
+            break;
+        default:
+            return 0x0000;
+        }
+    }
+
+    return address;
+}
+
+std::unique_ptr<CPU::DecodedBlock> CPU::DecodeBlock(const ushort& address, const ushort& regionEnd)
+{
+    std::unique_ptr<DecodedBlock> spBlock = std::make_unique<DecodedBlock>();
+    spBlock->startAddress = address;
+    spBlock->runCount = 0;
+    spBlock->pCompiled = nullptr;
+
+    unsigned int pc = address;
+    while (spBlock->instructions.size() < MaxBlockInstructions)
+    {
+        DecodedInstruction instruction = { m_MMU->Read(pc), 2, { 0x00, 0x00 } };
+        if (instruction.opCode != 0xCB)
+        {
+            if (m_operationMap[instruction.opCode] == nullptr)
+            {
+                // Leave invalid OpCodes to the interpreter, which reports them
+                break;
+            }
+
+            instruction.length = InstructionLengths[instruction.opCode];
+        }
+
+        if (pc + instruction.length - 1 > regionEnd)
+        {
+            break;
+        }
+
+        for (byte index = 1; index < instruction.length; index++)
+        {
+            instruction.operands[index - 1] = m_MMU->Read(pc + index);
+        }
+
+        spBlock->instructions.push_back(instruction);
+        pc += instruction.length;
+
+        if (IsBlockTerminator(instruction.opCode) || pc > regionEnd)
+        {
+            break;
+        }
+    }
+
+    if (spBlock->instructions.empty())
+    {
+        return nullptr;
+    }
+
+    spBlock->endAddress = pc;
+    spBlock->idleLoopAddress = GetIdleLoopAddress(spBlock.get());
+    spBlock->idleLoopCycles = 0;
+    return spBlock;
+}
+
+unsigned long CPU::RunDecodedBlock(DecodedBlock* pBlock)
+{
+    const DecodedInstruction* pInstruction = pBlock->instructions.data();
+    const DecodedInstruction* pEnd = pInstruction + pBlock->instructions.size();
+
+    m_blockCycles = 0;
+    m_isBlockExitRequested = false;
+    do
+    {
+        // Copy the instruction, as a write can drop the block while it runs
+        DecodedInstruction instruction = *pInstruction++;
+        ushort nextAddress = m_PC + instruction.length;
+        unsigned long cycles;
+
+        if (instruction.opCode == 0xCB)
+        {
+            m_PC += 2;
+            cycles = ExecuteCB(instruction.operands[0]);
+        }
+        else
+        {
+            m_PC++;
+            m_pDecodedOperand = instruction.operands;
+            cycles = Execute(instruction.opCode);
+            m_pDecodedOperand = nullptr;
+        }
+
+        if (CompleteBlockInstruction(cycles, nextAddress))
+        {
+            break;
+        }
+    } while (pInstruction != pEnd);
+
+    return m_blockCycles;
+}
+
+/*
+    Runs a polling loop found by GetIdleLoopAddress. Once an iteration has looped back without
+    changing AF, every following iteration that reads the same value does exactly the same, until
+    an event changes the polled register. Those iterations are skipped in a single step.
+*/
+unsigned long CPU::RunIdleLoop(DecodedBlock* pBlock)
+{
+    MaterializeFlags();
+    byte value = ReadByte(pBlock->idleLoopAddress);
+    ushort AF = m_AF;
+
+    if (pBlock->idleLoopCycles != 0 && value == pBlock->idleLoopValue && AF == pBlock->idleLoopAF)
+    {
+        // Stop at the next event, the iteration running into it reads the value before it happens
+        unsigned long iterations = GetCyclesUntilNextEvent() / pBlock->idleLoopCycles;
+        if (iterations > 0)
+        {
+            unsigned long cycles = iterations * pBlock->idleLoopCycles;
+            m_idleCyclesSkipped += cycles;
+
+            AdvanceCycles(cycles);
+            HandleInterrupts();
+            return cycles;
+        }
+    }
+
+    unsigned long cycles = RunDecodedBlock(pBlock);
+    if (m_isBlockExitRequested)
+    {
+        // A write, such as an interrupt's push, may have dropped the block
+        return cycles;
+    }
+
+    MaterializeFlags();
+    if (m_PC == pBlock->startAddress && m_AF == AF)
+    {
+        // This iteration looped back to where it started
+        pBlock->idleLoopValue = value;
+        pBlock->idleLoopAF = AF;
+        pBlock->idleLoopCycles = cycles;
+    }
+    else
+    {
+        pBlock->idleLoopCycles = 0;
+    }
+
+    return cycles;
+}
+
+// Returns true if the block being run must be left
+bool CPU::CompleteBlockInstruction(unsigned long cycles, const ushort& nextAddress)
+{
+    m_blockCycles += cycles;
+    AdvanceCycles(cycles);
+    HandleInterrupts();
+
+    // Leave the block on a jump, an interrupt, HALT, or when the code may have changed
+    return (m_isBlockExitRequested || m_isHalted || m_PC != nextAddress);
+}
+
+void CPU::InvalidateDecodedBlocks(const ushort& address)
+{
+    std::vector<unsigned int>& pageBlocks = m_decodedBlockPages[address >> 8];
+    for (size_t index = 0; index < pageBlocks.size();)
+    {
+        auto iter = m_decodedBlocks.find(pageBlocks[index]);
+        if (iter != m_decodedBlocks.end())
+        {
+            DecodedBlock* pBlock = iter->second.get();
+            if (address < pBlock->startAddress || address >= pBlock->endAddress)
+            {
+                index++;
+                continue;
+            }
+
+            m_decodedBlocks.erase(iter);
+            m_isBlockExitRequested = true;
+        }
+
+        // Drop the key, it is stale or its block is now gone
+        pageBlocks[index] = pageBlocks.back();
+        pageBlocks.pop_back();
+    }
+}
+
+#if CPU_JIT
+/*
+    JIT
+
+    The register loads, the 8-bit ALU instructions, and the jumps are compiled into native code.
+    Every other OpCode has its own entry point for the compiled blocks to call, so the handler call
+    in each one is a direct (well predicted) call. The operands of the instruction are passed packed
+    into an unsigned int, low byte first.
+*/
+
+template<byte opCode>
+bool CPU::RunTranslatedInstruction(CPU* pCPU, unsigned int operands)
+{
+    byte decodedOperands[] = { (byte)(operands & 0xFF), (byte)((operands >> 8) & 0xFF) };
+    ushort nextAddress = pCPU->m_PC + InstructionLengths[opCode];
+
+    pCPU->m_PC++;
+    pCPU->m_pDecodedOperand = decodedOperands;
+    unsigned long cycles = (pCPU->*m_operationMap[opCode])(opCode);
+    pCPU->m_pDecodedOperand = nullptr;
+
+    // The compiled code reads and writes F directly
+    pCPU->MaterializeFlags();
+
+    return pCPU->CompleteBlockInstruction(cycles, nextAddress);
+}
+
+template<byte opCode>
+bool CPU::RunTranslatedInstructionCB(CPU* pCPU, unsigned int operands)
+{
+    ushort nextAddress = pCPU->m_PC + 2;
+
+    pCPU->m_PC += 2;
+    unsigned long cycles = (pCPU->*m_operationMapCB[opCode])(opCode);
+
+    return pCPU->CompleteBlockInstruction(cycles, nextAddress);
+}
+
+// Called by the compiled code once an event is due, its cycles have already been added
+bool CPU::RunTranslatedEvents(CPU* pCPU)
+{
+    ushort nextAddress = pCPU->m_PC;
+    return pCPU->CompleteBlockInstruction(0, nextAddress);
+}
+
+template<size_t... opCodes>
+void CPU::InitializeTranslatedInstructions(std::index_sequence<opCodes...>)
+{
+    TranslatedInstruction instructions[] = { &CPU::RunTranslatedInstruction<opCodes>... };
+    TranslatedInstruction instructionsCB[] = { &CPU::RunTranslatedInstructionCB<opCodes>... };
+
+    memcpy(m_translatedInstructions, instructions, sizeof(m_translatedInstructions));
+    memcpy(m_translatedInstructionsCB, instructionsCB, sizeof(m_translatedInstructionsCB));
+}
+
+// Creates the JIT, which finds the registers by their offsets in this CPU
+bool CPU::InitializeJIT()
+{
+    const byte* pCPU = reinterpret_cast<const byte*>(this);
+
+    JITLayout layout;
+    for (byte index = 0; index < ARRAYSIZE(layout.registers); index++)
+    {
+        layout.registers[index] = static_cast<int>(m_ByteRegisterMap[index] - pCPU);
+    }
+
+    for (byte index = 0; index < ARRAYSIZE(layout.registerPairs); index++)
+    {
+        layout.registerPairs[index] = static_cast<int>(reinterpret_cast<const byte*>(m_UShortRegisterMap[index]) - pCPU);
+    }
+
+    layout.PC = static_cast<int>(reinterpret_cast<const byte*>(&m_PC) - pCPU);
+    layout.cycles = static_cast<int>(reinterpret_cast<const byte*>(&m_cycles) - pCPU);
+    layout.pNextEvent = m_scheduler->GetNextEventAddress();
+    layout.pRunEvents = &CPU::RunTranslatedEvents;
+
+    m_JIT = std::make_unique<JIT>();
+    if (!m_JIT->Initialize(layout))
+    {
+        m_JIT.reset();
+        return false;
+    }
+
+    return true;
+}
+
+void CPU::CompileDecodedBlock(DecodedBlock* pBlock)
+{
+    if (!m_JIT->BeginBlock(pBlock->instructions.size()))
+    {
+        // The code buffer is full, start over
+        m_JIT->Reset();
+        for (auto& entry : m_decodedBlocks)
+        {
+            entry.second->pCompiled = nullptr;
+        }
+
+        if (!m_JIT->BeginBlock(pBlock->instructions.size()))
+        {
+            return;
+        }
+    }
+
+    ushort address = pBlock->startAddress;
+    for (const DecodedInstruction& instruction : pBlock->instructions)
+    {
+        byte opCode = instruction.opCode;
+        byte r = (opCode >> 3) & 0x07;  // The destination register, or the ALU operation
+        byte R = opCode & 0x07;         // The source register
+        byte n = instruction.operands[0];
+        ushort nn = (instruction.operands[1] << 8) | instruction.operands[0];
+        ushort nextAddress = address + instruction.length;
+
+        if (opCode == 0x00)
+        {
+            // NOP
+            m_JIT->EmitCycles(4, nextAddress);
+        }
+        else if (opCode >= 0x40 && opCode <= 0x7F && r != 0x06 && R != 0x06)
+        {
+            // LD r, R
+            m_JIT->EmitLoad(r, R);
+            m_JIT->EmitCycles(4, nextAddress);
+        }
+        else if ((opCode & 0xC7) == 0x06 && r != 0x06)
+        {
+            // LD r, n
+            m_JIT->EmitLoadImmediate(r, n);
+            m_JIT->EmitCycles(8, nextAddress);
+        }
+        else if ((opCode & 0xCF) == 0x01)
+        {
+            // LD rr, nn
+            m_JIT->EmitLoadPairImmediate(r >> 1, nn);
+            m_JIT->EmitCycles(12, nextAddress);
+        }
+        else if ((opCode & 0xC7) == 0x03)
+        {
+            // INC rr / DEC rr
+            m_JIT->EmitIncrementPair(r >> 1, (opCode & 0x08) != 0x00);
+            m_JIT->EmitCycles(8, nextAddress);
+        }
+        else if ((opCode & 0xC6) == 0x04 && r != 0x06)
+        {
+            // INC r / DEC r
+            m_JIT->EmitIncrement(r, (opCode & 0x01) != 0x00);
+            m_JIT->EmitCycles(4, nextAddress);
+        }
+        else if (opCode >= 0x80 && opCode <= 0xBF && R != 0x06)
+        {
+            // ADD/ADC/SUB/SBC/AND/XOR/OR/CP A, R
+            m_JIT->EmitALU(r, R);
+            m_JIT->EmitCycles(4, nextAddress);
+        }
+        else if ((opCode & 0xC7) == 0xC6)
+        {
+            // ADD/ADC/SUB/SBC/AND/XOR/OR/CP A, n
+            m_JIT->EmitALUImmediate(r, n);
+            m_JIT->EmitCycles(8, nextAddress);
+        }
+        else if (opCode == 0x2F || opCode == 0x37 || opCode == 0x3F)
+        {
+            // CPL / SCF / CCF
+            (opCode == 0x2F) ? m_JIT->EmitCPL() : (opCode == 0x37) ? m_JIT->EmitSCF() : m_JIT->EmitCCF();
+            m_JIT->EmitCycles(4, nextAddress);
+        }
+        else if (opCode == 0x18 || (opCode & 0xE7) == 0x20)
+        {
+            // JR e / JR cc, e
+            byte condition = (opCode == 0x18) ? JumpAlways : (r & 0x03);
+            m_JIT->EmitJump(condition, nextAddress + static_cast<sbyte>(n), 12, 8, nextAddress);
+        }
+        else if (opCode == 0xC3 || (opCode & 0xE7) == 0xC2)
+        {
+            // JP nn / JP cc, nn
+            byte condition = (opCode == 0xC3) ? JumpAlways : (r & 0x03);
+            m_JIT->EmitJump(condition, nn, 16, 12, nextAddress);
+        }
+        else if (opCode == 0xCB)
+        {
+            m_JIT->EmitInstruction(m_translatedInstructionsCB[n], address, 0);
+        }
+        else
+        {
+            m_JIT->EmitInstruction(m_translatedInstructions[opCode], address, nn);
+        }
+
+        address = nextAddress;
+    }
+
+    pBlock->pCompiled = m_JIT->EndBlock(pBlock->endAddress);
+}
+
+unsigned long CPU::RunCompiledBlock(DecodedBlock* pBlock)
+{
+    // The compiled code reads and writes F directly, and only adds to m_cycles
+    MaterializeFlags();
+    unsigned long long startCycles = m_cycles;
+    m_isBlockExitRequested = false;
+
+    pBlock->pCompiled(this);
+    return static_cast<unsigned long>(m_cycles - startCycles);
+}
+#endif
@@ -7,6 +7,12 @@
 #include "Joypad.hpp"
 #include "Serial.hpp"
 #include "Timer.hpp"
+#include "JIT.hpp"
+#include "Scheduler.hpp"
+
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 /*
     The Flag Register (lower 8bit of AF register)
@@ -22,6 +28,39 @@
 #define HalfCarryFlag   5
 #define CarryFlag       4
 
+/*
+    Interpreter core, selected at build time
+    0 - Dispatch through the m_operationMap/m_operationMapCB member function pointer tables
+    1 - Dispatch through a dense switch, which lets the handlers be inlined into the core
+*/
+#ifndef CPU_SWITCH_DISPATCH
+#define CPU_SWITCH_DISPATCH 1
+#endif
+
+/*
+    Optional JIT for hot blocks of ROM code (x86-64 only)
+    0 - Decoded blocks are always interpreted
+    1 - Blocks run JITThreshold times are compiled to native code
+*/
+#ifndef CPU_JIT
+#define CPU_JIT 0
+#endif
+
+#if !JIT_SUPPORTED
+#undef CPU_JIT
+#define CPU_JIT 0
+#endif
+
+/*
+    Lazy flag evaluation
+    0 - The ALU instructions write Z/N/H/C to F as they run
+    1 - The ALU instructions record their operands and result, and Z/N/H/C are only materialized
+        into F when an instruction reads or partially updates them
+*/
+#ifndef CPU_LAZY_FLAGS
+#define CPU_LAZY_FLAGS 0
+#endif
+
 class CPU : public ICPU
 {
     friend class CPUTests;
@@ -37,17 +76,35 @@ public:
     bool Initialize();
     bool LoadROM(const char* bootROMPath, const char* cartridgePath);
     int Step();
+    unsigned long RunCycles(unsigned long cycles);
+    unsigned long RunFrame();
+    unsigned long RunUntilVBlank();
     void TriggerInterrupt(byte interrupt);
     byte* GetCurrentFrame();
     void SetInput(byte input, byte buttons);
     void SetVSyncCallback(void(*pCallback)());
+    void SetIdleLoopSkipping(bool isEnabled);
+    unsigned long long GetIdleCyclesSkipped();
+    void SetFrameSkip(unsigned int framesToSkip);
+    void RequestFrame();
+    void SetFrameSink(IFrameSink* pSink);
+    bool SetPixelFormat(int pixelFormat);
+    void GetShadePalette(unsigned int* pPalette);
+    unsigned int ReadAudioSamples(short* pSamples, unsigned int count);
+    bool SetAudioOutput(bool isEnabled);
+    unsigned int GetAudioQueueLevel();
+    unsigned int GetAudioUnderrunCount();
+    bool SetAudioRateAdjustment(int samplesPerSecond);
 
 private:
     static byte GetHighByte(ushort dest);
     static byte GetLowByte(ushort dest);
+    static byte GetLowestSetBit(byte val);
 
     byte* GetByteRegister(byte val);
     ushort* GetUShortRegister(byte val, bool useAF);
+    template<byte index> byte* GetByteRegister();
+    template<byte index, bool useAF> ushort* GetUShortRegister();
 
     void SetHighByte(ushort* dest, byte val);
     void SetLowByte(ushort* dest, byte val);
@@ -55,50 +112,101 @@ private:
     void SetFlag(byte flag);
     void ClearFlag(byte flag);
     bool IsFlagSet(byte flag);
+    void SetALUFlags(byte op, byte a, byte b, byte carry, byte result);
+    void MaterializeFlags();
 
-    void PushByteToSP(byte val);
     void PushUShortToSP(ushort val);
     ushort PopUShort();
     byte PopByte();
     byte ReadBytePC();
     ushort ReadUShortPC();
+    byte ReadByte(const ushort& address);
+    void WriteByte(const ushort& address, const byte val);
+    void WriteUShort(const ushort& address, const ushort val);
 
     byte AddByte(byte b1, byte b2);
     ushort AddUShort(ushort u1, ushort u2);
     void ADC(byte val);
     void SBC(byte val);
 
+    unsigned long GetCyclesUntilNextEvent();
+    void AdvanceCycles(unsigned long cycles);
     void HandleInterrupts();
 
+    // Interpreter core
+    unsigned long Execute(const byte& opCode);
+    unsigned long ExecuteCB(const byte& opCode);
+    unsigned long InvalidOpCode(const byte& opCode);
+
+    // Block cache
+    struct DecodedInstruction
+    {
+        byte opCode;        // 0xCB for the CB prefixed instructions
+        byte length;        // Length of the instruction in bytes
+        byte operands[2];   // Immediate operands, or the CB opCode
+    };
+
+    struct DecodedBlock
+    {
+        ushort startAddress;
+        ushort endAddress;  // First address after the block
+        std::vector<DecodedInstruction> instructions;
+        unsigned int runCount;
+        CompiledBlock pCompiled;
+        ushort idleLoopAddress;         // The register polled by the block, if it is an idle loop
+        byte idleLoopValue;             // The value and AF of the last iteration that looped back
+        ushort idleLoopAF;
+        unsigned long idleLoopCycles;   // Cycles of that iteration, 0 if there was none
+    };
+
+    DecodedBlock* GetDecodedBlock(const ushort& address);
+    std::unique_ptr<DecodedBlock> DecodeBlock(const ushort& address, const ushort& regionEnd);
+    unsigned long RunDecodedBlock(DecodedBlock* pBlock);
+    static ushort GetIdleLoopAddress(const DecodedBlock* pBlock);
+    unsigned long RunIdleLoop(DecodedBlock* pBlock);
+    bool CompleteBlockInstruction(unsigned long cycles, const ushort& nextAddress);
+    void InvalidateDecodedBlocks(const ushort& address);
+
+#if CPU_JIT
+    // JIT
+    template<byte opCode> static bool RunTranslatedInstruction(CPU* pCPU, unsigned int operands);
+    template<byte opCode> static bool RunTranslatedInstructionCB(CPU* pCPU, unsigned int operands);
+    static bool RunTranslatedEvents(CPU* pCPU);
+    template<size_t... opCodes> void InitializeTranslatedInstructions(std::index_sequence<opCodes...>);
+    bool InitializeJIT();
+    void CompileDecodedBlock(DecodedBlock* pBlock);
+    unsigned long RunCompiledBlock(DecodedBlock* pBlock);
+#endif
+
     // TODO: Organize the following...
     // Z80 Instruction Set
     unsigned long NOP(const byte& opCode);             // 0x00
 
-    unsigned long LDrn(const byte& opCode);
-    unsigned long LDrR(const byte& opCode);
-    unsigned long LDrrnn(const byte& opCode);
-    unsigned long INCr(const byte& opCode);
-    unsigned long INCrr(const byte& opCode);
-    unsigned long DECrr(const byte& opCode);
-    unsigned long ORr(const byte& opCode);
-    unsigned long XORr(const byte& opCode);
-    unsigned long PUSHrr(const byte& opCode);
-    unsigned long POPrr(const byte& opCode);
-    unsigned long DECr(const byte& opCode);
-    unsigned long SUBr(const byte& opCode);
-    unsigned long SBCAr(const byte& opCode);
-    unsigned long CALLccnn(const byte& opCode);
-    unsigned long LDr_HL_(const byte& opCode);
-    unsigned long LD_HL_r(const byte& opCode);
-    unsigned long RETcc(const byte& opCode);
-    unsigned long ADDHLss(const byte& opCode);
-    unsigned long JPccnn(const byte& opCode);
-    unsigned long ADDAr(const byte& opCode);
-    unsigned long ADCAr(const byte& opCode);
-    unsigned long JRcce(const byte& opCode);
-    unsigned long ANDr(const byte& opCode);
-    unsigned long CPr(const byte& opCode);
-    unsigned long RSTn(const byte& opCode);
+    template<byte rIndex> unsigned long LDrn(const byte& opCode);
+    template<byte rIndex, byte RIndex> unsigned long LDrR(const byte& opCode);
+    template<byte rrIndex> unsigned long LDrrnn(const byte& opCode);
+    template<byte rIndex> unsigned long INCr(const byte& opCode);
+    template<byte rrIndex> unsigned long INCrr(const byte& opCode);
+    template<byte rrIndex> unsigned long DECrr(const byte& opCode);
+    template<byte rIndex> unsigned long ORr(const byte& opCode);
+    template<byte rIndex> unsigned long XORr(const byte& opCode);
+    template<byte rrIndex> unsigned long PUSHrr(const byte& opCode);
+    template<byte rrIndex> unsigned long POPrr(const byte& opCode);
+    template<byte rIndex> unsigned long DECr(const byte& opCode);
+    template<byte rIndex> unsigned long SUBr(const byte& opCode);
+    template<byte rIndex> unsigned long SBCAr(const byte& opCode);
+    template<byte cc> unsigned long CALLccnn(const byte& opCode);
+    template<byte rIndex> unsigned long LDr_HL_(const byte& opCode);
+    template<byte rIndex> unsigned long LD_HL_r(const byte& opCode);
+    template<byte cc> unsigned long RETcc(const byte& opCode);
+    template<byte ssIndex> unsigned long ADDHLss(const byte& opCode);
+    template<byte cc> unsigned long JPccnn(const byte& opCode);
+    template<byte rIndex> unsigned long ADDAr(const byte& opCode);
+    template<byte rIndex> unsigned long ADCAr(const byte& opCode);
+    template<byte cc> unsigned long JRcce(const byte& opCode);
+    template<byte rIndex> unsigned long ANDr(const byte& opCode);
+    template<byte rIndex> unsigned long CPr(const byte& opCode);
+    template<byte t> unsigned long RSTn(const byte& opCode);
 
     unsigned long LD_BC_A(const byte& opCode);         // 0x02
     unsigned long RLCA(const byte& opCode);            // 0x07
@@ -157,27 +265,27 @@ private:
     unsigned long CPn(const byte& opCode);             // 0xFE
 
     // Z80 Instruction Set - CB
-    unsigned long RLCr(const byte& opCode);
+    template<byte rIndex> unsigned long RLCr(const byte& opCode);
     unsigned long RLC_HL_(const byte& opCode);
-    unsigned long RRCr(const byte& opCode);
+    template<byte rIndex> unsigned long RRCr(const byte& opCode);
     unsigned long RRC_HL_(const byte& opCode);
-    unsigned long RLr(const byte& opCode);
+    template<byte rIndex> unsigned long RLr(const byte& opCode);
     unsigned long RL_HL_(const byte& opCode);
-    unsigned long RRr(const byte& opCode);
+    template<byte rIndex> unsigned long RRr(const byte& opCode);
     unsigned long RR_HL_(const byte& opCode);
-    unsigned long SLAr(const byte& opCode);
+    template<byte rIndex> unsigned long SLAr(const byte& opCode);
     unsigned long SLA_HL_(const byte& opCode);
-    unsigned long SRLr(const byte& opCode);
+    template<byte rIndex> unsigned long SRLr(const byte& opCode);
     unsigned long SRL_HL_(const byte& opCode);
-    unsigned long SRAr(const byte& opCode);
+    template<byte rIndex> unsigned long SRAr(const byte& opCode);
     unsigned long SRA_HL_(const byte& opCode);
-    unsigned long BITbr(const byte& opCode);
-    unsigned long BITb_HL_(const byte& opCode);
-    unsigned long RESbr(const byte& opCode);
-    unsigned long RESb_HL_(const byte& opCode);
-    unsigned long SETbr(const byte& opCode);
-    unsigned long SETb_HL_(const byte& opCode);
-    unsigned long SWAPr(const byte& opCode);
+    template<byte bit, byte rIndex> unsigned long BITbr(const byte& opCode);
+    template<byte bit> unsigned long BITb_HL_(const byte& opCode);
+    template<byte bit, byte rIndex> unsigned long RESbr(const byte& opCode);
+    template<byte bit> unsigned long RESb_HL_(const byte& opCode);
+    template<byte bit, byte rIndex> unsigned long SETbr(const byte& opCode);
+    template<byte bit> unsigned long SETb_HL_(const byte& opCode);
+    template<byte rIndex> unsigned long SWAPr(const byte& opCode);
     unsigned long SWAP_HL_(const byte& opCode);
 
 private:
@@ -202,8 +310,11 @@ private:
     // Timer
     std::unique_ptr<Timer> m_timer;
 
+    // Scheduler
+    std::unique_ptr<Scheduler> m_scheduler;
+
     // Clock cycles
-    unsigned long m_cycles; // The current number of cycles
+    unsigned long long m_cycles; // The current number of cycles, the master clock of the scheduler
     bool m_isHalted;
 
     // Registers
@@ -216,11 +327,40 @@ private:
     byte* m_ByteRegisterMap[0x07 + 1];
     ushort* m_UShortRegisterMap[0x03 + 1];
 
+    // Lazy flags, the ALU instruction whose flags have not been written to F yet
+    byte m_lazyFlagsOp;
+    byte m_lazyFlagsA;
+    byte m_lazyFlagsB;
+    byte m_lazyFlagsCarry;
+    byte m_lazyFlagsResult;
+
     // Interrupts
     byte m_IME; // Interrupt master enable
+    byte m_IE;  // Copy of the interrupt enable register (0xFFFF)
+    byte m_IF;  // Copy of the interrupt flag register (0xFF0F)
+
+    // Block cache, keyed by (ROM bank << 16) | address
+    bool m_isBlockCacheEnabled;
+    bool m_isBlockExitRequested;    // Set when a write may have changed the code being run
+    const byte* m_pDecodedOperand;  // Operands of the decoded instruction being run, if any
+    ushort m_ROMBank;               // The ROM bank mapped to 0x4000-0x7FFF
+    std::unordered_map<unsigned int, std::unique_ptr<DecodedBlock>> m_decodedBlocks;
+    std::vector<unsigned int> m_decodedBlockPages[0xFF + 1]; // Keys of the blocks decoded from RAM, by page
+    unsigned long m_blockCycles;    // Cycles run by the current block
+
+    // Idle loop skipping
+    bool m_isIdleLoopSkippingEnabled;
+    unsigned long long m_idleCyclesSkipped;
+
+#if CPU_JIT
+    // JIT
+    std::unique_ptr<JIT> m_JIT;
+    TranslatedInstruction m_translatedInstructions[0xFF + 1];
+    TranslatedInstruction m_translatedInstructionsCB[0xFF + 1];
+#endif
 
     // OpCode Function Map
     typedef unsigned long(CPU::*opCodeFunction)(const byte& opCode);
-    opCodeFunction m_operationMap[0xFF + 1];
-    opCodeFunction m_operationMapCB[0xFF + 1];
+    static const opCodeFunction m_operationMap[0xFF + 1];
+    static const opCodeFunction m_operationMapCB[0xFF + 1];
 };
@@ -79,6 +79,19 @@ bool Cartridge::LoadROM(const char* path)
 }
 
 // IMemoryUnit
+// Maps the fixed ROM bank 00 and the banks currently selected by the MBC into the MMU
+void Cartridge::MapMemory(IMMU* pMMU)
+{
+    if (m_MBC == nullptr)
+    {
+        return;
+    }
+
+    pMMU->MapMemory(0x0000, 0x3FFF, m_ROM.get(), false);
+    pMMU->MapMemory(0x4000, 0x7FFF, m_MBC->GetROMBankMemory(), false);
+    pMMU->MapMemory(0xA000, 0xBFFF, m_MBC->GetRAMBankMemory(), true);
+}
+
 byte Cartridge::ReadByte(const ushort& address)
 {
     return m_MBC->ReadByte(address);
@@ -89,6 +102,11 @@ bool Cartridge::WriteByte(const ushort& address, const byte val)
     return m_MBC->WriteByte(address, val);
 }
 
+ushort Cartridge::GetROMBank()
+{
+    return m_MBC->GetROMBank();
+}
+
 bool Cartridge::LoadMBC(unsigned int actualSize)
 {
     m_MBCType = m_ROM.get()[CartridgeTypeAddress];
@@ -67,6 +67,8 @@ RAM of 512 x 4 bits.
 #define RAM_8KB         0x02
 #define RAM_32KB        0x03
 
+class MBC;
+
 class Cartridge : public IMemoryUnit
 {
 public:
@@ -74,11 +76,15 @@ public:
     ~Cartridge();
 
     bool LoadROM(const char* path);
+    void MapMemory(IMMU* pMMU);
 
     // IMemoryUnit
     byte ReadByte(const ushort& address);
     bool WriteByte(const ushort& address, const byte val);
 
+    // The ROM bank currently mapped to 0x4000-0x7FFF
+    ushort GetROMBank();
+
 private:
     bool LoadMBC(unsigned int actualSize);
 
@@ -88,5 +94,5 @@ private:
     unsigned int m_RAMSize;
     std::unique_ptr<byte> m_ROM;
     std::unique_ptr<byte> m_RAM;
-    std::unique_ptr<IMemoryUnit> m_MBC;
+    std::unique_ptr<MBC> m_MBC;
 };
@@ -0,0 +1,551 @@
+#include "pch.hpp"
+#include "Compositor.hpp"
+
+#if SIMD_SUPPORTED
+#include <immintrin.h>
+#if WINDOWS
+#include <intrin.h>
+#define AVX2_FUNCTION
+#else
+#define AVX2_FUNCTION __attribute__((target("avx2")))
+#endif
+#endif
+
+static void ScalarExpandTileRow(byte low, byte high, byte* pIndexes)
+{
+    for (byte x = 0; x < 8; x++)
+    {
+        byte bit = 7 - x;
+        pIndexes[x] = ((low >> bit) & 0x01) | (((high >> bit) & 0x01) << 1);
+    }
+}
+
+static void ScalarWritePixels(const byte* pIndexes, const unsigned int* pPalette, unsigned int count, byte* pPixels)
+{
+    for (unsigned int i = 0; i < count; i++)
+    {
+        memcpy(pPixels + (i * 4), &pPalette[pIndexes[i]], 4);
+    }
+}
+
+static void ScalarWritePixels16(const byte* pIndexes, const unsigned int* pPalette, unsigned int count, byte* pPixels)
+{
+    for (unsigned int i = 0; i < count; i++)
+    {
+        memcpy(pPixels + (i * 2), &pPalette[pIndexes[i]], 2);
+    }
+}
+
+static void ScalarWritePixels8(const byte* pIndexes, const unsigned int* pPalette, unsigned int count, byte* pPixels)
+{
+    for (unsigned int i = 0; i < count; i++)
+    {
+        pPixels[i] = static_cast<byte>(pPalette[pIndexes[i]]);
+    }
+}
+
+/*
+    Sprites are drawn from the highest priority to the lowest, straight over the BG pixels. A pixel
+    is drawn unless it is transparent (index 0), a sprite was already drawn there (pIsDrawn), or
+    the sprite is behind the BG and the BG pixel's red is not that of BG color 0 (the whole pixel
+    for indexed pixels). Every pixel a sprite
+    did not draw to still holds the BG, so the result is the same as drawing the sprites from the
+    lowest priority up over a separate copy of the BG.
+*/
+static void ScalarOverlayPixels(
+    const byte* pIndexes,
+    const unsigned int* pPalette,
+    bool isBehindBG,
+    unsigned int bgColor0,
+    unsigned int count,
+    byte* pPixels,
+    unsigned int* pIsDrawn)
+{
+    byte bgRed0 = static_cast<byte>(bgColor0 >> 24);
+    for (unsigned int i = 0; i < count; i++)
+    {
+        if (pIndexes[i] != 0x00 && pIsDrawn[i] == 0 && (!isBehindBG || pPixels[(i * 4) + 3] == bgRed0))
+        {
+            memcpy(pPixels + (i * 4), &pPalette[pIndexes[i]], 4);
+            pIsDrawn[i] = 0xFFFFFFFF;
+        }
+    }
+}
+
+static void ScalarOverlayPixels16(
+    const byte* pIndexes,
+    const unsigned int* pPalette,
+    bool isBehindBG,
+    unsigned int bgColor0,
+    unsigned int count,
+    byte* pPixels,
+    unsigned int* pIsDrawn)
+{
+    for (unsigned int i = 0; i < count; i++)
+    {
+        ushort bg;
+        memcpy(&bg, pPixels + (i * 2), 2);
+        if (pIndexes[i] != 0x00 && pIsDrawn[i] == 0 && (!isBehindBG || (bg & 0xF800) == (bgColor0 & 0xF800)))
+        {
+            memcpy(pPixels + (i * 2), &pPalette[pIndexes[i]], 2);
+            pIsDrawn[i] = 0xFFFFFFFF;
+        }
+    }
+}
+
+static void ScalarOverlayPixels8(
+    const byte* pIndexes,
+    const unsigned int* pPalette,
+    bool isBehindBG,
+    unsigned int bgColor0,
+    unsigned int count,
+    byte* pPixels,
+    unsigned int* pIsDrawn)
+{
+    for (unsigned int i = 0; i < count; i++)
+    {
+        if (pIndexes[i] != 0x00 && pIsDrawn[i] == 0 && (!isBehindBG || pPixels[i] == static_cast<byte>(bgColor0)))
+        {
+            pPixels[i] = static_cast<byte>(pPalette[pIndexes[i]]);
+            pIsDrawn[i] = 0xFFFFFFFF;
+        }
+    }
+}
+
+#if SIMD_SUPPORTED
+static void SSE2ExpandTileRow(byte low, byte high, byte* pIndexes)
+{
+    // Each lane tests the bit of its pixel, the upper 8 lanes are never stored
+    const __m128i bits = _mm_setr_epi8(
+        (char)0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01, 0, 0, 0, 0, 0, 0, 0, 0);
+
+    __m128i lo = _mm_cmpeq_epi8(_mm_and_si128(_mm_set1_epi8((char)low), bits), bits);
+    __m128i hi = _mm_cmpeq_epi8(_mm_and_si128(_mm_set1_epi8((char)high), bits), bits);
+    __m128i indexes = _mm_or_si128(
+        _mm_and_si128(lo, _mm_set1_epi8(0x01)),
+        _mm_and_si128(hi, _mm_set1_epi8(0x02)));
+
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(pIndexes), indexes);
+}
+
+// Looks up 4 pixels from 4 color indexes held as 32-bit lanes
+static inline __m128i SSE2Lookup(__m128i indexes, const __m128i* pPalette)
+{
+    __m128i pixels = _mm_and_si128(_mm_cmpeq_epi32(indexes, _mm_setzero_si128()), pPalette[0]);
+    pixels = _mm_or_si128(pixels, _mm_and_si128(_mm_cmpeq_epi32(indexes, _mm_set1_epi32(1)), pPalette[1]));
+    pixels = _mm_or_si128(pixels, _mm_and_si128(_mm_cmpeq_epi32(indexes, _mm_set1_epi32(2)), pPalette[2]));
+    pixels = _mm_or_si128(pixels, _mm_and_si128(_mm_cmpeq_epi32(indexes, _mm_set1_epi32(3)), pPalette[3]));
+    return pixels;
+}
+
+static inline __m128i SSE2LoadIndexes(const byte* pIndexes)
+{
+    int indexes;
+    memcpy(&indexes, pIndexes, sizeof(indexes));
+
+    __m128i zero = _mm_setzero_si128();
+    return _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(indexes), zero), zero);
+}
+
+static void SSE2WritePixels(const byte* pIndexes, const unsigned int* pPalette, unsigned int count, byte* pPixels)
+{
+    const __m128i palette[]
+    {
+        _mm_set1_epi32(static_cast<int>(pPalette[0])),
+        _mm_set1_epi32(static_cast<int>(pPalette[1])),
+        _mm_set1_epi32(static_cast<int>(pPalette[2])),
+        _mm_set1_epi32(static_cast<int>(pPalette[3])),
+    };
+    const __m128i zero = _mm_setzero_si128();
+
+    unsigned int i = 0;
+    for (; i + 16 <= count; i += 16)
+    {
+        // Widen 16 indexes to 4 groups of 32-bit lanes
+        __m128i indexes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pIndexes + i));
+        __m128i lo = _mm_unpacklo_epi8(indexes, zero);
+        __m128i hi = _mm_unpackhi_epi8(indexes, zero);
+
+        __m128i* pOut = reinterpret_cast<__m128i*>(pPixels + (i * 4));
+        _mm_storeu_si128(pOut + 0, SSE2Lookup(_mm_unpacklo_epi16(lo, zero), palette));
+        _mm_storeu_si128(pOut + 1, SSE2Lookup(_mm_unpackhi_epi16(lo, zero), palette));
+        _mm_storeu_si128(pOut + 2, SSE2Lookup(_mm_unpacklo_epi16(hi, zero), palette));
+        _mm_storeu_si128(pOut + 3, SSE2Lookup(_mm_unpackhi_epi16(hi, zero), palette));
+    }
+
+    for (; i + 4 <= count; i += 4)
+    {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pPixels + (i * 4)), SSE2Lookup(SSE2LoadIndexes(pIndexes + i), palette));
+    }
+
+    ScalarWritePixels(pIndexes + i, pPalette, count - i, pPixels + (i * 4));
+}
+
+static void SSE2WritePixels16(const byte* pIndexes, const unsigned int* pPalette, unsigned int count, byte* pPixels)
+{
+    const __m128i zero = _mm_setzero_si128();
+
+    unsigned int i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        // Widen 8 indexes to 16-bit lanes
+        __m128i indexes = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(pIndexes + i)), zero);
+        __m128i pixels = _mm_and_si128(_mm_cmpeq_epi16(indexes, zero), _mm_set1_epi16(static_cast<short>(pPalette[0])));
+        pixels = _mm_or_si128(pixels, _mm_and_si128(_mm_cmpeq_epi16(indexes, _mm_set1_epi16(1)), _mm_set1_epi16(static_cast<short>(pPalette[1]))));
+        pixels = _mm_or_si128(pixels, _mm_and_si128(_mm_cmpeq_epi16(indexes, _mm_set1_epi16(2)), _mm_set1_epi16(static_cast<short>(pPalette[2]))));
+        pixels = _mm_or_si128(pixels, _mm_and_si128(_mm_cmpeq_epi16(indexes, _mm_set1_epi16(3)), _mm_set1_epi16(static_cast<short>(pPalette[3]))));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pPixels + (i * 2)), pixels);
+    }
+
+    ScalarWritePixels16(pIndexes + i, pPalette, count - i, pPixels + (i * 2));
+}
+
+static void SSE2WritePixels8(const byte* pIndexes, const unsigned int* pPalette, unsigned int count, byte* pPixels)
+{
+    unsigned int i = 0;
+    for (; i + 16 <= count; i += 16)
+    {
+        __m128i indexes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pIndexes + i));
+        __m128i pixels = _mm_and_si128(_mm_cmpeq_epi8(indexes, _mm_setzero_si128()), _mm_set1_epi8(static_cast<char>(pPalette[0])));
+        pixels = _mm_or_si128(pixels, _mm_and_si128(_mm_cmpeq_epi8(indexes, _mm_set1_epi8(1)), _mm_set1_epi8(static_cast<char>(pPalette[1]))));
+        pixels = _mm_or_si128(pixels, _mm_and_si128(_mm_cmpeq_epi8(indexes, _mm_set1_epi8(2)), _mm_set1_epi8(static_cast<char>(pPalette[2]))));
+        pixels = _mm_or_si128(pixels, _mm_and_si128(_mm_cmpeq_epi8(indexes, _mm_set1_epi8(3)), _mm_set1_epi8(static_cast<char>(pPalette[3]))));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pPixels + i), pixels);
+    }
+
+    ScalarWritePixels8(pIndexes + i, pPalette, count - i, pPixels + i);
+}
+
+static void SSE2OverlayPixels(
+    const byte* pIndexes,
+    const unsigned int* pPalette,
+    bool isBehindBG,
+    unsigned int bgColor0,
+    unsigned int count,
+    byte* pPixels,
+    unsigned int* pIsDrawn)
+{
+    const __m128i palette[]
+    {
+        _mm_set1_epi32(static_cast<int>(pPalette[0])),
+        _mm_set1_epi32(static_cast<int>(pPalette[1])),
+        _mm_set1_epi32(static_cast<int>(pPalette[2])),
+        _mm_set1_epi32(static_cast<int>(pPalette[3])),
+    };
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i redMask = _mm_set1_epi32(static_cast<int>(0xFF000000));
+    const __m128i bgRed0 = _mm_set1_epi32(static_cast<int>(bgColor0 & 0xFF000000));
+
+    unsigned int i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i indexes = SSE2LoadIndexes(pIndexes + i);
+        __m128i* pOut = reinterpret_cast<__m128i*>(pPixels + (i * 4));
+        __m128i* pDrawn = reinterpret_cast<__m128i*>(pIsDrawn + i);
+        __m128i bg = _mm_loadu_si128(pOut);
+        __m128i isDrawn = _mm_loadu_si128(pDrawn);
+
+        // Opaque and not drawn yet
+        __m128i mask = _mm_andnot_si128(_mm_or_si128(_mm_cmpeq_epi32(indexes, zero), isDrawn), _mm_set1_epi32(-1));
+        if (isBehindBG)
+        {
+            mask = _mm_and_si128(mask, _mm_cmpeq_epi32(_mm_and_si128(bg, redMask), bgRed0));
+        }
+
+        __m128i pixels = _mm_or_si128(
+            _mm_and_si128(mask, SSE2Lookup(indexes, palette)),
+            _mm_andnot_si128(mask, bg));
+        _mm_storeu_si128(pOut, pixels);
+        _mm_storeu_si128(pDrawn, _mm_or_si128(isDrawn, mask));
+    }
+
+    ScalarOverlayPixels(pIndexes + i, pPalette, isBehindBG, bgColor0, count - i, pPixels + (i * 4), pIsDrawn + i);
+}
+
+AVX2_FUNCTION static void AVX2WritePixels(const byte* pIndexes, const unsigned int* pPalette, unsigned int count, byte* pPixels)
+{
+    // The palette sits in both halves, the permute picks a pixel for each 32-bit index
+    const __m256i palette = _mm256_setr_epi32(
+        static_cast<int>(pPalette[0]), static_cast<int>(pPalette[1]), static_cast<int>(pPalette[2]), static_cast<int>(pPalette[3]),
+        static_cast<int>(pPalette[0]), static_cast<int>(pPalette[1]), static_cast<int>(pPalette[2]), static_cast<int>(pPalette[3]));
+
+    unsigned int i = 0;
+    for (; i + 16 <= count; i += 16)
+    {
+        __m128i indexes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pIndexes + i));
+        __m256i* pOut = reinterpret_cast<__m256i*>(pPixels + (i * 4));
+        _mm256_storeu_si256(pOut + 0, _mm256_permutevar8x32_epi32(palette, _mm256_cvtepu8_epi32(indexes)));
+        _mm256_storeu_si256(pOut + 1, _mm256_permutevar8x32_epi32(palette, _mm256_cvtepu8_epi32(_mm_srli_si128(indexes, 8))));
+    }
+
+    for (; i + 8 <= count; i += 8)
+    {
+        __m128i indexes = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(pIndexes + i));
+        _mm256_storeu_si256(
+            reinterpret_cast<__m256i*>(pPixels + (i * 4)),
+            _mm256_permutevar8x32_epi32(palette, _mm256_cvtepu8_epi32(indexes)));
+    }
+
+    ScalarWritePixels(pIndexes + i, pPalette, count - i, pPixels + (i * 4));
+}
+
+AVX2_FUNCTION static void AVX2OverlayPixels(
+    const byte* pIndexes,
+    const unsigned int* pPalette,
+    bool isBehindBG,
+    unsigned int bgColor0,
+    unsigned int count,
+    byte* pPixels,
+    unsigned int* pIsDrawn)
+{
+    const __m256i palette = _mm256_setr_epi32(
+        static_cast<int>(pPalette[0]), static_cast<int>(pPalette[1]), static_cast<int>(pPalette[2]), static_cast<int>(pPalette[3]),
+        static_cast<int>(pPalette[0]), static_cast<int>(pPalette[1]), static_cast<int>(pPalette[2]), static_cast<int>(pPalette[3]));
+    const __m256i redMask = _mm256_set1_epi32(static_cast<int>(0xFF000000));
+    const __m256i bgRed0 = _mm256_set1_epi32(static_cast<int>(bgColor0 & 0xFF000000));
+
+    unsigned int i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256i indexes = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(pIndexes + i)));
+        __m256i* pOut = reinterpret_cast<__m256i*>(pPixels + (i * 4));
+        __m256i* pDrawn = reinterpret_cast<__m256i*>(pIsDrawn + i);
+        __m256i bg = _mm256_loadu_si256(pOut);
+        __m256i isDrawn = _mm256_loadu_si256(pDrawn);
+
+        // Opaque and not drawn yet
+        __m256i mask = _mm256_xor_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi32(indexes, _mm256_setzero_si256()), isDrawn),
+            _mm256_set1_epi32(-1));
+        if (isBehindBG)
+        {
+            mask = _mm256_and_si256(mask, _mm256_cmpeq_epi32(_mm256_and_si256(bg, redMask), bgRed0));
+        }
+
+        _mm256_storeu_si256(pOut, _mm256_blendv_epi8(bg, _mm256_permutevar8x32_epi32(palette, indexes), mask));
+        _mm256_storeu_si256(pDrawn, _mm256_or_si256(isDrawn, mask));
+    }
+
+    SSE2OverlayPixels(pIndexes + i, pPalette, isBehindBG, bgColor0, count - i, pPixels + (i * 4), pIsDrawn + i);
+}
+#endif
+
+Compositor::Compositor() :
+    m_kernel(KernelScalar),
+    m_pixelFormat(PixelFormatRGBA8888),
+    m_pExpandTileRow(ScalarExpandTileRow),
+    m_pWritePixels(ScalarWritePixels),
+    m_pOverlayPixels(ScalarOverlayPixels)
+{
+    SetKernel(GetBestKernel());
+}
+
+Compositor::~Compositor()
+{
+}
+
+int Compositor::GetBestKernel()
+{
+#if SIMD_SUPPORTED
+#if WINDOWS
+    // AVX2 also needs the OS to save the YMM registers (OSXSAVE and XCR0 bits 1-2)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] >= 7)
+    {
+        __cpuid(info, 1);
+        bool isAVXEnabled = ((info[2] & (1 << 27)) != 0) && ((info[2] & (1 << 28)) != 0) && ((_xgetbv(0) & 0x06) == 0x06);
+
+        __cpuidex(info, 7, 0);
+        if (isAVXEnabled && ((info[1] & (1 << 5)) != 0))
+        {
+            return KernelAVX2;
+        }
+    }
+#else
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return KernelAVX2;
+    }
+#endif
+
+    // SSE2 is part of x86-64
+    return KernelSSE2;
+#else
+    return KernelScalar;
+#endif
+}
+
+/*
+    Packs a pixel so storing it as a little-endian unsigned int writes the bytes A, B, G, R
+*/
+unsigned int Compositor::MakePixel(byte red, byte green, byte blue)
+{
+    return 0x000000FF | (blue << 8) | (green << 16) | (static_cast<unsigned int>(red) << 24);
+}
+
+/*
+    Packs a pixel as RGB565, 5 bits of red in the high bits of a little-endian ushort
+*/
+unsigned int Compositor::MakePixel565(byte red, byte green, byte blue)
+{
+    return ((red >> 3) << 11) | ((green >> 2) << 5) | (blue >> 3);
+}
+
+/*
+    Returns the bytes per pixel of a pixel format, 0 if it is not supported
+*/
+unsigned int Compositor::GetPixelSize(int pixelFormat)
+{
+    switch (pixelFormat)
+    {
+    case PixelFormatRGBA8888:
+        return 4;
+    case PixelFormatRGB565:
+        return 2;
+    case PixelFormatIndexed:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+bool Compositor::SetKernel(int kernel)
+{
+    switch (kernel)
+    {
+    case KernelScalar:
+        break;
+#if SIMD_SUPPORTED
+    case KernelSSE2:
+        break;
+    case KernelAVX2:
+        if (GetBestKernel() != KernelAVX2)
+        {
+            Logger::Log("Compositor::SetKernel - AVX2 is not supported by this CPU.");
+            return false;
+        }
+        break;
+#endif
+    default:
+        Logger::Log("Compositor::SetKernel - Kernel %d is not supported.", kernel);
+        return false;
+    }
+
+    m_kernel = kernel;
+    SelectKernels();
+    return true;
+}
+
+int Compositor::GetKernel()
+{
+    return m_kernel;
+}
+
+bool Compositor::SetPixelFormat(int pixelFormat)
+{
+    if (GetPixelSize(pixelFormat) == 0)
+    {
+        Logger::Log("Compositor::SetPixelFormat - Pixel format %d is not supported.", pixelFormat);
+        return false;
+    }
+
+    m_pixelFormat = pixelFormat;
+    SelectKernels();
+    return true;
+}
+
+int Compositor::GetPixelFormat()
+{
+    return m_pixelFormat;
+}
+
+unsigned int Compositor::GetPixelSize()
+{
+    return GetPixelSize(m_pixelFormat);
+}
+
+/*
+    Returns the pixel for a color in the pixel format, indexed pixels are the shade (0-3) itself
+*/
+unsigned int Compositor::FormatPixel(byte shade, byte red, byte green, byte blue)
+{
+    switch (m_pixelFormat)
+    {
+    case PixelFormatRGB565:
+        return MakePixel565(red, green, blue);
+    case PixelFormatIndexed:
+        return shade;
+    default:
+        return MakePixel(red, green, blue);
+    }
+}
+
+/*
+    Picks the kernels for the kernel and pixel format. The narrow pixel formats have SSE2 kernels
+    for the BG and window, their sprites are drawn by the scalar kernels.
+*/
+void Compositor::SelectKernels()
+{
+    m_pExpandTileRow = ScalarExpandTileRow;
+    switch (m_pixelFormat)
+    {
+    case PixelFormatRGB565:
+        m_pWritePixels = ScalarWritePixels16;
+        m_pOverlayPixels = ScalarOverlayPixels16;
+        break;
+    case PixelFormatIndexed:
+        m_pWritePixels = ScalarWritePixels8;
+        m_pOverlayPixels = ScalarOverlayPixels8;
+        break;
+    default:
+        m_pWritePixels = ScalarWritePixels;
+        m_pOverlayPixels = ScalarOverlayPixels;
+        break;
+    }
+
+#if SIMD_SUPPORTED
+    if (m_kernel == KernelScalar)
+    {
+        return;
+    }
+
+    m_pExpandTileRow = SSE2ExpandTileRow;
+    switch (m_pixelFormat)
+    {
+    case PixelFormatRGB565:
+        m_pWritePixels = SSE2WritePixels16;
+        break;
+    case PixelFormatIndexed:
+        m_pWritePixels = SSE2WritePixels8;
+        break;
+    default:
+        m_pWritePixels = (m_kernel == KernelAVX2) ? AVX2WritePixels : SSE2WritePixels;
+        m_pOverlayPixels = (m_kernel == KernelAVX2) ? AVX2OverlayPixels : SSE2OverlayPixels;
+        break;
+    }
+#endif
+}
+
+void Compositor::ExpandTileRow(byte low, byte high, byte* pIndexes)
+{
+    m_pExpandTileRow(low, high, pIndexes);
+}
+
+void Compositor::WritePixels(const byte* pIndexes, const unsigned int* pPalette, unsigned int count, byte* pPixels)
+{
+    m_pWritePixels(pIndexes, pPalette, count, pPixels);
+}
+
+void Compositor::OverlayPixels(
+    const byte* pIndexes,
+    const unsigned int* pPalette,
+    bool isBehindBG,
+    unsigned int bgColor0,
+    unsigned int count,
+    byte* pPixels,
+    unsigned int* pIsDrawn)
+{
+    m_pOverlayPixels(pIndexes, pPalette, isBehindBG, bgColor0, count, pPixels, pIsDrawn);
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+/*
+    Compositor
+
+    Turns the GPU's lines of color indexes into pixels of the chosen pixel format (see ICPU.hpp). A
+    pixel is 4, 2, or 1 bytes and is handled as the low bytes of one little-endian unsigned int, so
+    each palette holds the 4 finished pixels for its colors.
+    The kernels are picked at runtime from the CPU's features: AVX2 and SSE2 on x86-64 and a scalar
+    fallback everywhere else. All of them produce identical output.
+*/
+#if defined(__x86_64__) || defined(_M_X64)
+#define SIMD_SUPPORTED 1
+#else
+#define SIMD_SUPPORTED 0
+#endif
+
+#define KernelScalar 0
+#define KernelSSE2 1
+#define KernelAVX2 2
+
+// Expands a 2bpp tile line (2 bytes) to 8 color indexes
+typedef void(*ExpandTileRowKernel)(byte low, byte high, byte* pIndexes);
+
+// Writes count pixels, one per color index
+typedef void(*WritePixelsKernel)(const byte* pIndexes, const unsigned int* pPalette, unsigned int count, byte* pPixels);
+
+// Draws count sprite pixels over the BG pixels, see ScalarOverlayPixels
+typedef void(*OverlayPixelsKernel)(
+    const byte* pIndexes,
+    const unsigned int* pPalette,
+    bool isBehindBG,
+    unsigned int bgColor0,
+    unsigned int count,
+    byte* pPixels,
+    unsigned int* pIsDrawn);
+
+class Compositor
+{
+public:
+    Compositor();
+    ~Compositor();
+
+    static int GetBestKernel();
+    static unsigned int MakePixel(byte red, byte green, byte blue);
+    static unsigned int MakePixel565(byte red, byte green, byte blue);
+    static unsigned int GetPixelSize(int pixelFormat);
+
+    bool SetKernel(int kernel);
+    int GetKernel();
+    bool SetPixelFormat(int pixelFormat);
+    int GetPixelFormat();
+    unsigned int GetPixelSize();
+    unsigned int FormatPixel(byte shade, byte red, byte green, byte blue);
+
+    void ExpandTileRow(byte low, byte high, byte* pIndexes);
+    void WritePixels(const byte* pIndexes, const unsigned int* pPalette, unsigned int count, byte* pPixels);
+    void OverlayPixels(
+        const byte* pIndexes,
+        const unsigned int* pPalette,
+        bool isBehindBG,
+        unsigned int bgColor0,
+        unsigned int count,
+        byte* pPixels,
+        unsigned int* pIsDrawn);
+
+private:
+    void SelectKernels();
+
+private:
+    int m_kernel;
+    int m_pixelFormat;
+    ExpandTileRowKernel m_pExpandTileRow;
+    WritePixelsKernel m_pWritePixels;
+    OverlayPixelsKernel m_pOverlayPixels;
+};
@@ -12,6 +12,25 @@ int Emulator::Step()
     return m_cpu->Step();
 }
 
+/*
+    Batched versions of Step, which run entirely inside the CPU and return the exact number of
+    cycles run. RunFrame is meant to be called once per frame by the front end.
+*/
+unsigned long Emulator::RunCycles(unsigned long cycles)
+{
+    return m_cpu->RunCycles(cycles);
+}
+
+unsigned long Emulator::RunFrame()
+{
+    return m_cpu->RunFrame();
+}
+
+unsigned long Emulator::RunUntilVBlank()
+{
+    return m_cpu->RunUntilVBlank();
+}
+
 void Emulator::Stop()
 {
     m_cpu.reset();
@@ -56,3 +75,109 @@ void Emulator::SetVSyncCallback(void(*pCallback)())
 {
     m_cpu->SetVSyncCallback(pCallback);
 }
+
+/*
+    Speed hack, off by default. Polling loops waiting on LY, STAT, or IF are fast-forwarded to the
+    next event that can change the polled value. GetIdleCyclesSkipped returns the cycles skipped.
+*/
+void Emulator::SetIdleLoopSkipping(bool isEnabled)
+{
+    m_cpu->SetIdleLoopSkipping(isEnabled);
+}
+
+unsigned long long Emulator::GetIdleCyclesSkipped()
+{
+    return m_cpu->GetIdleCyclesSkipped();
+}
+
+/*
+    Skips drawing frames, for fast forwarding or running headless. The GPU still runs its modes,
+    interrupts, and timing exactly, but skipped frames are not drawn and do not call the VSync
+    callback, GetCurrentFrame keeps the last drawn frame.
+    framesToSkip frames are skipped after each one drawn (0 draws them all). With
+    FrameSkipUntilRequested only the frame after each call to RequestFrame is drawn.
+*/
+void Emulator::SetFrameSkip(unsigned int framesToSkip)
+{
+    m_cpu->SetFrameSkip(framesToSkip);
+}
+
+void Emulator::RequestFrame()
+{
+    m_cpu->RequestFrame();
+}
+
+/*
+    Has the GPU draw each frame straight into memory supplied by the host, see IFrameSink. Pass
+    nullptr to go back to the internal frames read with GetCurrentFrame, which keeps the last frame
+    drawn before the sink was set.
+*/
+void Emulator::SetFrameSink(IFrameSink* pSink)
+{
+    m_cpu->SetFrameSink(pSink);
+}
+
+/*
+    Sets the format of the pixels in each frame, see ICPU.hpp. RGBA8888 is the default, RGB565 and
+    indexed pixels are half and a quarter of the size. The change applies from the next frame.
+*/
+bool Emulator::SetPixelFormat(int pixelFormat)
+{
+    return m_cpu->SetPixelFormat(pixelFormat);
+}
+
+/*
+    Fills pPalette with the 4 RGBA8888 pixels the shades of PixelFormatIndexed stand for
+*/
+void Emulator::GetShadePalette(unsigned int* pPalette)
+{
+    m_cpu->GetShadePalette(pPalette);
+}
+
+/*
+    Reads up to count 16-bit stereo samples of the sound generated so far, at AudioSampleRate. The
+    left and right samples are interleaved, so pSamples needs room for count * 2 shorts. Returns
+    the number read. Up to 1/10 of a second is kept, older samples are dropped.
+*/
+unsigned int Emulator::ReadAudioSamples(short* pSamples, unsigned int count)
+{
+    return m_cpu->ReadAudioSamples(pSamples, count);
+}
+
+/*
+    Plays the sound on the default audio device, mixed as NR50 and NR51 set it. While it plays, the
+    device takes the samples and ReadAudioSamples has none to read. Off by default.
+*/
+bool Emulator::SetAudioOutput(bool isEnabled)
+{
+    return m_cpu->SetAudioOutput(isEnabled);
+}
+
+/*
+    While the audio output plays, the number of stereo samples queued for the device. Up to 1/10 of
+    a second is queued, the rest waits in the APU. Safe to call from any thread.
+*/
+unsigned int Emulator::GetAudioQueueLevel()
+{
+    return m_cpu->GetAudioQueueLevel();
+}
+
+/*
+    The number of times the audio device ran dry and played silence instead. Safe to call from any
+    thread.
+*/
+unsigned int Emulator::GetAudioUnderrunCount()
+{
+    return m_cpu->GetAudioUnderrunCount();
+}
+
+/*
+    Makes up to AudioMaxRateAdjustment more (or fewer, when negative) samples per emulated second
+    than AudioSampleRate, while the device keeps playing AudioSampleRate. A host pacing the
+    emulation by its own clock uses it to keep the audio queue from slowly draining or filling up.
+    Call it from the thread running the emulator.
+*/
+bool Emulator::SetAudioRateAdjustment(int samplesPerSecond)
+{
+    return m_cpu->SetAudioRateAdjustment(samplesPerSecond);
+}
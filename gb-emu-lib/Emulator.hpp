@@ -1,5 +1,6 @@
 #pragma once
 
+#include "IFrameSink.hpp"
 #include "ICPU.hpp"
 
 #define JOYPAD_NONE             0
@@ -20,11 +21,26 @@ public:
     Emulator();
 
     int Step();
+    unsigned long RunCycles(unsigned long cycles);
+    unsigned long RunFrame();
+    unsigned long RunUntilVBlank();
     void Stop();
     bool Initialize(const char* bootROMPath, const char* cartridgePath);
     byte* GetCurrentFrame();
     void SetInput(byte input, byte buttons);
     void SetVSyncCallback(void(*pCallback)());
+    void SetIdleLoopSkipping(bool isEnabled);
+    unsigned long long GetIdleCyclesSkipped();
+    void SetFrameSkip(unsigned int framesToSkip);
+    void RequestFrame();
+    void SetFrameSink(IFrameSink* pSink);
+    bool SetPixelFormat(int pixelFormat);
+    void GetShadePalette(unsigned int* pPalette);
+    unsigned int ReadAudioSamples(short* pSamples, unsigned int count);
+    bool SetAudioOutput(bool isEnabled);
+    unsigned int GetAudioQueueLevel();
+    unsigned int GetAudioUnderrunCount();
+    bool SetAudioRateAdjustment(int samplesPerSecond);
 
 private:
     std::unique_ptr<ICPU> m_cpu;
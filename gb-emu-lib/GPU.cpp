@@ -1,6 +1,8 @@
 #include "pch.hpp"
 #include "GPU.hpp"
 
+#include <climits>
+
 #define TINT 0
 
 /*
@@ -51,8 +53,18 @@ const byte GBColors[]
 GPU::GPU(IMMU* pMMU, ICPU* pCPU) :
     m_MMU(pMMU),
     m_CPU(pCPU),
+    m_LineOBJCount(0),
+    m_pFrameSink(nullptr),
+    m_DisplayPixels(nullptr),
+    m_DisplayPitch(0),
+    m_PixelFormat(PixelFormatRGBA8888),
     m_ModeClock(VBlankCycles),
     m_DMAClocksRemaining(0),
+    m_FrameCount(0),
+    m_FrameSkip(0),
+    m_FramesSkipped(0),
+    m_IsFrameRequested(false),
+    m_IsRenderingFrame(true),
     m_pVSyncCallback(nullptr),
     m_LCDControl(0x00),
     m_ScrollY(0x00),
@@ -66,7 +78,19 @@ GPU::GPU(IMMU* pMMU, ICPU* pCPU) :
     m_ObjectPalette1Data(0x00)
 {
     SETMODE(ModeVBlank);
-    memset(m_DisplayPixels, 0x00, ARRAYSIZE(m_DisplayPixels));
+    memset(m_VRAM, 0x00, ARRAYSIZE(m_VRAM));
+    memset(m_TileCache, 0x00, ARRAYSIZE(m_TileCache));
+    memset(m_OAM, 0x00, ARRAYSIZE(m_OAM));
+    for (byte obj = 0; obj < OBJCount; obj++)
+    {
+        UpdateOBJCache(obj);
+    }
+
+    // VRAM and OAM are read straight from the MMU's page map. Only the tile maps are written
+    // directly, tile data writes must update the tile cache and OAM writes must skip 0xFEA0-0xFEFF
+    m_MMU->MapMemory(0x8000, 0x97FF, m_VRAM, false);
+    m_MMU->MapMemory(0x9800, 0x9FFF, m_VRAM + 0x1800, true);
+    m_MMU->MapMemory(0xFE00, 0xFEFF, m_OAM, false);
 }
 
 GPU::~GPU()
@@ -117,6 +141,12 @@ void GPU::Step(unsigned long cycles)
         if (m_ModeClock >= ReadingOAMCycles)
         {
             m_ModeClock -= ReadingOAMCycles;
+
+            // Pick the sprites to draw on this line
+            if (m_IsRenderingFrame)
+            {
+                SearchOAM();
+            }
             SETMODE(ModeReadingOAMVRAM);
         }
         break;
@@ -127,7 +157,10 @@ void GPU::Step(unsigned long cycles)
             m_ModeClock -= ReadingOAMVRAMCycles;
 
             // Write a scanline to the framebuffer
-            RenderScanline();
+            if (m_IsRenderingFrame && (m_DisplayPixels != nullptr))
+            {
+                RenderScanline();
+            }
 
             // Go to HBlank
             SETMODE(ModeHBlank);
@@ -149,7 +182,13 @@ void GPU::Step(unsigned long cycles)
             {
                 // Enter VBlank and render framebuffer
                 SETMODE(ModeVBlank);
-                RenderImage();
+                m_FrameCount++;
+                if (m_IsRenderingFrame)
+                {
+                    // The frame is complete, hand it over
+                    EndDisplayFrame();
+                    RenderImage();
+                }
 
                 if (m_CPU != nullptr)
                 {
@@ -183,6 +222,7 @@ void GPU::Step(unsigned long cycles)
                 // Go back to the top left
                 SETMODE(ModeReadingOAM);
                 m_LCDControllerYCoordinate = 0x00;
+                StartFrame();
                 if (OAMInterrupt && (m_CPU != nullptr))
                 {
                     m_CPU->TriggerInterrupt(INT48);
@@ -207,9 +247,62 @@ void GPU::Step(unsigned long cycles)
     }
 }
 
+/*
+    Returns the number of cycles until the next mode change, which is when the GPU can next raise an
+    interrupt. Stepping by up to this many cycles at once behaves exactly like stepping 4 at a time.
+    Returns 0 while the LYC=LY interrupt is being raised, since it is raised on every Step.
+*/
+unsigned long GPU::GetCyclesUntilNextEvent()
+{
+    if (!IsLCDDisplayEnabled)
+    {
+        return ULONG_MAX;
+    }
+
+    if ((m_LYCompare == m_LCDControllerYCoordinate) && LYCoincidenceInterrupt)
+    {
+        return 0;
+    }
+
+    unsigned long modeCycles = 0;
+    switch (GETMODE)
+    {
+    case ModeReadingOAM:
+        modeCycles = ReadingOAMCycles;
+        break;
+    case ModeReadingOAMVRAM:
+        modeCycles = ReadingOAMVRAMCycles;
+        break;
+    case ModeHBlank:
+        modeCycles = HBlankCycles;
+        break;
+    case ModeVBlank:
+        modeCycles = VBlankCycles;
+        break;
+    }
+
+    return (m_ModeClock < modeCycles) ? (modeCycles - m_ModeClock) : 0;
+}
+
+/*
+    Returns the latest complete frame. This is the consumer side of m_Frames, so only one thread may
+    call it, though not necessarily the one running the emulator. The frame stays valid until the
+    next call.
+*/
 byte* GPU::GetCurrentFrame()
 {
-    return m_DisplayPixels;
+    m_Frames.Acquire();
+    return m_Frames.GetFrontBuffer();
+}
+
+unsigned long long GPU::GetFrameCount()
+{
+    return m_FrameCount;
+}
+
+bool GPU::IsLCDEnabled()
+{
+    return IsLCDDisplayEnabled;
 }
 
 // IMemoryUnit
@@ -268,6 +361,10 @@ bool GPU::WriteByte(const ushort& address, const byte val)
         // TODO: It is possible some of our graphical issues come from this
         // Zelda reads/writes from this when it shouldn't.
         m_VRAM[address - 0x8000] = val;
+        if (address <= 0x97FF)
+        {
+            UpdateTileCache(address - 0x8000);
+        }
         return true;
     }
     else if (address >= 0xFE00 && address <= 0xFE9F)
@@ -275,6 +372,7 @@ bool GPU::WriteByte(const ushort& address, const byte val)
         // TODO: It is possible some of our graphical issues come from this
         // Zelda reads/writes from this when it shouldn't.
         m_OAM[address - 0xFE00] = val;
+        UpdateOBJCache((address - 0xFE00) / 4);
         return true;
     }
 
@@ -292,12 +390,7 @@ bool GPU::WriteByte(const ushort& address, const byte val)
                 }
 
                 // The display was turned off, clear the screen
-                // Set color to white
-                memset(m_DisplayPixels, GBColors[0], ARRAYSIZE(m_DisplayPixels));
-                for (unsigned int a = 0;a < ARRAYSIZE(m_DisplayPixels);a += 4)
-                {
-                    m_DisplayPixels[a] = 0xFF;   // Set Alpha to 0xFF
-                }
+                ClearDisplay();
 
                 m_LCDControllerYCoordinate = 153;
                 m_ModeClock = VBlankCycles;
@@ -350,6 +443,53 @@ void GPU::SetVSyncCallback(void(*pCallback)())
     m_pVSyncCallback = pCallback;
 }
 
+/*
+    See IFrameSink. The frame being drawn is ended first, the sink is used from the next frame.
+*/
+void GPU::SetFrameSink(IFrameSink* pSink)
+{
+    EndDisplayFrame();
+    m_pFrameSink = pSink;
+}
+
+/*
+    See Emulator::SetPixelFormat. The frame being drawn keeps its format.
+*/
+bool GPU::SetPixelFormat(int pixelFormat)
+{
+    if (Compositor::GetPixelSize(pixelFormat) == 0)
+    {
+        Logger::Log("GPU::SetPixelFormat - Pixel format %d is not supported.", pixelFormat);
+        return false;
+    }
+
+    m_PixelFormat = pixelFormat;
+    return true;
+}
+
+void GPU::GetShadePalette(unsigned int* pPalette)
+{
+    for (byte shade = 0; shade < 4; shade++)
+    {
+        pPalette[shade] = Compositor::MakePixel(GBColors[shade], GBColors[shade], GBColors[shade]);
+    }
+}
+
+/*
+    See Emulator::SetFrameSkip. The change applies from the next frame, which is drawn.
+*/
+void GPU::SetFrameSkip(unsigned int framesToSkip)
+{
+    m_FrameSkip = framesToSkip;
+    m_FramesSkipped = 0;
+    m_IsFrameRequested = true;
+}
+
+void GPU::RequestFrame()
+{
+    m_IsFrameRequested = true;
+}
+
 void GPU::PreBoot()
 {
     m_LCDControllerYCoordinate = 0x91;
@@ -363,13 +503,75 @@ void GPU::PreBoot()
     m_WindowXPositionMinus7 = 0x00;
 
     // Initialize color to white
-    memset(m_DisplayPixels, GBColors[0], ARRAYSIZE(m_DisplayPixels));
-    for (unsigned int a = 0;a < ARRAYSIZE(m_DisplayPixels);a += 4)
+    ClearDisplay();
+}
+
+/*
+    Starts drawing a frame, into the frame sink's memory when there is one
+*/
+void GPU::BeginDisplayFrame()
+{
+    m_Compositor.SetPixelFormat(m_PixelFormat);
+    if (m_pFrameSink != nullptr)
     {
-        m_DisplayPixels[a] = 0xFF;   // Set Alpha to 0xFF
+        m_DisplayPixels = m_pFrameSink->BeginFrame(&m_DisplayPitch);
+    }
+    else
+    {
+        m_DisplayPixels = m_Frames.GetBackBuffer();
+        m_DisplayPitch = 160 * m_Compositor.GetPixelSize();
     }
 }
 
+void GPU::EndDisplayFrame()
+{
+    if (m_DisplayPixels == nullptr)
+    {
+        return;
+    }
+
+    if (m_pFrameSink != nullptr)
+    {
+        m_pFrameSink->EndFrame();
+    }
+    else
+    {
+        m_Frames.Publish();
+    }
+
+    m_DisplayPixels = nullptr;
+}
+
+/*
+    Ends the frame being drawn, or a new one, with all white pixels
+*/
+void GPU::ClearDisplay()
+{
+    if (m_DisplayPixels == nullptr)
+    {
+        BeginDisplayFrame();
+        if (m_DisplayPixels == nullptr)
+        {
+            return;
+        }
+    }
+
+    for (int line = 0; line < 144; line++)
+    {
+        ClearLine(m_DisplayPixels + (line * m_DisplayPitch));
+    }
+
+    EndDisplayFrame();
+}
+
+void GPU::ClearLine(byte* pLine)
+{
+    const byte indexes[160] = {};
+    const unsigned int white = m_Compositor.FormatPixel(0, GBColors[0], GBColors[0], GBColors[0]);
+    const unsigned int palette[] { white, white, white, white };
+    m_Compositor.WritePixels(indexes, palette, 160, pLine);
+}
+
 void GPU::LaunchDMATransfer(const byte address)
 {
     /*
@@ -390,26 +592,27 @@ void GPU::LaunchDMATransfer(const byte address)
     {
         m_OAM[offset] = m_MMU->Read(source | offset);
     }
+
+    for (byte obj = 0; obj < OBJCount; obj++)
+    {
+        UpdateOBJCache(obj);
+    }
 }
 
 void GPU::RenderScanline()
 {
-    RenderBackgroundScanline();
+    // Each layer is drawn straight into the frame, sprites check the BG pixels they go over
+    byte* pLine = m_DisplayPixels + (m_LCDControllerYCoordinate * m_DisplayPitch);
+
+    RenderBackgroundScanline(pLine);
     if (WindowDisplayEnable)
     {
-        RenderWindowScanline();
+        RenderWindowScanline(pLine);
     }
 
-
-    // Copy this line from m_bgPixels (BG and Window) to m_DisplayPixels
-    memcpy(
-        m_DisplayPixels + (m_LCDControllerYCoordinate * 160 * 4),
-        m_bgPixels + (m_LCDControllerYCoordinate * 160 * 4),
-        160 * 4);
-
     if (OBJDisplayEnable)
     {
-        RenderOBJScanline();
+        RenderOBJScanline(pLine);
     }
 }
 
@@ -421,7 +624,7 @@ void GPU::RenderImage()
     }
 }
 
-void GPU::RenderBackgroundScanline()
+void GPU::RenderBackgroundScanline(byte* pLine)
 {
     if (!BGDisplayEnable)
     {
@@ -432,27 +635,22 @@ void GPU::RenderBackgroundScanline()
 
         So, we just need to render a white background and get out early
         */
-        for (int x = 0;x < 160;x++)
-        {
-            // If BG is disabled, render a white background
-            int index = ((m_LCDControllerYCoordinate * 160) + x) * 4;
-            m_bgPixels[index + 3] = GBColors[0];   // R
-            m_bgPixels[index + 2] = GBColors[0];   // G
-            m_bgPixels[index + 1] = GBColors[0];   // B
-            m_bgPixels[index + 0] = 0xFF;          // A
-        }
-
+        ClearLine(pLine);
         return;
     }
 
     // Load BG (and window) palette data
-    const byte palette[]
+    unsigned int palette[4];
+    for (byte colorNumber = 0; colorNumber < 4; colorNumber++)
     {
-        GBColors[m_BGPaletteData & 0x03],
-        GBColors[(m_BGPaletteData >> 2) & 0x03],
-        GBColors[(m_BGPaletteData >> 4) & 0x03],
-        GBColors[(m_BGPaletteData >> 6) & 0x03],
-    };
+        byte shade = (m_BGPaletteData >> (colorNumber * 2)) & 0x03;
+        byte color = GBColors[shade];
+#if TINT
+        palette[colorNumber] = m_Compositor.FormatPixel(shade, (color == 0x00) ? 0x30 : color, 0x00, 0x00);
+#else
+        palette[colorNumber] = m_Compositor.FormatPixel(shade, color, color, color);
+#endif
+    }
 
     // If bit 3 is NOT set: BG Tile Numbers at 0x9800
     // if bit 3 IS     set: BG Tile Numbers at 0x9C00
@@ -460,14 +658,6 @@ void GPU::RenderBackgroundScanline()
     ushort tileNumberMap = BGTileMapDisplaySelect ? 0x9C00 : 0x9800;
     tileNumberMap -= 0x8000; // Map for direct VRAM access
 
-    // If bit 4 is     set: BG Tile Data at 0x8000
-    // If bit 4 is NOT set: BG Tile Data at 0x8800
-    //      Note: Tile data #0 is actually 0x9000, and the tile number is a SIGNED byte where
-    //            0x80 (-128) is the lowest tile and is at 0x8800
-    // Bit 4 - BG & Window Tile Data Select   (0=8800-97FF, 1=8000-8FFF)
-    ushort tileData = BGWindowTileDataSelect ? 0x8000 : 0x9000;
-    tileData -= 0x8000; // Map for direct VRAM access
-
     // This is confusing, but we need to figure out WHICH tile in the 32x32 tile map to render
     // tileY is the tile # we will later lookup in the Tile Data. We take the current line #, add
     // the scroll value, then divide by 8 (since there are 8 lines per map).  Finally we MOD that
@@ -478,72 +668,41 @@ void GPU::RenderBackgroundScanline()
     // current line plus the scroll and MOD by 8 (the # of pixels per tile).
     byte tileYOffset = (byte)((m_LCDControllerYCoordinate + m_ScrollY) % 8);
 
-    // Now loop through each pixel on this line
-    for (byte x = 0; x < 160; x++)
+    // Copy the line of each tile, enough of them to cover the screen from the first tile's
+    // partially scrolled out pixels.
+    byte indexes[160 + 8];
+    for (byte tile = 0; tile < 21; tile++)
     {
         // We need to determine the current X tile (in the same way we did the Y tile)
-        byte tileX = (byte)(((m_ScrollX + x) / 8) % 32);
+        byte tileX = (byte)(((m_ScrollX / 8) + tile) % 32);
 
         // Finally, we can read the correct tile number from the tile map (32x32)
         byte tileNumber = m_VRAM[(ushort)(tileNumberMap + (tileY * 32) + tileX)];
-
-        // Now we need to get a pointer to the tile data
-        ushort tileDataPtr = 0;
-        if (BGWindowTileDataSelect)
-        {
-            // Tile number is unsigned and each tile is 16 bytes
-            tileDataPtr = (ushort)(tileData + tileNumber * 0x10);
-        }
-        else
-        {
-            // Tile number is "signed" and each tile is 16 bytes
-            tileDataPtr = (ushort)(tileData + static_cast<sbyte>(tileNumber) * 0x10);
+        memcpy(indexes + (tile * 8), GetBGTileRow(tileNumber, tileYOffset), 8);
     }
 
-        // Each line is 2 bytes long, so we need to offset for the current line
-        tileDataPtr += (ushort)(tileYOffset * 2);
-
-        // Read the two bytes!
-        byte b1 = m_VRAM[tileDataPtr];
-        byte b2 = m_VRAM[(ushort)(tileDataPtr + 1)];
-
-        // Figure out which palette # it uses
-        byte bit = (byte)(7 - ((m_ScrollX + x) % 8));
-        byte pLo = ISBITSET(b1, bit) ? 0x01 : 0x00;
-        byte pHi = ISBITSET(b2, bit) ? 0x02 : 0x00;
-
-        // Get the color
-        byte color = palette[pLo + pHi];
-
-        // Find and set the index of the image
-        int index = ((m_LCDControllerYCoordinate * 160) + x) * 4;
-        m_bgPixels[index + 3] = color; // R
-#if TINT
-        if (m_bgPixels[index + 3] == 0x00) m_bgPixels[index + 3] = 0x30;
-        m_bgPixels[index + 2] = 0x00; // G
-        m_bgPixels[index + 1] = 0x00; // B
-#else
-        m_bgPixels[index + 2] = color; // G
-        m_bgPixels[index + 1] = color; // B
-#endif
-        m_bgPixels[index + 0] = 0xFF;  // A
-}
+    // Then colour the 160 pixels starting at the scrolled in one
+    m_Compositor.WritePixels(indexes + (m_ScrollX % 8), palette, 160, pLine);
 }
 
-void GPU::RenderWindowScanline()
+void GPU::RenderWindowScanline(byte* pLine)
 {
     // Get the "relative" window position, if it is less than 0, we are off screen, exit
     int winY = m_LCDControllerYCoordinate - m_WindowYPosition;
     if (winY < 0)
         return;
 
-    const byte palette[]
+    unsigned int palette[4];
+    for (byte colorNumber = 0; colorNumber < 4; colorNumber++)
     {
-        GBColors[m_BGPaletteData & 0x03],
-        GBColors[(m_BGPaletteData >> 2) & 0x03],
-        GBColors[(m_BGPaletteData >> 4) & 0x03],
-        GBColors[(m_BGPaletteData >> 6) & 0x03],
-    };
+        byte shade = (m_BGPaletteData >> (colorNumber * 2)) & 0x03;
+        byte color = GBColors[shade];
+#if TINT
+        palette[colorNumber] = m_Compositor.FormatPixel(shade, 0x00, 0x00, (color == 0x00) ? 0x30 : color);
+#else
+        palette[colorNumber] = m_Compositor.FormatPixel(shade, color, color, color);
+#endif
+    }
 
     // If bit 6 is NOT set: BG Tile Numbers at 0x9800
     // if bit 6 IS     set: BG Tile Numbers at 0x9C00
@@ -551,181 +710,215 @@ void GPU::RenderWindowScanline()
     ushort tileNumberMap = WindowTileMapDisplaySelect ? 0x9C00 : 0x9800;
     tileNumberMap -= 0x8000;    // Mapped for direct VRAM access
 
-    // If bit 4 is     set: BG Tile Data at 0x8000
-    // If bit 4 is NOT set: BG Tile Data at 0x8800
-    //      Note: Tile data #0 is actually 0x9000, and the tile number is a SIGNED byte where
-    //            0x80 (-128) is the lowest tile and is at 0x8800
-    // Bit 4 - BG & Window Tile Data Select   (0=8800-97FF, 1=8000-8FFF)
-    ushort tileData = BGWindowTileDataSelect ? 0x8000 : 0x9000;
-    tileData -= 0x8000;    // Mapped for direct VRAM access
-
     // The Window is also 32x32 tiles, and the tile are 8 pixels tall, so figure out which tile we
     // need by dividing by 8.  Also get the offset by getting the remainder
     byte tileY = (byte)(winY / 8);
     byte tileYOffset = (byte)(winY % 8);
 
-    // Get the relative window position
+    // Get the relative window position, if it is greater than 0 the window starts there
     int winX = m_WindowXPositionMinus7 - 7;
-    for (int x = 0; x < 160; x++)
-    {
-        // If the window is to the right of here, don't do anything
-        if (x < winX)
-            continue;
+    int startX = (winX > 0) ? winX : 0;
+    if (startX >= 160)
+        return;
 
-        // Get the X tile for this pixel
+    byte indexes[160];
+    int lastTileX = -1;
+    const byte* pTileRow = nullptr;
+    for (int x = startX; x < 160; x++)
+    {
+        // Get the X tile for this pixel, and its line of decoded color indexes when it changes
         byte tileX = (byte)((x - winX) / 8);
-
-        // Calculate the tile number
-        byte tileNumber = m_VRAM[(ushort)(tileNumberMap + (tileY * 32) + tileX)];
-
-        // Find the tile data
-        ushort tileDataPtr = 0;
-        if (BGWindowTileDataSelect)
-        {
-            tileDataPtr = (ushort)(tileData + tileNumber * 0x10);
-    }
-        else
+        if (tileX != lastTileX)
         {
-            tileDataPtr = (ushort)(tileData + static_cast<sbyte>(tileNumber) * 0x10);
+            byte tileNumber = m_VRAM[(ushort)(tileNumberMap + (tileY * 32) + tileX)];
+            pTileRow = GetBGTileRow(tileNumber, tileYOffset);
+            lastTileX = tileX;
         }
 
-        tileDataPtr += (ushort)(tileYOffset * 2);
-
-        // Read tile data
-        byte b1 = m_VRAM[tileDataPtr];
-        byte b2 = m_VRAM[(ushort)(tileDataPtr + 1)];
-
-        // Find the pixel we care about and look up palette and color
-        byte bit = (byte)(7 - x % 8);
-        byte pLo = ISBITSET(b1, bit) ? 0x01 : 0x00;
-        byte pHi = ISBITSET(b2, bit) ? 0x02 : 0x00;
-        byte color = palette[pLo + pHi];
+        // Find the pixel we care about
+        indexes[x] = pTileRow[x % 8];
+    }
 
-        // Set the image color
-        int index = ((m_LCDControllerYCoordinate * 160) + x) * 4;
-        m_bgPixels[index + 1] = color; // B
-#if TINT
-        if (m_bgPixels[index + 1] == 0x00) m_bgPixels[index + 1] = 0x30;
-        m_bgPixels[index + 2] = 0x00; // G
-        m_bgPixels[index + 3] = 0x00; // R
-#else
-        m_bgPixels[index + 2] = color; // G
-        m_bgPixels[index + 3] = color; // R
-#endif
-        m_bgPixels[index + 0] = 0xFF;  // A
-}
+    // Set the image colors
+    m_Compositor.WritePixels(indexes + startX, palette, 160 - startX, pLine + (startX * m_Compositor.GetPixelSize()));
 }
 
-void GPU::RenderOBJScanline()
+void GPU::RenderOBJScanline(byte* pLine)
 {
-    const byte SPRITESIZEINBYTES = 16;
-    const byte bgPalette[]
+    // Sprites behind the BG are only drawn over BG color 0
+    byte bgShade0 = m_BGPaletteData & 0x03;
+    unsigned int bgColor0 = m_Compositor.FormatPixel(bgShade0, GBColors[bgShade0], GBColors[bgShade0], GBColors[bgShade0]);
+    unsigned int pixelSize = m_Compositor.GetPixelSize();
+    int height = OBJSize ? 16 : 8;
+    memset(m_OBJDrawn, 0x00, sizeof(m_OBJDrawn));
+
+    // Loop through the sprites SearchOAM found from the highest priority one, which is drawn on top
+    for (int lineOBJ = m_LineOBJCount - 1; lineOBJ >= 0; lineOBJ--)
     {
-        GBColors[m_BGPaletteData & 0x03],
-        GBColors[(m_BGPaletteData >> 2) & 0x03],
-        GBColors[(m_BGPaletteData >> 4) & 0x03],
-        GBColors[(m_BGPaletteData >> 6) & 0x03],
-    };
-
-    // Loop through each sprite (backwards)
-    for (int i = 156; i >= 0; i -= 4)
-    {
-        // Grab the sprite data
-        byte objY = m_OAM[i];                // The sprite Y position, minus 16 (apparently)
-        byte spriteSize = OBJSize ? 0x10 : 0x08; // 0x00 = 8x8, 0x01 = 8x16
-        int height = spriteSize;
+        byte obj = m_LineOBJs[lineOBJ];
 
         // Sprite rect:
         // x = spriteX - 8
         // y = spriteY - 16
         // w = 8
-        // h = spriteSize
+        // h = height
+        int x = m_OBJLeft[obj];
+        int y = m_OBJTop[obj];
 
-        int y = objY - 16;
-
-        // Check if the sprite is on the current scanline
+        // The sprite size could have changed since the search
         if ((y <= m_LCDControllerYCoordinate) && ((y + height) > m_LCDControllerYCoordinate))
         {
-            byte objX = m_OAM[i + 1];               // The sprite X position, minus 8 (apparently)
-            byte spriteTileNumber = m_OAM[i + 2];   // The tile or pattern number of the sprite
-            byte spriteFlags = m_OAM[i + 3];        // The sprites render flags (priority, flip, palette)
+            byte spriteTileNumber = m_OBJTileNumber[obj];   // The tile or pattern number of the sprite
+            byte spriteFlags = m_OBJFlags[obj];             // The sprites render flags (priority, flip, palette)
 
-            if (spriteSize == 0x10)
+            if (height == 16)
             {
                 spriteTileNumber &= 0xFE;
             }
 
             byte paletteNumber = ISBITSET(spriteFlags, 4) ? 0x01 : 0x00;
 
-            int x = objX - 8;
-
-            // Mapped for direct VRAM access
-            const ushort tileData = 0x0000;
-
             // Create the palette to use for this sprite
-            byte palette[]
+            byte paletteData = (paletteNumber == 0x00) ? m_ObjectPalette0Data : m_ObjectPalette1Data;
+            unsigned int palette[4];
+            palette[0] = 0x00000000;  // Unused - Transparent
+            for (byte colorNumber = 1; colorNumber < 4; colorNumber++)
             {
-                0x00, // Unused - Transparent
-                GBColors[(paletteNumber == 0x00) ? (m_ObjectPalette0Data >> 2 & 0x03) : (m_ObjectPalette1Data >> 2 & 0x03)],
-                GBColors[(paletteNumber == 0x00) ? (m_ObjectPalette0Data >> 4 & 0x03) : (m_ObjectPalette1Data >> 4 & 0x03)],
-                GBColors[(paletteNumber == 0x00) ? (m_ObjectPalette0Data >> 6 & 0x03) : (m_ObjectPalette1Data >> 6 & 0x03)]
-            };
-
-            // The memory location of this sprites tile can be found by adding the sprites tile
-            // number to the location of the tile data.
-            // If the spriteSize == 0x00, ignore the lower bit of the tile number.
-            ushort tilePointer = tileData + (spriteTileNumber * SPRITESIZEINBYTES);
-            byte tileYOffset = ISBITSET(spriteFlags, 6) ? ((height - 1) - (m_LCDControllerYCoordinate - y)) : (m_LCDControllerYCoordinate - y);
-            tilePointer += (tileYOffset * 2);
+                byte shade = (paletteData >> (colorNumber * 2)) & 0x03;
+                byte color = GBColors[shade];
+#if TINT
+                palette[colorNumber] = m_Compositor.FormatPixel(shade, 0x00, (color == 0x00) ? 0x30 : color, 0x00);
+#else
+                palette[colorNumber] = m_Compositor.FormatPixel(shade, color, color, color);
+#endif
+            }
 
-            // The data for this line of the sprite, 8 pixels
-            byte low = m_VRAM[tilePointer];
-            byte high = m_VRAM[(ushort)(tilePointer + 1)];
+            // The sprites tile can be found at the sprites tile number in the tile data, 8x16 sprites
+            // continue into the next tile. If the spriteSize == 0x00, ignore the lower bit of the tile number.
+            byte tileYOffset = ISBITSET(spriteFlags, 6) ? ((height - 1) - (m_LCDControllerYCoordinate - y)) : (m_LCDControllerYCoordinate - y);
 
-            // Loop through all 8 pixels of this line
+            // The decoded color indexes for this line of the sprite, 8 pixels
+            const byte* pTileRow = m_TileCache + (spriteTileNumber * 64) + (tileYOffset * 8);
+            byte indexes[8];
             for (int indexX = 0; indexX < 8; indexX++)
             {
-                int pixelX = x + indexX;
-                // Check if the pixel is still on screen
-                if (pixelX >= 0 && pixelX < 160)
-                {
-                    byte bit = ISBITSET(spriteFlags, 5) ? indexX : 7 - indexX;
-                    byte pixelVal = 0x00;
-                    if (ISBITSET(high, bit)) pixelVal |= 0x02;
-                    if (ISBITSET(low, bit)) pixelVal |= 0x01;
-                    byte color = palette[pixelVal];
-
-                    // If two sprites x coordinates are the same on DMG OR CGB, the one with the lower address in OAM will be 'on top'
-                    // If two sprites x coordinates are different on DMG, the one with the x coordinate closer to the ? right ? of the screen will be on top, regardless of position in OAM. (When in DMG mode(i.e.when playing a non - color enhanced game), the CGB emulates this behavior)
-                    // If two sprites x coordinates are different on CGB in CGB mode, the one with the lower address in OAM will be 'on top', regardless of x coordinate.
-
-                    // If the pixel is not transparent
-                    if (pixelVal != 0x00)
-                    {
-                        int index = ((m_LCDControllerYCoordinate * 160) + pixelX) * 4;
-
-                        // If the sprite has priority 0 (Render above BG)
-                        if (!ISBITSET(spriteFlags, 7) || (m_bgPixels[index + 3] == bgPalette[0x00]))
-                        {
-                            // If the BG pixel is white
-                            //  This sprite has priority 1 (Render behind BG)
-                            //  The sprite pixels only get rendered above BG pixels that are white.
-                            //  All other BG pixels stay on top.
-                            // Render that sprite pixel
-                            m_DisplayPixels[index + 2] = color; // G
-#if TINT
-                            if (m_DisplayPixels[index + 2] == 0x00) m_DisplayPixels[index + 2] = 0x30;
-                            m_DisplayPixels[index + 3] = 0x00; // R
-                            m_DisplayPixels[index + 1] = 0x00; // B
-#else
-                            m_DisplayPixels[index + 3] = color; // R
-                            m_DisplayPixels[index + 1] = color; // B
-#endif
-                            m_DisplayPixels[index + 0] = 0xFF;  // A
-                        }
-                    }
-                }
+                indexes[indexX] = pTileRow[ISBITSET(spriteFlags, 5) ? 7 - indexX : indexX];
+            }
+
+            // Only the pixels still on screen are drawn
+            int firstX = (x < 0) ? -x : 0;
+            int lastX = (x > 152) ? 160 - x : 8;
+            if (firstX >= lastX)
+            {
+                continue;
             }
+
+            // Transparent pixels are skipped, as are the pixels of higher priority sprites. If the sprite
+            // has priority 1 (Render behind BG) its pixels only get rendered above BG pixels that are
+            // white, all other BG pixels stay on top.
+            m_Compositor.OverlayPixels(
+                indexes + firstX,
+                palette,
+                ISBITSET(spriteFlags, 7),
+                bgColor0,
+                lastX - firstX,
+                pLine + ((x + firstX) * pixelSize),
+                m_OBJDrawn + x + firstX);
+        }
+    }
+}
+
+/*
+    Called as LY goes back to 0, decides if the frame starting is drawn
+*/
+void GPU::StartFrame()
+{
+    if (m_FrameSkip == FrameSkipUntilRequested)
+    {
+        m_IsRenderingFrame = m_IsFrameRequested;
+    }
+    else
+    {
+        m_IsRenderingFrame = m_IsFrameRequested || (m_FramesSkipped >= m_FrameSkip);
+    }
+
+    m_IsFrameRequested = false;
+    m_FramesSkipped = m_IsRenderingFrame ? 0 : m_FramesSkipped + 1;
+
+    if (m_IsRenderingFrame)
+    {
+        BeginDisplayFrame();
+    }
+}
+
+/*
+    The OAM search of mode 2. Up to 10 sprites are shown per line: the first ones in OAM that cover it,
+    whatever their X position. They are then sorted from the lowest to the highest priority:
+    If two sprites x coordinates are the same on DMG OR CGB, the one with the lower address in OAM will be 'on top'
+    If two sprites x coordinates are different on DMG, the one with the smaller x coordinate will be on top, regardless of position in OAM. (When in DMG mode(i.e.when playing a non - color enhanced game), the CGB emulates this behavior)
+    If two sprites x coordinates are different on CGB in CGB mode, the one with the lower address in OAM will be 'on top', regardless of x coordinate.
+*/
+void GPU::SearchOAM()
+{
+    int height = OBJSize ? 16 : 8;
+
+    m_LineOBJCount = 0;
+    for (byte obj = 0; (obj < OBJCount) && (m_LineOBJCount < MaxOBJsPerLine); obj++)
+    {
+        int y = m_OBJTop[obj];
+        if ((y <= m_LCDControllerYCoordinate) && ((y + height) > m_LCDControllerYCoordinate))
+        {
+            m_LineOBJs[m_LineOBJCount++] = obj;
+        }
+    }
+
+    // Insertion sort by descending X, then descending OAM index (the sprites are found in ascending order)
+    for (byte i = 1; i < m_LineOBJCount; i++)
+    {
+        byte obj = m_LineOBJs[i];
+        byte j = i;
+        while ((j > 0) && (m_OBJLeft[m_LineOBJs[j - 1]] <= m_OBJLeft[obj]))
+        {
+            m_LineOBJs[j] = m_LineOBJs[j - 1];
+            j--;
         }
+
+        m_LineOBJs[j] = obj;
     }
 }
+
+/*
+    Decodes the 4 OAM bytes of a sprite: Y position, X position, tile number, and flags
+*/
+void GPU::UpdateOBJCache(const byte obj)
+{
+    const byte* pOAM = m_OAM + (obj * 4);
+    m_OBJTop[obj] = pOAM[0] - 16;
+    m_OBJLeft[obj] = pOAM[1] - 8;
+    m_OBJTileNumber[obj] = pOAM[2];
+    m_OBJFlags[obj] = pOAM[3];
+}
+
+/*
+    Decodes the line of the tile that holds the tile data byte at offset (from 0x8000) into the
+    tile cache. Each line is 2 bytes: bit 7-n of the first byte is bit 0 of pixel n's color index,
+    bit 7-n of the second byte is bit 1.
+*/
+void GPU::UpdateTileCache(const ushort& offset)
+{
+    ushort lineOffset = offset & ~0x0001;
+
+    // 16 bytes per tile and 8 bytes per line in the cache, so the line's cache offset is 4x
+    m_Compositor.ExpandTileRow(m_VRAM[lineOffset], m_VRAM[lineOffset + 1], m_TileCache + (lineOffset * 4));
+}
+
+/*
+    Returns the decoded line of a BG or window tile.
+    Bit 4 - BG & Window Tile Data Select   (0=8800-97FF, 1=8000-8FFF)
+    With 0x8800 the tile number is SIGNED and tile #0 is at 0x9000 (tile 256 of the cache).
+*/
+const byte* GPU::GetBGTileRow(const byte tileNumber, const byte tileYOffset)
+{
+    int tile = BGWindowTileDataSelect ? tileNumber : 256 + static_cast<sbyte>(tileNumber);
+    return m_TileCache + (tile * 64) + (tileYOffset * 8);
+}
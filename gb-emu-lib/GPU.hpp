@@ -1,5 +1,8 @@
 #pragma once
 
+#include "Compositor.hpp"
+#include "TripleBuffer.hpp"
+
 // FF40 - LCDC - LCD Control (R/W)
 // FF41 - STAT - LCDC Status (R/W)
 // FF42 - SCY - Scroll Y (R/W)
@@ -35,7 +38,12 @@
 #define ReadingOAMCycles 80
 #define ReadingOAMVRAMCycles 172
 
-class GPU : public IMemoryUnit
+#define TileCount 384
+
+#define OBJCount 40
+#define MaxOBJsPerLine 10
+
+class GPU : public IMemoryUnit, public IScheduledUnit
 {
     friend class GPUTests;
 
@@ -43,33 +51,73 @@ public:
     GPU(IMMU* pMMU, ICPU* pCPU);
     ~GPU();
 
-    void Step(unsigned long cycles);
     byte* GetCurrentFrame();
+    unsigned long long GetFrameCount();
+    bool IsLCDEnabled();
+
+    // IScheduledUnit
+    void Step(unsigned long cycles);
+    unsigned long GetCyclesUntilNextEvent();
 
     // IMemoryUnit
     byte ReadByte(const ushort& address);
     bool WriteByte(const ushort& address, const byte val);
     void SetVSyncCallback(void(*pCallback)());
+    void SetFrameSink(IFrameSink* pSink);
+    bool SetPixelFormat(int pixelFormat);
+    void GetShadePalette(unsigned int* pPalette);
+    void SetFrameSkip(unsigned int framesToSkip);
+    void RequestFrame();
     void PreBoot();
 
 private:
     void LaunchDMATransfer(const byte address);
+    void BeginDisplayFrame();
+    void EndDisplayFrame();
+    void ClearDisplay();
+    void ClearLine(byte* pLine);
     void RenderScanline();
     void RenderImage();
-    void RenderBackgroundScanline();
-    void RenderWindowScanline();
-    void RenderOBJScanline();
+    void RenderBackgroundScanline(byte* pLine);
+    void RenderWindowScanline(byte* pLine);
+    void RenderOBJScanline(byte* pLine);
+    void StartFrame();
+    void SearchOAM();
+    void UpdateOBJCache(const byte obj);
+    void UpdateTileCache(const ushort& offset);
+    const byte* GetBGTileRow(const byte tileNumber, const byte tileYOffset);
 
 private:
     IMMU* m_MMU;
     ICPU* m_CPU;
+    Compositor m_Compositor;
     byte m_VRAM[0x1FFF + 1];
-    byte m_OAM[0x009F + 1];
-    byte m_bgPixels[160 * 144 * 4];
-    byte m_DisplayPixels[160 * 144 * 4];
+    byte m_OAM[0x00FF + 1];     // 0xFEA0-0xFEFF are unusable and always read 0x00
+    byte m_TileCache[TileCount * 8 * 8];    // Tile data (0x8000-0x97FF) as one color index per pixel
+
+    // OAM decoded into one array per attribute, see UpdateOBJCache
+    int m_OBJTop[OBJCount];             // The sprite Y position minus 16
+    int m_OBJLeft[OBJCount];            // The sprite X position minus 8
+    byte m_OBJTileNumber[OBJCount];
+    byte m_OBJFlags[OBJCount];
+    byte m_LineOBJs[MaxOBJsPerLine];    // The sprites found on this line by SearchOAM, lowest priority first
+    byte m_LineOBJCount;
+    unsigned int m_OBJDrawn[160];       // Set where a sprite was drawn on this line, see Compositor::OverlayPixels
+
+    // Frames are drawn straight into the frame sink's memory, or else into the back buffer of m_Frames
+    TripleBuffer m_Frames;
+    IFrameSink* m_pFrameSink;
+    byte* m_DisplayPixels;              // The frame being drawn, nullptr between frames
+    int m_DisplayPitch;
+    int m_PixelFormat;                  // Given to m_Compositor as each frame begins
 
     unsigned long m_ModeClock;
     int m_DMAClocksRemaining;
+    unsigned long long m_FrameCount;    // The number of times VBlank was entered
+    unsigned int m_FrameSkip;
+    unsigned int m_FramesSkipped;       // Since the last drawn frame
+    bool m_IsFrameRequested;
+    bool m_IsRenderingFrame;
     void(*m_pVSyncCallback)();
     
     byte m_LCDControl;
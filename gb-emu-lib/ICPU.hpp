@@ -6,6 +6,15 @@
 #define INT58 0x58  // Serial
 #define INT60 0x60  // Joypad
 
+#define FrameSkipUntilRequested 0xFFFFFFFF  // Only render the frames asked for with RequestFrame
+
+#define PixelFormatRGBA8888 0   // 4 bytes per pixel: A, B, G, R
+#define PixelFormatRGB565 1     // 2 bytes per pixel: a little-endian RGB565 ushort
+#define PixelFormatIndexed 2    // 1 byte per pixel: the shade (0-3), see GetShadePalette
+
+#define AudioSampleRate 48000   // Stereo samples per second of ReadAudioSamples
+#define AudioMaxRateAdjustment (AudioSampleRate / 200)  // The most SetAudioRateAdjustment can change it, 0.5%
+
 class ICPU
 {
 public:
@@ -13,8 +22,23 @@ public:
     virtual bool Initialize() = 0;
     virtual bool LoadROM(const char* bootROMPath, const char* cartridgePath) = 0;
     virtual int Step() = 0;
+    virtual unsigned long RunCycles(unsigned long cycles) = 0;
+    virtual unsigned long RunFrame() = 0;
+    virtual unsigned long RunUntilVBlank() = 0;
     virtual void TriggerInterrupt(byte interrupt) = 0;
     virtual byte* GetCurrentFrame() = 0;
     virtual void SetInput(byte input, byte buttons) = 0;
     virtual void SetVSyncCallback(void(*pCallback)()) = 0;
+    virtual void SetIdleLoopSkipping(bool isEnabled) = 0;
+    virtual unsigned long long GetIdleCyclesSkipped() = 0;
+    virtual void SetFrameSkip(unsigned int framesToSkip) = 0;
+    virtual void RequestFrame() = 0;
+    virtual void SetFrameSink(IFrameSink* pSink) = 0;
+    virtual bool SetPixelFormat(int pixelFormat) = 0;
+    virtual void GetShadePalette(unsigned int* pPalette) = 0;
+    virtual unsigned int ReadAudioSamples(short* pSamples, unsigned int count) = 0;
+    virtual bool SetAudioOutput(bool isEnabled) = 0;
+    virtual unsigned int GetAudioQueueLevel() = 0;
+    virtual unsigned int GetAudioUnderrunCount() = 0;
+    virtual bool SetAudioRateAdjustment(int samplesPerSecond) = 0;
 };
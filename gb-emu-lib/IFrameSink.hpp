@@ -0,0 +1,15 @@
+#pragma once
+
+/*
+    Lets the host own the memory frames are drawn into, such as a locked texture or shared memory.
+    BeginFrame is called before the first line of each frame drawn and returns where the 144 lines
+    of 160 pixels (in the pixel format, see ICPU.hpp) go, pitch bytes apart. Returning nullptr skips
+    the frame. EndFrame is called once that frame is complete, before the VSync callback.
+*/
+class IFrameSink
+{
+public:
+    virtual ~IFrameSink() {}
+    virtual byte* BeginFrame(int* pPitch) = 0;
+    virtual void EndFrame() = 0;
+};
@@ -5,7 +5,9 @@ class IMMU
 public:
     virtual ~IMMU() {}
     virtual void RegisterMemoryUnit(const ushort& startRange, const ushort& endRange, IMemoryUnit* pUnit) = 0;
+    virtual void MapMemory(const ushort& startRange, const ushort& endRange, byte* pMemory, bool isWritable) = 0;
     virtual unsigned short ReadUShort(const ushort& address) = 0;
+    virtual bool WriteUShort(const ushort& address, const ushort val) = 0;
     virtual bool LoadBootROM(const char* bootROMPath) = 0;
 
     virtual byte Read(const ushort& address) = 0;
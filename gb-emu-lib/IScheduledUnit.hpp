@@ -0,0 +1,9 @@
+#pragma once
+
+class IScheduledUnit
+{
+public:
+    virtual ~IScheduledUnit() {}
+    virtual void Step(unsigned long cycles) = 0;
+    virtual unsigned long GetCyclesUntilNextEvent() = 0;
+};
@@ -0,0 +1,460 @@
+#include "pch.hpp"
+#include "JIT.hpp"
+
+#include <algorithm>
+
+#if JIT_SUPPORTED
+#if WINDOWS
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+#endif
+
+#define JITCodeSize             0x100000    // 1MB of native code
+#define BlockCodeSize           64          // Prologue, epilogue, and the fall through exit
+#define InstructionCodeSize     160         // Most code emitted per instruction (a conditional jump)
+
+// The 8-bit ALU operations, by the 3 bit index of the OpCodes
+#define ALUAdd  0
+#define ALUAdc  1
+#define ALUSub  2
+#define ALUSbc  3
+#define ALUAnd  4
+#define ALUXor  5
+#define ALUOr   6
+#define ALUCp   7
+
+// x86 "op r/m8, r8" OpCode of each ALU operation
+static const byte HostALUOpCodes[] = { 0x00, 0x10, 0x28, 0x18, 0x20, 0x30, 0x08, 0x38 };
+
+// Registers of the 3 bit index of the OpCodes
+#define RegisterF   0x06
+#define RegisterA   0x07
+
+JIT::JIT() :
+    m_pCode(nullptr),
+    m_pageSize(0x1000),
+    m_codeUsed(0),
+    m_blockStart(0),
+    m_writableEnd(0)
+{
+    memset(&m_layout, 0x00, sizeof(m_layout));
+
+    // LAHF stores SF:ZF:0:AF:0:PF:1:CF, the half carry is the x86 auxiliary carry
+    for (unsigned int hostFlags = 0x00; hostFlags <= 0xFF; hostFlags++)
+    {
+        byte flags = 0x00;
+        flags |= ISBITSET(hostFlags, 6) ? 0x80 : 0x00;
+        flags |= ISBITSET(hostFlags, 4) ? 0x20 : 0x00;
+        flags |= ISBITSET(hostFlags, 0) ? 0x10 : 0x00;
+        m_flagsFromHost[hostFlags] = flags;
+    }
+}
+
+JIT::~JIT()
+{
+#if JIT_SUPPORTED
+    if (m_pCode != nullptr)
+    {
+#if WINDOWS
+        VirtualFree(m_pCode, 0, MEM_RELEASE);
+#else
+        munmap(m_pCode, JITCodeSize);
+#endif
+        m_pCode = nullptr;
+    }
+#endif
+}
+
+bool JIT::Initialize(const JITLayout& layout)
+{
+    m_layout = layout;
+
+#if JIT_SUPPORTED
+#if WINDOWS
+    SYSTEM_INFO systemInfo;
+    GetSystemInfo(&systemInfo);
+    m_pageSize = systemInfo.dwPageSize;
+
+    m_pCode = static_cast<byte*>(VirtualAlloc(nullptr, JITCodeSize, MEM_COMMIT | MEM_RESERVE, PAGE_EXECUTE_READ));
+#else
+    m_pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+
+    void* pCode = mmap(nullptr, JITCodeSize, PROT_READ | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    m_pCode = (pCode != MAP_FAILED) ? static_cast<byte*>(pCode) : nullptr;
+#endif
+    if (m_pCode == nullptr)
+    {
+        Logger::LogError("JIT::Initialize failed to allocate executable memory.");
+        return false;
+    }
+
+    return true;
+#else
+    Logger::Log("JIT::Initialize - The JIT is only supported on x86-64.");
+    return false;
+#endif
+}
+
+// Drops all of the compiled blocks
+void JIT::Reset()
+{
+    m_codeUsed = 0;
+    m_blockStart = 0;
+    m_exitJumps.clear();
+}
+
+bool JIT::BeginBlock(size_t instructionCount)
+{
+    if (m_pCode == nullptr)
+    {
+        return false;
+    }
+
+    size_t blockEnd = m_codeUsed + BlockCodeSize + (instructionCount * InstructionCodeSize);
+    if (blockEnd > JITCodeSize)
+    {
+        // Out of space
+        return false;
+    }
+
+    // Only the pages the block can be emitted to are made writable
+    if (!SetWritable(m_codeUsed, blockEnd, true))
+    {
+        return false;
+    }
+
+    m_writableEnd = blockEnd;
+    m_blockStart = m_codeUsed;
+    m_exitJumps.clear();
+
+    // The CPU is kept in rbx, the next event in r12, and the flags table in r13 (all callee saved)
+    Emit(0x53);                             // push rbx
+    Emit(0x41); Emit(0x54);                 // push r12
+    Emit(0x41); Emit(0x55);                 // push r13
+#if WINDOWS
+    Emit(0x48); Emit(0x89); Emit(0xCB);     // mov rbx, rcx
+    Emit(0x48); Emit(0x83); Emit(0xEC); Emit(0x20); // sub rsp, 32 (shadow space)
+#else
+    Emit(0x48); Emit(0x89); Emit(0xFB);     // mov rbx, rdi
+#endif
+    Emit(0x49); Emit(0xBC);                 // mov r12, pNextEvent
+    Emit64(reinterpret_cast<unsigned long long>(m_layout.pNextEvent));
+    Emit(0x49); Emit(0xBD);                 // mov r13, m_flagsFromHost
+    Emit64(reinterpret_cast<unsigned long long>(m_flagsFromHost));
+
+    return true;
+}
+
+// Calls the entry point of an instruction that is not translated, from the instruction's address
+void JIT::EmitInstruction(TranslatedInstruction pInstruction, const ushort& address, unsigned int operands)
+{
+    EmitSetPC(address);
+#if WINDOWS
+    Emit(0x48); Emit(0x89); Emit(0xD9);     // mov rcx, rbx
+    Emit(0xBA); Emit32(operands);           // mov edx, operands
+#else
+    Emit(0x48); Emit(0x89); Emit(0xDF);     // mov rdi, rbx
+    Emit(0xBE); Emit32(operands);           // mov esi, operands
+#endif
+    Emit(0x48); Emit(0xB8);                 // mov rax, pInstruction
+    Emit64(reinterpret_cast<unsigned long long>(pInstruction));
+    Emit(0xFF); Emit(0xD0);                 // call rax
+    Emit(0x84); Emit(0xC0);                 // test al, al
+    Emit(0x0F); Emit(0x85);                 // jnz exit
+    EmitExitJump();
+}
+
+// LD r, r'
+void JIT::EmitLoad(byte dest, byte source)
+{
+    if (dest != source)
+    {
+        EmitModRM(0x8A, 0, m_layout.registers[source]); // mov al, [source]
+        EmitModRM(0x88, 0, m_layout.registers[dest]);   // mov [dest], al
+    }
+}
+
+// LD r, n
+void JIT::EmitLoadImmediate(byte dest, byte val)
+{
+    EmitModRM(0xC6, 0, m_layout.registers[dest]);       // mov byte [dest], val
+    Emit(val);
+}
+
+// LD rr, nn
+void JIT::EmitLoadPairImmediate(byte pair, ushort val)
+{
+    Emit(0x66);
+    EmitModRM(0xC7, 0, m_layout.registerPairs[pair]);   // mov word [pair], val
+    Emit(val & 0xFF); Emit(val >> 8);
+}
+
+// INC r / DEC r, the x86 INC and DEC leave the carry alone just like these
+void JIT::EmitIncrement(byte dest, bool isDecrement)
+{
+    EmitModRM(0x8A, 0, m_layout.registers[dest]);       // mov al, [dest]
+    Emit(0xFE); Emit(isDecrement ? 0xC8 : 0xC0);        // dec al / inc al
+    EmitModRM(0x88, 0, m_layout.registers[dest]);       // mov [dest], al
+    Emit(0x9F);                                         // lahf
+    Emit(0x0F); Emit(0xB6); Emit(0xCC);                 // movzx ecx, ah
+    Emit(0x41); Emit(0x8A); Emit(0x4C); Emit(0x0D); Emit(0x00); // mov cl, [r13 + rcx]
+    Emit(0x80); Emit(0xE1); Emit(0xA0);                 // and cl, Z | H
+    if (isDecrement)
+    {
+        Emit(0x80); Emit(0xC9); Emit(0x40);             // or cl, N
+    }
+    EmitModRM(0x8A, 2, m_layout.registers[RegisterF]);  // mov dl, [F]
+    Emit(0x80); Emit(0xE2); Emit(0x10);                 // and dl, C
+    Emit(0x08); Emit(0xD1);                             // or cl, dl
+    EmitModRM(0x88, 1, m_layout.registers[RegisterF]);  // mov [F], cl
+}
+
+// INC rr / DEC rr
+void JIT::EmitIncrementPair(byte pair, bool isDecrement)
+{
+    Emit(0x66);
+    EmitModRM(0xFF, isDecrement ? 1 : 0, m_layout.registerPairs[pair]); // dec word [pair] / inc word [pair]
+}
+
+// ADD/ADC/SUB/SBC/AND/XOR/OR/CP A, r
+void JIT::EmitALU(byte operation, byte source)
+{
+    EmitModRM(0x8A, 1, m_layout.registers[source]);     // mov cl, [source]
+    EmitALUFlags(operation);
+}
+
+// ADD/ADC/SUB/SBC/AND/XOR/OR/CP A, n
+void JIT::EmitALUImmediate(byte operation, byte val)
+{
+    Emit(0xB1); Emit(val);                              // mov cl, val
+    EmitALUFlags(operation);
+}
+
+// Runs the ALU operation on A and cl, and writes A and F
+void JIT::EmitALUFlags(byte operation)
+{
+    EmitModRM(0x8A, 0, m_layout.registers[RegisterA]);  // mov al, [A]
+    if (operation == ALUAdc || operation == ALUSbc)
+    {
+        // Carry in from F
+        Emit(0x0F);
+        EmitModRM(0xB6, 2, m_layout.registers[RegisterF]); // movzx edx, byte [F]
+        Emit(0x0F); Emit(0xBA); Emit(0xE2); Emit(0x04); // bt edx, 4
+    }
+    Emit(HostALUOpCodes[operation]); Emit(0xC8);        // op al, cl
+
+    if (operation == ALUAnd || operation == ALUXor || operation == ALUOr)
+    {
+        // Only Z depends on the result, the x86 auxiliary carry is undefined after these
+        Emit(0x84); Emit(0xC0);                         // test al, al
+        Emit(0x0F); Emit(0x94); Emit(0xC1);             // setz cl
+        Emit(0xC0); Emit(0xE1); Emit(0x07);             // shl cl, 7
+        if (operation == ALUAnd)
+        {
+            Emit(0x80); Emit(0xC9); Emit(0x20);         // or cl, H
+        }
+    }
+    else
+    {
+        Emit(0x9F);                                     // lahf
+        Emit(0x0F); Emit(0xB6); Emit(0xCC);             // movzx ecx, ah
+        Emit(0x41); Emit(0x8A); Emit(0x4C); Emit(0x0D); Emit(0x00); // mov cl, [r13 + rcx]
+        if (operation != ALUAdd && operation != ALUAdc)
+        {
+            Emit(0x80); Emit(0xC9); Emit(0x40);         // or cl, N
+        }
+    }
+
+    if (operation != ALUCp)
+    {
+        EmitModRM(0x88, 0, m_layout.registers[RegisterA]); // mov [A], al
+    }
+    EmitModRM(0x88, 1, m_layout.registers[RegisterF]);  // mov [F], cl
+}
+
+// CPL
+void JIT::EmitCPL()
+{
+    EmitModRM(0xF6, 2, m_layout.registers[RegisterA]);  // not byte [A]
+    EmitModRM(0x80, 1, m_layout.registers[RegisterF]);  // or byte [F], N | H
+    Emit(0x60);
+}
+
+// SCF
+void JIT::EmitSCF()
+{
+    EmitModRM(0x80, 4, m_layout.registers[RegisterF]);  // and byte [F], Z
+    Emit(0x80);
+    EmitModRM(0x80, 1, m_layout.registers[RegisterF]);  // or byte [F], C
+    Emit(0x10);
+}
+
+// CCF
+void JIT::EmitCCF()
+{
+    EmitModRM(0x80, 4, m_layout.registers[RegisterF]);  // and byte [F], Z | C
+    Emit(0x90);
+    EmitModRM(0x80, 6, m_layout.registers[RegisterF]);  // xor byte [F], C
+    Emit(0x10);
+}
+
+// JR/JP, the block is left either way as a jump always ends it
+void JIT::EmitJump(byte condition, const ushort& target, byte cycles, byte notTakenCycles, const ushort& nextAddress)
+{
+    size_t notTakenJump = 0;
+    if (condition != JumpAlways)
+    {
+        // NZ/Z test Z, NC/C test C
+        EmitModRM(0xF6, 0, m_layout.registers[RegisterF]); // test byte [F], flag
+        Emit((condition <= 0x01) ? 0x80 : 0x10);
+        Emit(0x0F); Emit((condition & 0x01) ? 0x84 : 0x85); // jz/jnz notTaken
+        notTakenJump = m_codeUsed;
+        Emit32(0x00000000);
+    }
+
+    EmitSetPC(target);
+    EmitCycles(cycles, target);
+    Emit(0xE9);                                         // jmp exit
+    EmitExitJump();
+
+    if (condition != JumpAlways)
+    {
+        unsigned int offset = static_cast<unsigned int>(m_codeUsed - (notTakenJump + 4));
+        memcpy(m_pCode + notTakenJump, &offset, sizeof(offset));
+
+        EmitCycles(notTakenCycles, nextAddress);
+    }
+}
+
+/*
+    Adds the cycles of an instruction, and runs the events that are due, as CompleteBlockInstruction
+    does. Interrupts can only become pending through an event or a write to memory, and the
+    translated instructions do not write to memory.
+*/
+void JIT::EmitCycles(byte cycles, const ushort& nextAddress)
+{
+    Emit(0x48);
+    EmitModRM(0x83, 0, m_layout.cycles);                // add qword [cycles], cycles
+    Emit(cycles);
+    Emit(0x48);
+    EmitModRM(0x8B, 0, m_layout.cycles);                // mov rax, [cycles]
+    Emit(0x49); Emit(0x3B); Emit(0x04); Emit(0x24);     // cmp rax, [r12]
+    Emit(0x72);                                         // jb done
+    size_t doneJump = m_codeUsed;
+    Emit(0x00);
+
+    EmitSetPC(nextAddress);
+#if WINDOWS
+    Emit(0x48); Emit(0x89); Emit(0xD9);                 // mov rcx, rbx
+#else
+    Emit(0x48); Emit(0x89); Emit(0xDF);                 // mov rdi, rbx
+#endif
+    Emit(0x48); Emit(0xB8);                             // mov rax, pRunEvents
+    Emit64(reinterpret_cast<unsigned long long>(m_layout.pRunEvents));
+    Emit(0xFF); Emit(0xD0);                             // call rax
+    Emit(0x84); Emit(0xC0);                             // test al, al
+    Emit(0x0F); Emit(0x85);                             // jnz exit
+    EmitExitJump();
+
+    m_pCode[doneJump] = static_cast<byte>(m_codeUsed - (doneJump + 1));
+}
+
+CompiledBlock JIT::EndBlock(const ushort& endAddress)
+{
+    // The block ran to its end without a jump
+    EmitSetPC(endAddress);
+
+    // Point all of the exit jumps here
+    for (size_t jump : m_exitJumps)
+    {
+        unsigned int offset = static_cast<unsigned int>(m_codeUsed - (jump + 4));
+        memcpy(m_pCode + jump, &offset, sizeof(offset));
+    }
+
+#if WINDOWS
+    Emit(0x48); Emit(0x83); Emit(0xC4); Emit(0x20); // add rsp, 32
+#endif
+    Emit(0x41); Emit(0x5D);                 // pop r13
+    Emit(0x41); Emit(0x5C);                 // pop r12
+    Emit(0x5B);                             // pop rbx
+    Emit(0xC3);                             // ret
+
+    // The block can only run once its pages are executable again
+    if (!SetWritable(m_blockStart, m_writableEnd, false))
+    {
+        return nullptr;
+    }
+
+    return reinterpret_cast<CompiledBlock>(m_pCode + m_blockStart);
+}
+
+// Switches the pages holding [start, end) of the code buffer between read/write and read/execute
+bool JIT::SetWritable(size_t start, size_t end, bool isWritable)
+{
+    size_t pageStart = start & ~(m_pageSize - 1);
+    size_t pageEnd = std::min<size_t>((end + m_pageSize - 1) & ~(m_pageSize - 1), JITCodeSize);
+
+#if JIT_SUPPORTED
+#if WINDOWS
+    DWORD oldProtection;
+    bool isChanged = VirtualProtect(m_pCode + pageStart, pageEnd - pageStart, isWritable ? PAGE_READWRITE : PAGE_EXECUTE_READ, &oldProtection) != 0;
+    if (isChanged && !isWritable)
+    {
+        FlushInstructionCache(GetCurrentProcess(), m_pCode + pageStart, pageEnd - pageStart);
+    }
+#else
+    bool isChanged = mprotect(m_pCode + pageStart, pageEnd - pageStart, isWritable ? (PROT_READ | PROT_WRITE) : (PROT_READ | PROT_EXEC)) == 0;
+#endif
+#else
+    bool isChanged = false;
+#endif
+    if (!isChanged)
+    {
+        Logger::LogError("JIT::SetWritable failed to change the protection of the code buffer.");
+        return false;
+    }
+
+    return true;
+}
+
+void JIT::EmitSetPC(const ushort& address)
+{
+    Emit(0x66);
+    EmitModRM(0xC7, 0, m_layout.PC);        // mov word [PC], address
+    Emit(address & 0xFF); Emit(address >> 8);
+}
+
+// Emits the rel32 of a jump to the block's exit, which is filled in by EndBlock
+void JIT::EmitExitJump()
+{
+    m_exitJumps.push_back(m_codeUsed);
+    Emit32(0x00000000);
+}
+
+// Emits an instruction with a [rbx + offset] operand, reg is the register or the OpCode extension
+void JIT::EmitModRM(byte opCode, byte reg, int offset)
+{
+    Emit(opCode);
+    Emit(0x80 | (reg << 3) | 0x03);
+    Emit32(static_cast<unsigned int>(offset));
+}
+
+void JIT::Emit(byte val)
+{
+    m_pCode[m_codeUsed++] = val;
+}
+
+void JIT::Emit32(unsigned int val)
+{
+    memcpy(m_pCode + m_codeUsed, &val, sizeof(val));
+    m_codeUsed += sizeof(val);
+}
+
+void JIT::Emit64(unsigned long long val)
+{
+    memcpy(m_pCode + m_codeUsed, &val, sizeof(val));
+    m_codeUsed += sizeof(val);
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <vector>
+
+/*
+    JIT (x86-64)
+
+    Translates hot blocks of ROM code into native x86-64 code. The register loads, the 8-bit ALU
+    instructions, and the jumps are translated into native code working on the CPU's registers in
+    place, with their cycle counts as constants. Every other instruction accesses memory or I/O, and
+    becomes a direct call into an entry point specialized for its OpCode, which runs the same handler
+    as the interpreter.
+
+    After each instruction the cycle counter is compared with the next scheduled event, and the
+    compiled code only calls back to run the events and handle the interrupts once one is due.
+    Compiled code works on F directly, so it is kept materialized while a compiled block runs.
+
+    The code buffer is never writable and executable at once: the pages of the block being emitted
+    are made writable, and read-only and executable again before the block runs.
+*/
+#if defined(__x86_64__) || defined(_M_X64)
+#define JIT_SUPPORTED 1
+#else
+#define JIT_SUPPORTED 0
+#endif
+
+// Condition of EmitJump for the unconditional jumps, the others are the cc of the OpCodes
+#define JumpAlways 0xFF
+
+class CPU;
+
+// Runs one translated instruction, returns true when the block must be left
+typedef bool(*TranslatedInstruction)(CPU* pCPU, unsigned int operands);
+
+// Runs the events that are due, with m_PC up to date, returns true when the block must be left
+typedef bool(*TranslatedEvents)(CPU* pCPU);
+
+// Native code for a block
+typedef void(*CompiledBlock)(CPU* pCPU);
+
+// Where the compiled code finds the state of the CPU, as offsets from the CPU passed to the block
+struct JITLayout
+{
+    int registers[0x07 + 1];        // 8-bit registers, by the 3 bit index of the OpCodes (6 is F)
+    int registerPairs[0x03 + 1];    // BC, DE, HL, SP
+    int PC;
+    int cycles;                     // unsigned long long
+    const unsigned long long* pNextEvent;   // Cycle of the next scheduled event
+    TranslatedEvents pRunEvents;
+};
+
+class JIT
+{
+public:
+    JIT();
+    ~JIT();
+
+    bool Initialize(const JITLayout& layout);
+    void Reset();
+
+    bool BeginBlock(size_t instructionCount);
+    void EmitInstruction(TranslatedInstruction pInstruction, const ushort& address, unsigned int operands);
+    void EmitLoad(byte dest, byte source);
+    void EmitLoadImmediate(byte dest, byte val);
+    void EmitLoadPairImmediate(byte pair, ushort val);
+    void EmitIncrement(byte dest, bool isDecrement);
+    void EmitIncrementPair(byte pair, bool isDecrement);
+    void EmitALU(byte operation, byte source);
+    void EmitALUImmediate(byte operation, byte val);
+    void EmitCPL();
+    void EmitSCF();
+    void EmitCCF();
+    void EmitJump(byte condition, const ushort& target, byte cycles, byte notTakenCycles, const ushort& nextAddress);
+    void EmitCycles(byte cycles, const ushort& nextAddress);
+    CompiledBlock EndBlock(const ushort& endAddress);
+
+private:
+    bool SetWritable(size_t start, size_t end, bool isWritable);
+    void EmitALUFlags(byte operation);
+    void EmitSetPC(const ushort& address);
+    void EmitExitJump();
+    void EmitModRM(byte opCode, byte reg, int offset);
+    void Emit(byte val);
+    void Emit32(unsigned int val);
+    void Emit64(unsigned long long val);
+
+private:
+    byte* m_pCode;
+    size_t m_pageSize;
+    size_t m_codeUsed;
+    size_t m_blockStart;
+    size_t m_writableEnd;               // End of the pages made writable for the block being emitted
+    std::vector<size_t> m_exitJumps;    // Offsets of the rel32 of each jump to the block's exit
+    JITLayout m_layout;
+    byte m_flagsFromHost[0xFF + 1];     // F for the host flags stored by LAHF (Z, H, and C)
+};
@@ -18,7 +18,9 @@ MBCs Control Registers.
 MBC::MBC(byte* pROM, byte* pRAM) :
     m_ROM(pROM),
     m_RAM(pRAM),
-    m_isRAMEnabled(false)
+    m_isRAMEnabled(false),
+    m_pROMBank(pROM + 0x4000),
+    m_pRAMBank(nullptr)
 {
 }
 
@@ -26,6 +28,16 @@ MBC::~MBC()
 {
 }
 
+byte* MBC::GetROMBankMemory()
+{
+    return m_pROMBank;
+}
+
+byte* MBC::GetRAMBankMemory()
+{
+    return m_pRAMBank;
+}
+
 /*
 Small games of not more than 32KBytes ROM do not require a MBC chip for ROM banking.
 The ROM is directly mapped to memory at 0000-7FFFh. Optionally up to 8KByte of RAM could be
@@ -35,6 +47,8 @@ connected at A000-BFFF, even though that could require a tiny MBC-like circuit,
 ROMOnly_MBC::ROMOnly_MBC(byte* pROM, byte* pRAM) :
     MBC(pROM, pRAM)
 {
+    // There are no bank registers, the RAM (if any) is always there
+    m_pRAMBank = m_RAM;
 }
 
 ROMOnly_MBC::~ROMOnly_MBC()
@@ -81,12 +95,19 @@ bool ROMOnly_MBC::WriteByte(const ushort& address, const byte val)
     return false;
 }
 
+ushort ROMOnly_MBC::GetROMBank()
+{
+    // 0x4000-0x7FFF always holds the second 16KBytes of the ROM
+    return 0x0001;
+}
+
 MBC1_MBC::MBC1_MBC(byte* pROM, byte* pRAM) :
     MBC(pROM, pRAM),
     m_ROMBankLower(0x01),
     m_ROMRAMBankUpper(0x00),
     m_ROMRAMMode(ROMBankMode)
 {
+    UpdateBanks();
 }
 
 MBC1_MBC::~MBC1_MBC()
@@ -112,16 +133,7 @@ byte MBC1_MBC::ReadByte(const ushort& address)
         Banks (almost 2MByte). As described below, bank numbers 20h, 40h, and 60h cannot be used, resulting
         in the odd amount of 125 banks.
         */
-        byte targetBank = m_ROMBankLower;
-        if (m_ROMRAMMode == ROMBankMode)
-        {
-            // The upper bank values are only available in ROM Bank Mode
-            targetBank |= (m_ROMRAMBankUpper << 4);
-        }
-
-        unsigned int target = (address - 0x4000);
-        target += (0x4000 * targetBank);
-        return m_ROM[target];
+        return m_pROMBank[address - 0x4000];
     }
     else if (address >= 0xA000 && address <= 0xBFFF)
     {
@@ -132,27 +144,13 @@ byte MBC1_MBC::ReadByte(const ushort& address)
         or if the cartridge is removed from the gameboy. Available RAM sizes are: 2KByte (at A000-A7FF),
         8KByte (at A000-BFFF), and 32KByte (in form of four 8K banks at A000-BFFF).
         */
-        if (!m_isRAMEnabled)
-        {
-            // RAM disabled
-            return 0x00;
-        }
-
-        if (m_RAM == nullptr)
+        if (m_pRAMBank == nullptr)
         {
-            // RAM not initialized
+            // RAM disabled or not initialized
             return 0x00;
         }
 
-        // In ROM Mode, only bank 0x00 is available
-        unsigned int target = address - 0xA000;
-        if (m_ROMRAMMode == RAMBankMode)
-        {
-            // Offset based on the bank number
-            target += (0x2000 * m_ROMRAMBankUpper);
-        }
-
-        return m_RAM[target];
+        return m_pRAMBank[address - 0xA000];
     }
 
     Logger::Log("MBC1_MBC::ReadByte doesn't support reading from 0x%04X", address);
@@ -173,6 +171,7 @@ bool MBC1_MBC::WriteByte(const ushort& address, const byte val)
         Practically any value with 0Ah in the lower 4 bits enables RAM, and any other value disables RAM.
         */
         m_isRAMEnabled = ((val & EnableRAM) == EnableRAM);
+        UpdateBanks();
         return true;
     }
     else if (address <= 0x3FFF)
@@ -191,6 +190,7 @@ bool MBC1_MBC::WriteByte(const ushort& address, const byte val)
             m_ROMBankLower = 0x01;
         }
 
+        UpdateBanks();
         return true;
     }
     else if (address <= 0x5FFF)
@@ -202,6 +202,7 @@ bool MBC1_MBC::WriteByte(const ushort& address, const byte val)
         */
 
         m_ROMRAMBankUpper = val & 0x03;
+        UpdateBanks();
         return true;
     }
     else if (address <= 0x7FFF)
@@ -216,6 +217,7 @@ bool MBC1_MBC::WriteByte(const ushort& address, const byte val)
         can be used during Mode 0, and only ROM Banks 00-1Fh can be used during Mode 1.
         */
         m_ROMRAMMode = val & 0x01;
+        UpdateBanks();
         return true;
     }
     else if (address >= 0xA000 && address <= 0xBFFF)
@@ -228,27 +230,13 @@ bool MBC1_MBC::WriteByte(const ushort& address, const byte val)
         8KByte (at A000-BFFF), and 32KByte (in form of four 8K banks at A000-BFFF).
         */
 
-        if (!m_isRAMEnabled)
+        if (m_pRAMBank == nullptr)
         {
-            // RAM disabled
+            // RAM disabled or not initialized
             return false;
         }
 
-        if (m_RAM == nullptr)
-        {
-            // RAM not initialized
-            return false;
-        }
-
-        // In ROM Mode, only bank 0x00 is available
-        unsigned int target = address - 0xA000;
-        if (m_ROMRAMMode == RAMBankMode)
-        {
-            // Offset based on the bank number
-            target += (0x2000 * m_ROMRAMBankUpper);
-        }
-
-        m_RAM[target] = val;
+        m_pRAMBank[address - 0xA000] = val;
         return true;
     }
 
@@ -256,6 +244,34 @@ bool MBC1_MBC::WriteByte(const ushort& address, const byte val)
     return false;
 }
 
+ushort MBC1_MBC::GetROMBank()
+{
+    // The upper bank values are only available in ROM Bank Mode
+    byte targetBank = m_ROMBankLower;
+    if (m_ROMRAMMode == ROMBankMode)
+    {
+        targetBank |= (m_ROMRAMBankUpper << 4);
+    }
+
+    return targetBank;
+}
+
+// Points the cached bank memory at the banks selected by the bank registers
+void MBC1_MBC::UpdateBanks()
+{
+    m_pROMBank = m_ROM + (0x4000 * GetROMBank());
+
+    if (!m_isRAMEnabled || m_RAM == nullptr)
+    {
+        m_pRAMBank = nullptr;
+    }
+    else
+    {
+        // In ROM Mode, only bank 0x00 is available
+        m_pRAMBank = m_RAM + ((m_ROMRAMMode == RAMBankMode) ? (0x2000 * m_ROMRAMBankUpper) : 0);
+    }
+}
+
 /*
 MBC2 (max 256KByte ROM and 512x4 bits RAM)
 */
@@ -264,6 +280,7 @@ MBC2_MBC::MBC2_MBC(byte* pROM) :
     MBC(pROM, new byte[0x1FF + 1]),
     m_ROMBank(0x01)
 {
+    UpdateBanks();
 }
 
 MBC2_MBC::~MBC2_MBC()
@@ -288,9 +305,7 @@ byte MBC2_MBC::ReadByte(const ushort& address)
         This area may contain any of the further 16KByte banks of the ROM, allowing to address up to 16 ROM
         Banks (almost 256KByte).
         */
-        unsigned int target = (address - 0x4000);
-        target += (0x4000 * m_ROMBank);
-        return m_ROM[target];
+        return m_pROMBank[address - 0x4000];
     }
     else if (address >= 0xA000 && address <= 0xA1FF)
     {
@@ -345,6 +360,7 @@ bool MBC2_MBC::WriteByte(const ushort& address, const byte val)
         if ((address & 0x0100) == 0x0000)
         {
             m_ROMBank = (val & 0x0F);
+            UpdateBanks();
             return true;
         }
     }
@@ -370,6 +386,17 @@ bool MBC2_MBC::WriteByte(const ushort& address, const byte val)
     return false;
 }
 
+ushort MBC2_MBC::GetROMBank()
+{
+    return m_ROMBank;
+}
+
+// The RAM only holds 4 bit values, so it is always accessed through ReadByte and WriteByte
+void MBC2_MBC::UpdateBanks()
+{
+    m_pROMBank = m_ROM + (0x4000 * m_ROMBank);
+}
+
 
 /*
 MBC3 (max 2MByte ROM and/or 32KByte RAM and Timer)
@@ -413,6 +440,7 @@ MBC3_MBC::MBC3_MBC(byte* pROM, byte* pRAM) :
     m_RAMBank(0x00)
 {
     memset(m_RTCRegisters, 0x00, ARRAYSIZE(m_RTCRegisters));
+    UpdateBanks();
 }
 
 MBC3_MBC::~MBC3_MBC()
@@ -436,9 +464,7 @@ byte MBC3_MBC::ReadByte(const ushort& address)
         4000-7FFF - ROM Bank 01-7F (Read Only)
         Same as for MBC1, except that accessing banks 20h, 40h, and 60h is supported now.
         */
-        unsigned int target = (address - 0x4000);
-        target += (0x4000 * m_ROMBank);
-        return m_ROM[target];
+        return m_pROMBank[address - 0x4000];
     }
     else if (address >= 0xA000 && address <= 0xBFFF)
     {
@@ -462,10 +488,7 @@ byte MBC3_MBC::ReadByte(const ushort& address)
 
         if (m_RAMBank <= 0x03)
         {
-            unsigned int target = address - 0xA000;
-            // Offset based on the bank number
-            target += (0x2000 * m_RAMBank);
-            return m_RAM[target];
+            return m_pRAMBank[address - 0xA000];
         }
         else if (m_RAMBank >= 0x08 && m_RAMBank <= 0x0C)
         {
@@ -487,6 +510,7 @@ bool MBC3_MBC::WriteByte(const ushort& address, const byte val)
         to the RTC Registers! A value of 00h will disable either.
         */
         m_isRAMEnabled = ((val & EnableRAM) == EnableRAM);
+        UpdateBanks();
         return true;
     }
     else if (address <= 0x3FFF)
@@ -503,6 +527,7 @@ bool MBC3_MBC::WriteByte(const ushort& address, const byte val)
             m_ROMBank = 0x01;
         }
 
+        UpdateBanks();
         return true;
     }
     else if (address <= 0x5FFF)
@@ -516,6 +541,7 @@ bool MBC3_MBC::WriteByte(const ushort& address, const byte val)
         typically that is done by using address A000.
         */
         m_RAMBank = val;
+        UpdateBanks();
         return true;
     }
     else if (address <= 0x7FFF)
@@ -557,10 +583,7 @@ bool MBC3_MBC::WriteByte(const ushort& address, const byte val)
 
         if (m_RAMBank <= 0x03)
         {
-            unsigned int target = address - 0xA000;
-            // Offset based on the bank number
-            target += (0x2000 * m_RAMBank);
-            m_RAM[target] = val;
+            m_pRAMBank[address - 0xA000] = val;
             return true;
         }
         else if (m_RAMBank >= 0x08 && m_RAMBank <= 0x0C)
@@ -574,6 +597,27 @@ bool MBC3_MBC::WriteByte(const ushort& address, const byte val)
     return false;
 }
 
+ushort MBC3_MBC::GetROMBank()
+{
+    return m_ROMBank;
+}
+
+// Points the cached bank memory at the banks selected by the bank registers
+void MBC3_MBC::UpdateBanks()
+{
+    m_pROMBank = m_ROM + (0x4000 * m_ROMBank);
+
+    if (!m_isRAMEnabled || m_RAM == nullptr || m_RAMBank > 0x03)
+    {
+        // The RTC registers are not plain memory
+        m_pRAMBank = nullptr;
+    }
+    else
+    {
+        m_pRAMBank = m_RAM + (0x2000 * m_RAMBank);
+    }
+}
+
 /*
 MBC5 (max 2MByte ROM and/or 32KByte RAM and Timer)
 
@@ -587,6 +631,7 @@ MBC5_MBC::MBC5_MBC(byte* pROM, byte* pRAM) :
     m_ROMBank(0x0000),
     m_RAMBank(0x00)
 {
+    UpdateBanks();
 }
 
 MBC5_MBC::~MBC5_MBC()
@@ -612,9 +657,7 @@ byte MBC5_MBC::ReadByte(const ushort& address)
         HLLLLLL LLAAAAAA AAAAAAAA (64MBit)
         (i/o resides in this bank, see below)
         */
-        unsigned int target = (address - 0x4000);
-        target += (0x4000 * m_ROMBank);
-        return m_ROM[target];
+        return m_pROMBank[address - 0x4000];
     }
     else if (address >= 0xA000 && address <= 0xBFFF)
     {
@@ -623,9 +666,7 @@ byte MBC5_MBC::ReadByte(const ushort& address)
         This is 17 bit wide in order to access 1MBit.
         B BBBAAAAA AAAAAAAA
         */
-        unsigned int target = address - 0xA000;
-        target += (0x2000 * m_RAMBank);
-        return m_RAM[target];
+        return m_pRAMBank[address - 0xA000];
     }
 
     Logger::Log("MBC5_MBC::ReadByte doesn't support reading from 0x%04X", address);
@@ -662,6 +703,7 @@ bool MBC5_MBC::WriteByte(const ushort& address, const byte val)
         LLLL LLLL
         */
         m_ROMBank = (m_ROMBank & 0xFF00) | val;
+        UpdateBanks();
         return true;
     }
     else if (address <= 0x3FFF)
@@ -673,6 +715,7 @@ bool MBC5_MBC::WriteByte(const ushort& address, const byte val)
         */
         ushort upper = (ushort)(val & 0x01);
         m_ROMBank = (m_ROMBank & 0x00FF) | (upper << 8);
+        UpdateBanks();
         return true;
     }
     else if (address <= 0x4FFF)
@@ -683,6 +726,7 @@ bool MBC5_MBC::WriteByte(const ushort& address, const byte val)
         XXXX BBBB
         */
         m_RAMBank = (val & 0x0F);
+        UpdateBanks();
         return true;
     }
     else if (address >= 0xA000 && address <= 0xBFFF)
@@ -692,12 +736,22 @@ bool MBC5_MBC::WriteByte(const ushort& address, const byte val)
         This is 17 bit wide in order to access 1MBit.
         B BBBAAAAA AAAAAAAA
         */
-        unsigned int target = address - 0xA000;
-        target += (0x2000 * m_RAMBank);
-        m_RAM[target] = val;
+        m_pRAMBank[address - 0xA000] = val;
         return true;
     }
 
     Logger::Log("MBC5_MBC::WriteByte doesn't support writing to 0x%04X", address);
     return false;
 }
+
+ushort MBC5_MBC::GetROMBank()
+{
+    return m_ROMBank;
+}
+
+// Points the cached bank memory at the banks selected by the bank registers
+void MBC5_MBC::UpdateBanks()
+{
+    m_pROMBank = m_ROM + (0x4000 * m_ROMBank);
+    m_pRAMBank = (m_RAM != nullptr) ? m_RAM + (0x2000 * m_RAMBank) : nullptr;
+}
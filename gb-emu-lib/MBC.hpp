@@ -32,11 +32,21 @@ public:
     // IMemoryUnit
     virtual byte ReadByte(const ushort& address) = 0;
     virtual bool WriteByte(const ushort& address, const byte val) = 0;
-    
+
+    // The ROM bank currently mapped to 0x4000-0x7FFF
+    virtual ushort GetROMBank() = 0;
+
+    // Memory of the banks currently mapped, refreshed when the bank registers are written
+    byte* GetROMBankMemory();
+    byte* GetRAMBankMemory();
+
 protected:
     byte* m_ROM;
     byte* m_RAM;
     bool m_isRAMEnabled;
+
+    byte* m_pROMBank;   // 0x4000-0x7FFF
+    byte* m_pRAMBank;   // 0xA000-0xBFFF, nullptr while it can't be accessed as plain memory
 };
 
 class ROMOnly_MBC : public MBC
@@ -48,6 +58,8 @@ public:
     // IMemoryUnit
     byte ReadByte(const ushort& address);
     bool WriteByte(const ushort& address, const byte val);
+
+    ushort GetROMBank();
 };
 
 class MBC1_MBC : public MBC
@@ -60,6 +72,11 @@ public:
     byte ReadByte(const ushort& address);
     bool WriteByte(const ushort& address, const byte val);
 
+    ushort GetROMBank();
+
+private:
+    void UpdateBanks();
+
 private:
     byte m_ROMBankLower;
     byte m_ROMRAMBankUpper;
@@ -76,6 +93,11 @@ public:
     byte ReadByte(const ushort& address);
     bool WriteByte(const ushort& address, const byte val);
 
+    ushort GetROMBank();
+
+private:
+    void UpdateBanks();
+
 private:
     byte m_ROMBank;
 };
@@ -90,6 +112,11 @@ public:
     byte ReadByte(const ushort& address);
     bool WriteByte(const ushort& address, const byte val);
 
+    ushort GetROMBank();
+
+private:
+    void UpdateBanks();
+
 private:
     byte m_ROMBank;
     byte m_RAMBank;
@@ -106,6 +133,11 @@ public:
     byte ReadByte(const ushort& address);
     bool WriteByte(const ushort& address, const byte val);
 
+    ushort GetROMBank();
+
+private:
+    void UpdateBanks();
+
 private:
     byte m_RAMG;
 
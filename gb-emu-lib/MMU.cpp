@@ -36,12 +36,27 @@
     -MMU:
     0xFF80-0xFFFE   High RAM (HRAM)
     0xFFFF          Interrupt Enable Register
+
+    Page Map
+    ========
+    Every 256 byte page which is plain memory (ROM bank 00, VRAM, WRAM, OAM) is mapped straight to
+    the memory backing it, so reading it is a shift, a load, and an add. The pages with I/O ports or
+    MBC controlled banks are left to the IMemoryUnit registered for each address.
 */
 
 MMU::MMU() :
-    m_isBooting(0x00)
+    m_isBooting(0x00),
+    m_cartridgePage(nullptr)
 {
+    memset(m_readPages, 0x00, sizeof(m_readPages));
+    memset(m_writePages, 0x00, sizeof(m_writePages));
+
     RegisterMemoryUnit(0x0000, 0xFFFF, this);
+
+    MapMemory(0xC000, 0xCFFF, m_bank0, true);
+    MapMemory(0xD000, 0xDFFF, m_bank1, true);
+    MapMemory(0xE000, 0xEFFF, m_bank0, true);
+    MapMemory(0xF000, 0xFDFF, m_bank1, true);
 }
 
 MMU::~MMU()
@@ -56,8 +71,45 @@ void MMU::RegisterMemoryUnit(const ushort& startRange, const ushort& endRange, I
     }
 }
 
+/*
+    Maps the pages from startRange to endRange straight to pMemory, which holds the byte at startRange.
+    The range must start and end on page boundaries.
+*/
+void MMU::MapMemory(const ushort& startRange, const ushort& endRange, byte* pMemory, bool isWritable)
+{
+    for (int page = (startRange >> 8); page <= (endRange >> 8); page++)
+    {
+        byte* pPage = (pMemory != nullptr) ? pMemory + ((page << 8) - startRange) : nullptr;
+
+        if (page == 0x00)
+        {
+            m_cartridgePage = pPage;
+        }
+        else
+        {
+            m_readPages[page] = pPage;
+        }
+
+        m_writePages[page] = isWritable ? pPage : nullptr;
+    }
+
+    MapBootROM();
+}
+
+// Page 0x00 reads from the boot ROM until it is unmapped by a write to 0xFF50
+void MMU::MapBootROM()
+{
+    m_readPages[0x00] = (m_isBooting == 0x00) ? m_BIOS.get() : m_cartridgePage;
+}
+
 byte MMU::Read(const ushort& address)
 {
+    byte* pPage = m_readPages[address >> 8];
+    if (pPage != nullptr)
+    {
+        return pPage[address & 0xFF];
+    }
+
     // If we are booting and reading below 0x00FF, read from the boot rom.
     if ((m_isBooting == 0x00) && (address <= 0x00FF))
     {
@@ -73,20 +125,47 @@ byte MMU::Read(const ushort& address)
     return m_memoryUnits[address]->ReadByte(address);
 }
 
+/*
+    When both bytes are in the same directly mapped page, the value is loaded at once. The Gameboy
+    is little endian, like the hosts the CPU's register map already assumes.
+*/
 ushort MMU::ReadUShort(const ushort& address)
 {
+    byte* pPage = m_readPages[address >> 8];
+    if (pPage != nullptr && (address & 0xFF) != 0xFF)
+    {
+        ushort val;
+        memcpy(&val, pPage + (address & 0xFF), sizeof(val));
+        return val;
+    }
+
     ushort val = Read(address + 1);
     val = val << 8;
     val |= Read(address);
     return val;
 }
 
+// Writes the high byte first, like a PUSH
+bool MMU::WriteUShort(const ushort& address, const ushort val)
+{
+    byte* pPage = m_writePages[address >> 8];
+    if (pPage != nullptr && (address & 0xFF) != 0xFF)
+    {
+        memcpy(pPage + (address & 0xFF), &val, sizeof(val));
+        return true;
+    }
+
+    bool succeeded = Write(address + 1, static_cast<byte>(val >> 8));
+    return Write(address, static_cast<byte>(val)) && succeeded;
+}
+
 bool MMU::LoadBootROM(const char* bootROMPath)
 {
     if (bootROMPath == nullptr)
     {
         // Set the booted flag, this will trigger the CPU to "preboot".
         m_isBooting = 0x01;
+        MapBootROM();
         return true;
     }
     else
@@ -125,12 +204,20 @@ bool MMU::LoadBootROM(const char* bootROMPath)
             }
         }
 
+        MapBootROM();
         return succeeded;
     }
 }
 
 bool MMU::Write(const ushort& address, const byte val)
 {
+    byte* pPage = m_writePages[address >> 8];
+    if (pPage != nullptr)
+    {
+        pPage[address & 0xFF] = val;
+        return true;
+    }
+
     if ((m_isBooting == 0x00) && (address <= 0x00FF))
     {
         Logger::LogError("Access Violation! You can't write to the boot ROM [0x%04X = 0x%02X]", address, val);
@@ -152,7 +239,12 @@ byte MMU::ReadByte(const ushort& address)
     0xFFFF          Interrupt Enable Register
     */
 
-    if (address >= 0xC000 && address <= 0xCFFF)
+    // The work RAM is read through the page map, HRAM shares its page with the I/O ports
+    if (address >= 0xFF80 && address <= 0xFFFE)
+    {
+        return m_HRAM[address - 0xFF80];
+    }
+    else if (address >= 0xC000 && address <= 0xCFFF)
     {
         return m_bank0[address - 0xC000];
     }
@@ -173,10 +265,6 @@ byte MMU::ReadByte(const ushort& address)
         // Unusable memory
         return 0x00;
     }
-    else if (address >= 0xFF80 && address <= 0xFFFE)
-    {
-        return m_HRAM[address - 0xFF80];
-    }
     else if (address == 0xFFFF)
     {
         return m_IE;
@@ -201,7 +289,11 @@ byte MMU::ReadByte(const ushort& address)
 
 bool MMU::WriteByte(const ushort& address, const byte val)
 {
-    if (address >= 0xC000 && address <= 0xCFFF)
+    if (address >= 0xFF80 && address <= 0xFFFE)
+    {
+        m_HRAM[address - 0xFF80] = val;
+    }
+    else if (address >= 0xC000 && address <= 0xCFFF)
     {
         m_bank0[address - 0xC000] = val;
     }
@@ -217,10 +309,6 @@ bool MMU::WriteByte(const ushort& address, const byte val)
     {
         m_bank1[address - 0xF000] = val;
     }
-    else if (address >= 0xFF80 && address <= 0xFFFE)
-    {
-        m_HRAM[address - 0xFF80] = val;
-    }
     else if (address == 0xFFFF)
     {
         m_IE = val;
@@ -232,6 +320,7 @@ bool MMU::WriteByte(const ushort& address, const byte val)
     else if (address == 0xFF50)
     {
         m_isBooting = val;
+        MapBootROM();
     }
     else if (address == 0xFF4D)
     {
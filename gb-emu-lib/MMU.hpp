@@ -7,7 +7,9 @@ public:
     ~MMU();
 
     void RegisterMemoryUnit(const ushort& startRange, const ushort& endRange, IMemoryUnit* pUnit);
+    void MapMemory(const ushort& startRange, const ushort& endRange, byte* pMemory, bool isWritable);
     unsigned short ReadUShort(const ushort& address);
+    bool WriteUShort(const ushort& address, const ushort val);
     bool LoadBootROM(const char* bootROMPath);
 
     byte Read(const ushort& address);
@@ -17,6 +19,9 @@ public:
     byte ReadByte(const ushort& address);
     bool WriteByte(const ushort& address, const byte val);
 
+private:
+    void MapBootROM();
+
 private:
     //byte ReadByteInternal(const ushort& address);
     //bool WriteByteInternal(const ushort& address, const byte val);
@@ -28,6 +33,9 @@ private:
 
     // Memory
     IMemoryUnit* m_memoryUnits[0xFFFF + 1];
+    byte* m_readPages[0xFF + 1];    // Memory of each 256 byte page, nullptr if its unit handles the reads
+    byte* m_writePages[0xFF + 1];   // Memory of each 256 byte page, nullptr if its unit handles the writes
+    byte* m_cartridgePage;          // Page 0x00 of the cartridge, hidden while the boot ROM is mapped
     byte m_bank0[0x0FFF + 1];   // 4k work RAM Bank 0
     byte m_bank1[0x0FFF + 1];   // 4k work RAM Bank 1
     byte m_HRAM[0x007E + 1];    // HRAM
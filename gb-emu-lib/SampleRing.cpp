@@ -0,0 +1,88 @@
+#include "pch.hpp"
+#include "SampleRing.hpp"
+
+#include <algorithm>
+
+// capacity is the number of stereo samples the ring holds
+SampleRing::SampleRing(unsigned int capacity) :
+    m_capacity(capacity),
+    m_mask(0),
+    m_writeIndex(0),
+    m_readIndex(0),
+    m_underruns(0)
+{
+    while (m_mask + 1 < m_capacity)
+    {
+        m_mask = (m_mask << 1) | 0x01;
+    }
+
+    m_samples.resize((m_mask + 1) * 2, 0);
+}
+
+SampleRing::~SampleRing()
+{
+}
+
+// The number of stereo samples Write can take right now
+unsigned int SampleRing::GetFreeSpace()
+{
+    return m_capacity - (m_writeIndex.load(std::memory_order_relaxed) - m_readIndex.load(std::memory_order_acquire));
+}
+
+/*
+    Adds up to count stereo samples, as many as there is room for, and returns the number added.
+    The samples are only visible to Read once they are all copied.
+*/
+unsigned int SampleRing::Write(const short* pSamples, unsigned int count)
+{
+    unsigned int writeIndex = m_writeIndex.load(std::memory_order_relaxed);
+    count = std::min(count, GetFreeSpace());
+
+    // Copy in up to two parts, the second one after wrapping around to the start
+    unsigned int start = writeIndex & m_mask;
+    unsigned int first = std::min(count, m_mask + 1 - start);
+    memcpy(m_samples.data() + (start * 2), pSamples, first * 2 * sizeof(short));
+    memcpy(m_samples.data(), pSamples + (first * 2), (count - first) * 2 * sizeof(short));
+
+    m_writeIndex.store(writeIndex + count, std::memory_order_release);
+    return count;
+}
+
+/*
+    Takes count stereo samples, padding with silence when the ring runs dry (an underrun). Returns
+    the number of samples that came from the ring.
+*/
+unsigned int SampleRing::Read(short* pSamples, unsigned int count)
+{
+    unsigned int readIndex = m_readIndex.load(std::memory_order_relaxed);
+    unsigned int available = m_writeIndex.load(std::memory_order_acquire) - readIndex;
+    unsigned int read = std::min(count, available);
+
+    unsigned int start = readIndex & m_mask;
+    unsigned int first = std::min(read, m_mask + 1 - start);
+    memcpy(pSamples, m_samples.data() + (start * 2), first * 2 * sizeof(short));
+    memcpy(pSamples + (first * 2), m_samples.data(), (read - first) * 2 * sizeof(short));
+
+    // The producer may reuse the space from here on
+    m_readIndex.store(readIndex + read, std::memory_order_release);
+
+    if (read < count)
+    {
+        memset(pSamples + (read * 2), 0, (count - read) * 2 * sizeof(short));
+        m_underruns.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    return read;
+}
+
+// The number of stereo samples waiting to be read
+unsigned int SampleRing::GetFillLevel()
+{
+    return m_writeIndex.load(std::memory_order_acquire) - m_readIndex.load(std::memory_order_acquire);
+}
+
+// The number of Reads that had to be padded with silence
+unsigned int SampleRing::GetUnderrunCount()
+{
+    return m_underruns.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+
+/*
+    SampleRing
+
+    Hands stereo samples from the emulation thread to the audio callback without locks. It is a
+    single producer, single consumer ring: only the producer moves the write index and only the
+    consumer moves the read index, each publishing its move with a release store the other side
+    reads with an acquire load. The indexes count samples forever and wrap around the unsigned int,
+    their difference is the fill level.
+
+    The buffer is rounded up to a power of two, so an index's position in it is the index masked,
+    which carries on smoothly when the index wraps around. Only capacity samples are ever queued.
+*/
+class SampleRing
+{
+    friend class APUTests;
+
+public:
+    SampleRing(unsigned int capacity);
+    ~SampleRing();
+
+    // Producer
+    unsigned int GetFreeSpace();
+    unsigned int Write(const short* pSamples, unsigned int count);
+
+    // Consumer
+    unsigned int Read(short* pSamples, unsigned int count);
+
+    // Either thread
+    unsigned int GetFillLevel();
+    unsigned int GetUnderrunCount();
+
+private:
+    std::vector<short> m_samples;   // Stereo samples, left and right interleaved
+    unsigned int m_capacity;
+    unsigned int m_mask;            // Number of stereo samples in m_samples, minus one
+    std::atomic<unsigned int> m_writeIndex;
+    std::atomic<unsigned int> m_readIndex;
+    std::atomic<unsigned int> m_underruns;
+};
@@ -0,0 +1,126 @@
+#include "pch.hpp"
+#include "Scheduler.hpp"
+
+#include <climits>
+
+// Upper bound on a deadline, so an idle unit is still stepped at least once a frame
+#define MaxEventCycles  70224
+
+// The deadline of a catch-up unit with no event due
+#define NoDeadline      ULLONG_MAX
+
+Scheduler::Scheduler() :
+    m_nextEvent(ULLONG_MAX)
+{
+    memset(m_registerUnits, 0x00, ARRAYSIZE(m_registerUnits));
+}
+
+Scheduler::~Scheduler()
+{
+}
+
+/*
+    Adds a unit, with the 0xFFxx registers it owns. A catch-up unit whose GetCyclesUntilNextEvent
+    returns ULONG_MAX has no deadline at all, it is stepped over the whole span since its last step
+    once one of its registers is accessed.
+*/
+void Scheduler::AddUnit(IScheduledUnit* pUnit, const ushort& startAddress, const ushort& endAddress, bool isCatchUp)
+{
+    m_units.push_back({ pUnit, 0, 0, isCatchUp });
+
+    for (unsigned int address = startAddress; address <= endAddress; address++)
+    {
+        m_registerUnits[address & 0xFF] = static_cast<byte>(m_units.size());
+    }
+}
+
+// Schedules every unit from the given cycle, the units must not have been stepped since
+void Scheduler::Start(const unsigned long long& cycles)
+{
+    for (ScheduledUnit& unit : m_units)
+    {
+        unit.lastCycles = cycles;
+        ScheduleUnit(unit);
+    }
+
+    UpdateNextEvent();
+}
+
+// Steps the unit owning the register at address up to the given cycle, before it is accessed
+void Scheduler::Synchronize(const ushort& address, const unsigned long long& cycles)
+{
+    byte index = m_registerUnits[address & 0xFF];
+    if (index != 0)
+    {
+        SynchronizeUnit(m_units[index - 1], cycles);
+        UpdateNextEvent();
+    }
+}
+
+// Recomputes the deadline of the unit owning the register at address, after it was written to
+void Scheduler::Reschedule(const ushort& address)
+{
+    byte index = m_registerUnits[address & 0xFF];
+    if (index != 0)
+    {
+        ScheduleUnit(m_units[index - 1]);
+        UpdateNextEvent();
+    }
+}
+
+// Steps every unit whose deadline has passed
+void Scheduler::RunEvents(const unsigned long long& cycles)
+{
+    for (ScheduledUnit& unit : m_units)
+    {
+        if (unit.deadline <= cycles)
+        {
+            SynchronizeUnit(unit, cycles);
+        }
+    }
+
+    UpdateNextEvent();
+}
+
+void Scheduler::SynchronizeUnit(ScheduledUnit& unit, const unsigned long long& cycles)
+{
+    // A catch-up unit may be behind by more than Step takes at once
+    while (cycles > unit.lastCycles)
+    {
+        unsigned long long elapsed = cycles - unit.lastCycles;
+        unsigned long step = (elapsed > ULONG_MAX) ? ULONG_MAX : static_cast<unsigned long>(elapsed);
+        unit.pUnit->Step(step);
+        unit.lastCycles += step;
+    }
+
+    ScheduleUnit(unit);
+}
+
+void Scheduler::ScheduleUnit(ScheduledUnit& unit)
+{
+    unsigned long cycles = unit.pUnit->GetCyclesUntilNextEvent();
+    if (unit.isCatchUp && (cycles == ULONG_MAX))
+    {
+        unit.deadline = NoDeadline;
+        return;
+    }
+
+    if (cycles > MaxEventCycles)
+    {
+        cycles = MaxEventCycles;
+    }
+
+    unit.deadline = unit.lastCycles + cycles;
+}
+
+void Scheduler::UpdateNextEvent()
+{
+    m_nextEvent = ULLONG_MAX;
+    for (const ScheduledUnit& unit : m_units)
+    {
+        if (unit.deadline < m_nextEvent)
+        {
+            m_nextEvent = unit.deadline;
+        }
+    }
+}
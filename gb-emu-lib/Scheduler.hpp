@@ -0,0 +1,47 @@
+#pragma once
+
+#include <vector>
+
+/*
+    Scheduler
+
+    Keeps the deadline of the next event of each clocked unit (GPU, Timer, APU) on the CPU's master
+    cycle counter. A unit is only stepped when its deadline has passed, or right before one of its
+    registers is accessed, so the CPU runs uninterrupted between deadlines. A catch-up unit with
+    nothing due is not even stepped once a frame, only when its registers or output are needed.
+*/
+class Scheduler
+{
+public:
+    Scheduler();
+    ~Scheduler();
+
+    void AddUnit(IScheduledUnit* pUnit, const ushort& startAddress, const ushort& endAddress, bool isCatchUp);
+    void Start(const unsigned long long& cycles);
+
+    void Synchronize(const ushort& address, const unsigned long long& cycles);
+    void Reschedule(const ushort& address);
+    void RunEvents(const unsigned long long& cycles);
+
+    // The cycle of the earliest deadline
+    unsigned long long GetNextEvent() const { return m_nextEvent; }
+    const unsigned long long* GetNextEventAddress() const { return &m_nextEvent; }
+
+private:
+    struct ScheduledUnit
+    {
+        IScheduledUnit* pUnit;
+        unsigned long long lastCycles;  // The cycle the unit has been stepped to
+        unsigned long long deadline;    // The cycle of the unit's next event
+        bool isCatchUp;                 // Without an event due, only stepped by Synchronize
+    };
+
+    void SynchronizeUnit(ScheduledUnit& unit, const unsigned long long& cycles);
+    void ScheduleUnit(ScheduledUnit& unit);
+    void UpdateNextEvent();
+
+private:
+    std::vector<ScheduledUnit> m_units;
+    byte m_registerUnits[0xFF + 1]; // 1 + the index of the unit owning each 0xFF00-0xFFFF register
+    unsigned long long m_nextEvent;
+};
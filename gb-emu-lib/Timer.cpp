@@ -1,6 +1,9 @@
 #include "pch.hpp"
 #include "Timer.hpp"
 
+#include <algorithm>
+#include <climits>
+
 // FF04 - DIV - Divider Register (R/W)
 // FF05 - TIMA - Timer counter (R/W)
 // FF06 - TMA - Timer Modulo (R/W)
@@ -59,6 +62,23 @@ bool Timer::Counter::Step(unsigned int cycles)
     return false;
 }
 
+// Returns the number of cycles until the value next overflows
+unsigned long Timer::Counter::GetCyclesUntilOverflow()
+{
+    if (!m_IsRunning)
+    {
+        return ULONG_MAX;
+    }
+
+    if (m_Cycles <= 0)
+    {
+        // Increments are still pending from an earlier overflow
+        return 0;
+    }
+
+    return m_Cycles + ((0xFF - m_Value) * FrequencyCounts[m_Frequency]);
+}
+
 byte Timer::Counter::GetValue()
 {
     return m_Value;
@@ -118,6 +138,15 @@ void Timer::Step(unsigned long cycles)
     }
 }
 
+/*
+    Returns the number of cycles until either counter next overflows. Counter::Step stops at an
+    overflow, so stepping by up to this many cycles at once behaves exactly like stepping 4 at a time.
+*/
+unsigned long Timer::GetCyclesUntilNextEvent()
+{
+    return std::min(m_DividerCounter->GetCyclesUntilOverflow(), m_TimerCounter->GetCyclesUntilOverflow());
+}
+
 // IMemoryUnit
 byte Timer::ReadByte(const ushort& address)
 {
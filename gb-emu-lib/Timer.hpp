@@ -1,6 +1,6 @@
 #pragma once
 
-class Timer : public IMemoryUnit
+class Timer : public IMemoryUnit, public IScheduledUnit
 {
 private:
     class Counter
@@ -8,6 +8,7 @@ private:
     public:
         Counter(byte frequency);
         bool Step(unsigned int cycles);
+        unsigned long GetCyclesUntilOverflow();
 
         byte GetValue();
         void SetValue(byte value);
@@ -26,7 +27,9 @@ public:
     Timer(ICPU* pCPU);
     ~Timer();
 
+    // IScheduledUnit
     void Step(unsigned long cycles);
+    unsigned long GetCyclesUntilNextEvent();
 
     // IMemoryUnit
     byte ReadByte(const ushort& address);
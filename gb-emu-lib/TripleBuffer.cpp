@@ -0,0 +1,53 @@
+#include "pch.hpp"
+#include "TripleBuffer.hpp"
+
+#define NewFrameFlag 0x80
+#define BufferIndexMask 0x03
+
+TripleBuffer::TripleBuffer() :
+    m_ready(1),
+    m_back(0),
+    m_front(2)
+{
+    memset(m_buffers, 0x00, sizeof(m_buffers));
+}
+
+TripleBuffer::~TripleBuffer()
+{
+}
+
+byte* TripleBuffer::GetBackBuffer()
+{
+    return m_buffers[m_back];
+}
+
+/*
+    Makes the back buffer the latest frame, the producer continues in the buffer it replaces. The
+    release half of the exchange makes the frame's pixels visible to the consumer's Acquire.
+*/
+void TripleBuffer::Publish()
+{
+    byte ready = m_ready.exchange(m_back | NewFrameFlag, std::memory_order_acq_rel);
+    m_back = ready & BufferIndexMask;
+}
+
+/*
+    Takes the latest published frame, if there is a new one, returns true when the front buffer
+    changed. Frames published in between are dropped.
+*/
+bool TripleBuffer::Acquire()
+{
+    if ((m_ready.load(std::memory_order_relaxed) & NewFrameFlag) == 0)
+    {
+        return false;
+    }
+
+    byte ready = m_ready.exchange(m_front, std::memory_order_acq_rel);
+    m_front = ready & BufferIndexMask;
+    return true;
+}
+
+byte* TripleBuffer::GetFrontBuffer()
+{
+    return m_buffers[m_front];
+}
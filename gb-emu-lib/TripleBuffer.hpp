@@ -0,0 +1,34 @@
+#pragma once
+
+#include <atomic>
+
+#define FrameBufferSize (160 * 144 * 4)
+
+/*
+    TripleBuffer
+
+    Hands finished frames from the GPU to a consumer on another thread without locks or tearing.
+    The producer draws into the back buffer and publishes it by swapping it with the ready buffer.
+    The consumer swaps the ready buffer with its front buffer when a new frame was published. Each
+    side only ever touches its own buffer, the single atomic swap is the only thing they share.
+*/
+class TripleBuffer
+{
+public:
+    TripleBuffer();
+    ~TripleBuffer();
+
+    // Producer
+    byte* GetBackBuffer();
+    void Publish();
+
+    // Consumer
+    bool Acquire();
+    byte* GetFrontBuffer();
+
+private:
+    byte m_buffers[3][FrameBufferSize];
+    std::atomic<byte> m_ready;  // The index of the ready buffer, with NewFrameFlag until it is acquired
+    byte m_back;
+    byte m_front;
+};
@@ -15,6 +15,8 @@ typedef unsigned short ushort;
 
 #include "Logger.hpp"
 #include "IMemoryUnit.hpp"
+#include "IScheduledUnit.hpp"
+#include "IFrameSink.hpp"
 #include "ICPU.hpp"
 #include "IMMU.hpp"
 
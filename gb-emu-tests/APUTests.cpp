@@ -0,0 +1,411 @@
+#include "stdafx.h"
+
+#include <APU.hpp>
+#include <BlipBuffer.hpp>
+#include <SampleRing.hpp>
+#include <Scheduler.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+#include <thread>
+
+TEST_CLASS(APUTests)
+{
+private:
+    // An APU that counts how often it is stepped
+    class APUTestsCountingAPU : public APU
+    {
+    public:
+        APUTestsCountingAPU() : m_StepCount(0) {}
+
+        void Step(unsigned long cycles)
+        {
+            m_StepCount++;
+            APU::Step(cycles);
+        }
+
+        int m_StepCount;
+    };
+
+    // Plays channel 2 as a 50% square wave at 131072 / (2048 - frequency) Hz, at full volume on both outputs
+    static void PlaySquareWave(APU* pAPU, ushort frequency)
+    {
+        Assert::IsTrue(pAPU->WriteByte(SoundOnOff, 0x80));
+        Assert::IsTrue(pAPU->WriteByte(ChannelControl, 0x77));
+        Assert::IsTrue(pAPU->WriteByte(OutputTerminalSelection, 0xFF));
+        Assert::IsTrue(pAPU->WriteByte(Channel2LengthWavePatternDuty, 0x80));
+        Assert::IsTrue(pAPU->WriteByte(Channel2VolumeEnvelope, 0xF0));
+        Assert::IsTrue(pAPU->WriteByte(Channel2FrequnecyLo, static_cast<byte>(frequency)));
+        Assert::IsTrue(pAPU->WriteByte(Channel2FrequencyHi, 0x80 | static_cast<byte>(frequency >> 8)));
+    }
+
+public:
+    TEST_METHOD(BlipBufferStepTest)
+    {
+        BlipBuffer blip(APUClockRate, AudioSampleRate, AudioBufferSamples);
+
+        // 1/64 of a second, with a step up at the start
+        blip.AddDelta(0, 10000);
+        blip.EndFrame(APUClockRate / 64);
+        Assert::AreEqual(AudioSampleRate / 64, (int)blip.GetSamplesAvailable());
+
+        short samples[AudioSampleRate / 64];
+        Assert::AreEqual(AudioSampleRate / 64, (int)blip.ReadSamples(samples, AudioSampleRate / 64, 1));
+        Assert::AreEqual(0, (int)blip.GetSamplesAvailable());
+
+        // The step rises over the kernel's width, then slowly decays through the high-pass filter
+        Assert::AreEqual(0, (int)samples[0]);
+        Assert::IsTrue((samples[BlipKernelWidth] > 9500) && (samples[BlipKernelWidth] <= 10000));
+        Assert::IsTrue(samples[100] < samples[BlipKernelWidth]);
+        Assert::IsTrue(samples[100] > 7500);
+    }
+    TEST_METHOD(SampleRingTest)
+    {
+        std::unique_ptr<SampleRing> spRing = std::unique_ptr<SampleRing>(new SampleRing(100));
+
+        // Takes only what fits, and wraps around
+        short samples[300 * 2];
+        for (int index = 0; index < 300 * 2; index++)
+        {
+            samples[index] = static_cast<short>(index);
+        }
+
+        Assert::AreEqual(100, (int)spRing->GetFreeSpace());
+        Assert::AreEqual(70, (int)spRing->Write(samples, 70));
+        Assert::AreEqual(30, (int)spRing->Write(samples + (70 * 2), 70));
+        Assert::AreEqual(100, (int)spRing->GetFillLevel());
+
+        short read[300 * 2];
+        Assert::AreEqual(60, (int)spRing->Read(read, 60));
+        Assert::AreEqual(50, (int)spRing->Write(samples + (100 * 2), 50));
+        Assert::AreEqual(90, (int)spRing->GetFillLevel());
+        Assert::AreEqual(0, (int)spRing->GetUnderrunCount());
+
+        // Running dry pads with silence and counts an underrun
+        Assert::AreEqual(90, (int)spRing->Read(read + (60 * 2), 100));
+        Assert::AreEqual(1, (int)spRing->GetUnderrunCount());
+        Assert::AreEqual(0, (int)spRing->GetFillLevel());
+        Assert::IsTrue(memcmp(read, samples, 150 * 2 * sizeof(short)) == 0);
+        for (int index = 150 * 2; index < 160 * 2; index++)
+        {
+            Assert::AreEqual(0, (int)read[index]);
+        }
+
+        // A consumer thread gets every sample, in order
+        spRing = std::unique_ptr<SampleRing>(new SampleRing(64));
+        const int sampleTotal = 200000;
+        bool isOutOfOrder = false;
+        std::thread consumer([&spRing, &isOutOfOrder]()
+        {
+            int nextSample = 0;
+            short chunk[48 * 2];
+            while (nextSample < sampleTotal)
+            {
+                unsigned int count = spRing->Read(chunk, 48);
+                for (unsigned int index = 0; index < count; index++)
+                {
+                    isOutOfOrder |= (chunk[index * 2] != static_cast<short>(nextSample));
+                    isOutOfOrder |= (chunk[(index * 2) + 1] != static_cast<short>(~nextSample));
+                    nextSample++;
+                }
+            }
+        });
+
+        short chunk[37 * 2];
+        for (int nextSample = 0; nextSample < sampleTotal;)
+        {
+            int count = std::min(37, sampleTotal - nextSample);
+            for (int index = 0; index < count; index++)
+            {
+                chunk[index * 2] = static_cast<short>(nextSample + index);
+                chunk[(index * 2) + 1] = static_cast<short>(~(nextSample + index));
+            }
+
+            nextSample += spRing->Write(chunk, count);
+        }
+
+        consumer.join();
+        Assert::IsFalse(isOutOfOrder);
+
+        // The samples stay in order, and the ring keeps its capacity, as the indexes wrap around
+        spRing = std::unique_ptr<SampleRing>(new SampleRing(AudioBufferSamples));
+        spRing->m_writeIndex = 0xFFFFFFFF - 5000;
+        spRing->m_readIndex = 0xFFFFFFFF - 5000;
+
+        std::unique_ptr<short[]> spChunk = std::unique_ptr<short[]>(new short[AudioBufferSamples * 2]);
+        std::unique_ptr<short[]> spRead = std::unique_ptr<short[]>(new short[AudioBufferSamples * 2]);
+        int nextRead = 0;
+        int nextWrite = 0;
+        for (int round = 0; round < 8; round++)
+        {
+            unsigned int count = spRing->GetFreeSpace();
+            for (unsigned int index = 0; index < count; index++)
+            {
+                spChunk[index * 2] = static_cast<short>(nextWrite + index);
+                spChunk[(index * 2) + 1] = static_cast<short>(~(nextWrite + index));
+            }
+
+            Assert::AreEqual((round == 0) ? AudioBufferSamples : 1000, (int)count);
+            Assert::AreEqual((int)count, (int)spRing->Write(spChunk.get(), count));
+            Assert::AreEqual(AudioBufferSamples, (int)spRing->GetFillLevel());
+            nextWrite += count;
+
+            Assert::AreEqual(1000, (int)spRing->Read(spRead.get(), 1000));
+            for (int index = 0; index < 1000; index++)
+            {
+                isOutOfOrder |= (spRead[index * 2] != static_cast<short>(nextRead + index));
+                isOutOfOrder |= (spRead[(index * 2) + 1] != static_cast<short>(~(nextRead + index)));
+            }
+
+            nextRead += 1000;
+        }
+
+        Assert::IsFalse(isOutOfOrder);
+        Assert::AreEqual(0, (int)spRing->GetUnderrunCount());
+
+        spRing.reset();
+    }
+    TEST_METHOD(APUSquareWaveTest)
+    {
+        std::unique_ptr<APU> spAPU = std::unique_ptr<APU>(new APU());
+        PlaySquareWave(spAPU.get(), 1917);
+        Assert::AreEqual(0x82, (int)spAPU->ReadByte(SoundOnOff));
+
+        // One second, read a frame at a time
+        std::unique_ptr<short[]> spSamples = std::unique_ptr<short[]>(new short[AudioSampleRate * 2]);
+        unsigned int sampleCount = 0;
+        for (int frame = 0; frame < 60; frame++)
+        {
+            spAPU->Step(APUClockRate / 60);
+            sampleCount += spAPU->ReadSamples(spSamples.get() + (sampleCount * 2), AudioSampleRate - sampleCount);
+        }
+        spAPU->Step(APUClockRate % 60);
+        sampleCount += spAPU->ReadSamples(spSamples.get() + (sampleCount * 2), AudioSampleRate - sampleCount);
+        Assert::AreEqual(AudioSampleRate, (int)sampleCount);
+
+        // 1000.5Hz has as many rising edges a second, each reaching close to 15 volume units. An edge
+        // must come from well below 0, so the ringing around a crossing isn't counted twice.
+        int risingEdges = 0;
+        bool isLow = false;
+        short peak = 0;
+        for (unsigned int sample = 0; sample < sampleCount; sample++)
+        {
+            // Both outputs play the same
+            short left = spSamples[sample * 2];
+            Assert::AreEqual((int)left, (int)spSamples[(sample * 2) + 1]);
+
+            if (left < -ChannelVolumeUnit)
+            {
+                isLow = true;
+            }
+            else if (isLow && (left > ChannelVolumeUnit))
+            {
+                isLow = false;
+                risingEdges++;
+            }
+
+            peak = std::max(peak, left);
+        }
+
+        Assert::IsTrue((risingEdges >= 999) && (risingEdges <= 1002));
+        Assert::IsTrue(peak > (15 * ChannelVolumeUnit) / 3);
+
+        spAPU.reset();
+    }
+    TEST_METHOD(APUMixerTest)
+    {
+        std::unique_ptr<APU> spAPU = std::unique_ptr<APU>(new APU());
+        PlaySquareWave(spAPU.get(), 1917);
+
+        // Channel 2 only on the left, at half the master volume
+        Assert::IsTrue(spAPU->WriteByte(OutputTerminalSelection, 0x20));
+        Assert::IsTrue(spAPU->WriteByte(ChannelControl, 0x37));
+        spAPU->Step(APUClockRate / 8);
+
+        // More than the buffer keeps, the oldest are dropped
+        short samples[AudioBufferSamples * 2];
+        unsigned int count = spAPU->ReadSamples(samples, AudioBufferSamples);
+        Assert::AreEqual(AudioBufferSamples, (int)count);
+
+        short leftPeak = 0;
+        short rightPeak = 0;
+        for (unsigned int sample = count / 2; sample < count; sample++)
+        {
+            leftPeak = std::max(leftPeak, samples[sample * 2]);
+            rightPeak = std::max(rightPeak, static_cast<short>(std::abs(samples[(sample * 2) + 1])));
+        }
+
+        Assert::IsTrue(leftPeak > (15 * ChannelVolumeUnit) / 6);
+        Assert::IsTrue(leftPeak < (15 * ChannelVolumeUnit) / 2);
+        Assert::AreEqual(0, (int)rightPeak);
+
+        spAPU.reset();
+    }
+    TEST_METHOD(APURateAdjustmentTest)
+    {
+        std::unique_ptr<APU> spAPU = std::unique_ptr<APU>(new APU());
+        PlaySquareWave(spAPU.get(), 1917);
+
+        // 1/16 of a second makes 1/16 of the adjusted rate's samples
+        short samples[AudioBufferSamples * 2];
+        Assert::IsTrue(spAPU->SetSampleRateAdjustment(AudioMaxRateAdjustment));
+        spAPU->Step(APUClockRate / 16);
+        Assert::AreEqual((AudioSampleRate + AudioMaxRateAdjustment) / 16, (int)spAPU->ReadSamples(samples, AudioBufferSamples));
+
+        Assert::IsTrue(spAPU->SetSampleRateAdjustment(-AudioMaxRateAdjustment));
+        spAPU->Step(APUClockRate / 16);
+        Assert::AreEqual((AudioSampleRate - AudioMaxRateAdjustment) / 16, (int)spAPU->ReadSamples(samples, AudioBufferSamples));
+
+        // Beyond the limit the rate stays as it was
+        Assert::IsFalse(spAPU->SetSampleRateAdjustment(AudioMaxRateAdjustment + 1));
+        spAPU->Step(APUClockRate / 16);
+        Assert::AreEqual((AudioSampleRate - AudioMaxRateAdjustment) / 16, (int)spAPU->ReadSamples(samples, AudioBufferSamples));
+
+        spAPU.reset();
+    }
+    TEST_METHOD(APUCatchUpTest)
+    {
+        std::unique_ptr<APU> spAPU = std::unique_ptr<APU>(new APU());
+        std::unique_ptr<APUTestsCountingAPU> spLazyAPU = std::unique_ptr<APUTestsCountingAPU>(new APUTestsCountingAPU());
+        PlaySquareWave(spAPU.get(), 1800);
+        PlaySquareWave(spLazyAPU.get(), 1800);
+
+        // The lazy APU is only stepped by the scheduler, like the CPU does
+        std::unique_ptr<Scheduler> spScheduler = std::unique_ptr<Scheduler>(new Scheduler());
+        spScheduler->AddUnit(spLazyAPU.get(), 0xFF10, 0xFF3F, true);
+        spScheduler->Start(0);
+
+        struct RegisterWrite
+        {
+            unsigned long cycles;
+            ushort address;
+            byte val;
+        };
+
+        const RegisterWrite writes[]
+        {
+            { 1000, Channel1VolumeEnvelope, 0xF3 },
+            { 1500, Channel1Sweep, 0x12 },
+            { 2000, Channel1FrequencyHi, 0x86 },
+            { 30000, OutputTerminalSelection, 0x5A },
+            { 41000, Channel3OnOff, 0x80 },
+            { 41004, Channel3OutputLevel, 0x40 },
+            { 41008, Channel3FrequnecyHigher, 0x85 },
+            { 70000, Channel4VolumeEnvelope, 0xA2 },
+            { 70004, Channel4PolynomialCounter, 0x31 },
+            { 70008, Channel4Counter, 0xC0 },
+            { 150000, ChannelControl, 0x25 },
+            { 200000, Channel2VolumeEnvelope, 0x00 },
+        };
+
+        // The eager APU is stepped after every instruction, 4 to 24 cycles
+        const unsigned long long totalCycles = 4 * 70224;
+        unsigned long long cycles = 0;
+        unsigned int nextWrite = 0;
+        for (int instruction = 0; cycles < totalCycles; instruction++)
+        {
+            if ((nextWrite < ARRAYSIZE(writes)) && (writes[nextWrite].cycles <= cycles))
+            {
+                Assert::IsTrue(spAPU->WriteByte(writes[nextWrite].address, writes[nextWrite].val));
+
+                spScheduler->Synchronize(writes[nextWrite].address, cycles);
+                Assert::IsTrue(spLazyAPU->WriteByte(writes[nextWrite].address, writes[nextWrite].val));
+                spScheduler->Reschedule(writes[nextWrite].address);
+                nextWrite++;
+            }
+
+            unsigned long run = 4 + ((instruction % 6) * 4);
+            spAPU->Step(run);
+            cycles += run;
+
+            if (cycles >= spScheduler->GetNextEvent())
+            {
+                spScheduler->RunEvents(cycles);
+            }
+        }
+
+        // Then the samples are asked for
+        spScheduler->Synchronize(SoundOnOff, cycles);
+        Assert::IsTrue(nextWrite == ARRAYSIZE(writes));
+        Assert::AreEqual((int)ARRAYSIZE(writes) + 1, spLazyAPU->m_StepCount);
+
+        short samples[AudioBufferSamples * 2];
+        short lazySamples[AudioBufferSamples * 2];
+        unsigned int count = spAPU->ReadSamples(samples, AudioBufferSamples);
+        Assert::AreEqual((int)count, (int)spLazyAPU->ReadSamples(lazySamples, AudioBufferSamples));
+        Assert::IsTrue(count > 3000);
+        Assert::IsTrue(memcmp(samples, lazySamples, count * 2 * sizeof(short)) == 0);
+
+        spScheduler.reset();
+        spLazyAPU.reset();
+        spAPU.reset();
+    }
+    TEST_METHOD(APULengthTest)
+    {
+        std::unique_ptr<APU> spAPU = std::unique_ptr<APU>(new APU());
+        PlaySquareWave(spAPU.get(), 1917);
+
+        // A length of 1 with the length enabled stops the channel at the next length clock
+        Assert::IsTrue(spAPU->WriteByte(Channel2LengthWavePatternDuty, 0xBF));
+        Assert::IsTrue(spAPU->WriteByte(Channel2FrequencyHi, 0xC7));
+        Assert::AreEqual(0x82, (int)spAPU->ReadByte(SoundOnOff));
+        spAPU->Step(FrameSequencerCycles);
+        Assert::AreEqual(0x80, (int)spAPU->ReadByte(SoundOnOff));
+
+        // Turning the sound off clears the registers, and they ignore writes until it is back on
+        PlaySquareWave(spAPU.get(), 1917);
+        Assert::IsTrue(spAPU->WriteByte(SoundOnOff, 0x00));
+        Assert::AreEqual(0x00, (int)spAPU->ReadByte(SoundOnOff));
+        Assert::AreEqual(0x00, (int)spAPU->ReadByte(Channel2VolumeEnvelope));
+        Assert::IsTrue(spAPU->WriteByte(Channel2VolumeEnvelope, 0xF0));
+        Assert::AreEqual(0x00, (int)spAPU->ReadByte(Channel2VolumeEnvelope));
+
+        spAPU.reset();
+    }
+    TEST_METHOD(APUStepSplitTest)
+    {
+        std::unique_ptr<APU> spAPU = std::unique_ptr<APU>(new APU());
+        std::unique_ptr<APU> spSplitAPU = std::unique_ptr<APU>(new APU());
+
+        // Every channel playing, with channel 1 sweeping and channel 2's envelope fading
+        APU* apus[] { spAPU.get(), spSplitAPU.get() };
+        for (APU* pAPU : apus)
+        {
+            PlaySquareWave(pAPU, 1800);
+            Assert::IsTrue(pAPU->WriteByte(Channel2VolumeEnvelope, 0xF1));
+            Assert::IsTrue(pAPU->WriteByte(Channel2FrequencyHi, 0x87));
+            Assert::IsTrue(pAPU->WriteByte(Channel1Sweep, 0x21));
+            Assert::IsTrue(pAPU->WriteByte(Channel1VolumeEnvelope, 0xA0));
+            Assert::IsTrue(pAPU->WriteByte(Channel1FrequencyLo, 0x00));
+            Assert::IsTrue(pAPU->WriteByte(Channel1FrequencyHi, 0x86));
+            for (ushort address = 0xFF30; address <= 0xFF3F; address++)
+            {
+                Assert::IsTrue(pAPU->WriteByte(address, static_cast<byte>(address * 0x37)));
+            }
+            Assert::IsTrue(pAPU->WriteByte(Channel3OnOff, 0x80));
+            Assert::IsTrue(pAPU->WriteByte(Channel3OutputLevel, 0x20));
+            Assert::IsTrue(pAPU->WriteByte(Channel3FrequencyLower, 0x40));
+            Assert::IsTrue(pAPU->WriteByte(Channel3FrequnecyHigher, 0x87));
+            Assert::IsTrue(pAPU->WriteByte(Channel4VolumeEnvelope, 0x80));
+            Assert::IsTrue(pAPU->WriteByte(Channel4PolynomialCounter, 0x2A));
+            Assert::IsTrue(pAPU->WriteByte(Channel4Counter, 0x80));
+        }
+
+        // The same cycles, at once and in uneven steps
+        spAPU->Step(4 * 70224);
+        for (unsigned long cycles = 0, step = 4; cycles < 4 * 70224; cycles += step, step = (step * 7) % 3001 + 4)
+        {
+            spSplitAPU->Step(std::min(step, (4 * 70224) - cycles));
+        }
+
+        short samples[AudioBufferSamples * 2];
+        short splitSamples[AudioBufferSamples * 2];
+        unsigned int count = spAPU->ReadSamples(samples, AudioBufferSamples);
+        Assert::AreEqual((int)count, (int)spSplitAPU->ReadSamples(splitSamples, AudioBufferSamples));
+        Assert::IsTrue(count > 3000);
+        Assert::IsTrue(memcmp(samples, splitSamples, count * 2 * sizeof(short)) == 0);
+
+        spSplitAPU.reset();
+        spAPU.reset();
+    }
+};
@@ -2,6 +2,9 @@
 
 #include <GPU.hpp>
 
+#include <climits>
+#include <thread>
+
 TEST_CLASS(GPUTests)
 {
 private:
@@ -33,6 +36,11 @@ private:
             // Ignore registration, we got this.
         }
 
+        void MapMemory(const ushort& startRange, const ushort& endRange, byte* pMemory, bool isWritable)
+        {
+            // Ignore mapping, everything lives in m_data.
+        }
+
         unsigned short ReadUShort(const ushort& address)
         {
             ushort val = Read(address + 1);
@@ -41,6 +49,12 @@ private:
             return val;
         }
 
+        bool WriteUShort(const ushort& address, const ushort val)
+        {
+            Write(address + 1, static_cast<byte>(val >> 8));
+            return Write(address, static_cast<byte>(val));
+        }
+
         bool LoadBootROM(const char* bootROMPath)
         {
             return true;
@@ -61,6 +75,46 @@ private:
         byte m_data[0xFFFF + 1];
     };
 
+    // This is a test frame sink with lines wider than the screen
+    class GPUTestsFrameSink : public IFrameSink
+    {
+    public:
+        GPUTestsFrameSink() :
+            m_beginCount(0),
+            m_endCount(0)
+        {
+            memset(m_pixels, 0x5A, ARRAYSIZE(m_pixels));
+        }
+
+        byte* BeginFrame(int* pPitch)
+        {
+            m_beginCount++;
+            *pPitch = Pitch;
+            return m_pixels;
+        }
+
+        void EndFrame()
+        {
+            m_endCount++;
+        }
+
+        static const int Pitch = 200 * 4;
+        byte m_pixels[144 * Pitch];
+        int m_beginCount;
+        int m_endCount;
+    };
+
+    static int& VSyncCount()
+    {
+        static int count = 0;
+        return count;
+    }
+
+    static void CountVSync()
+    {
+        VSyncCount()++;
+    }
+
 public:
     TEST_METHOD(GPUCycleTest)
     {
@@ -122,6 +176,415 @@ public:
         Assert::AreEqual(ModeReadingOAM, (int)(spGPU->ReadByte(LCDControllerStatus) & 0x03));
         Assert::AreEqual(0, (int)spGPU->m_LCDControllerYCoordinate);
 
+        spGPU.reset();
+        spMMU.reset();
+    }
+    TEST_METHOD(GPUNextEventTest)
+    {
+        std::unique_ptr<GPUTestsMMU> spMMU = std::unique_ptr<GPUTestsMMU>(new GPUTestsMMU(nullptr, 0));
+        std::unique_ptr<GPU> spGPU = std::unique_ptr<GPU>(new GPU(spMMU.get(), nullptr));
+
+        // LCD is off, there are no events
+        Assert::IsTrue(spGPU->GetCyclesUntilNextEvent() == ULONG_MAX);
+
+        // Enable LCD
+        Assert::IsTrue(spGPU->WriteByte(LCDControl, 0x80));
+        spGPU->Step(4);
+        Assert::AreEqual(ReadingOAMCycles - 4, (int)spGPU->GetCyclesUntilNextEvent());
+
+        // Stepping straight to each event matches the mode changes of GPUCycleTest
+        spGPU->Step(spGPU->GetCyclesUntilNextEvent());
+        Assert::AreEqual(ModeReadingOAMVRAM, (int)(spGPU->ReadByte(LCDControllerStatus) & 0x03));
+        Assert::AreEqual(ReadingOAMVRAMCycles, (int)spGPU->GetCyclesUntilNextEvent());
+
+        spGPU->Step(spGPU->GetCyclesUntilNextEvent());
+        Assert::AreEqual(ModeHBlank, (int)(spGPU->ReadByte(LCDControllerStatus) & 0x03));
+        Assert::AreEqual(HBlankCycles, (int)spGPU->GetCyclesUntilNextEvent());
+
+        spGPU->Step(spGPU->GetCyclesUntilNextEvent());
+        Assert::AreEqual(ModeReadingOAM, (int)(spGPU->ReadByte(LCDControllerStatus) & 0x03));
+        Assert::AreEqual(1, (int)spGPU->m_LCDControllerYCoordinate);
+
+        // The LYC=LY interrupt is raised on every step, so there is no time to skip
+        Assert::IsTrue(spGPU->WriteByte(LYCompare, 0x01));
+        Assert::IsTrue(spGPU->WriteByte(LCDControllerStatus, 0x40));
+        Assert::AreEqual(0, (int)spGPU->GetCyclesUntilNextEvent());
+
+        spGPU.reset();
+        spMMU.reset();
+    }
+    TEST_METHOD(GPUTileCacheTest)
+    {
+        std::unique_ptr<GPUTestsMMU> spMMU = std::unique_ptr<GPUTestsMMU>(new GPUTestsMMU(nullptr, 0));
+        std::unique_ptr<GPU> spGPU = std::unique_ptr<GPU>(new GPU(spMMU.get(), nullptr));
+
+        // Line 3 of tile 1: low bits 0b10100101, high bits 0b11000011
+        Assert::IsTrue(spGPU->WriteByte(0x8016, 0xA5));
+        Assert::IsTrue(spGPU->WriteByte(0x8017, 0xC3));
+
+        const byte expected[] { 0x03, 0x02, 0x01, 0x00, 0x00, 0x01, 0x02, 0x03 };
+        for (int x = 0; x < 8; x++)
+        {
+            Assert::AreEqual((int)expected[x], (int)spGPU->m_TileCache[(1 * 64) + (3 * 8) + x]);
+        }
+
+        // 0x8800 tile data is addressed with signed tile numbers from 0x9000
+        Assert::IsTrue(spGPU->WriteByte(0x97F0, 0x80));
+        Assert::IsTrue(spGPU->WriteByte(LCDControl, 0x00));
+        Assert::AreEqual(0x01, (int)spGPU->GetBGTileRow(0x7F, 0)[0]);
+        Assert::IsTrue(spGPU->WriteByte(LCDControl, 0x10));
+        Assert::AreEqual(0x00, (int)spGPU->GetBGTileRow(0x7F, 0)[0]);
+
+        // Writes to the tile maps leave the cache alone
+        Assert::IsTrue(spGPU->WriteByte(0x9800, 0xFF));
+        Assert::AreEqual(0x00, (int)spGPU->m_TileCache[TileCount * 64 - 1]);
+
+        spGPU.reset();
+        spMMU.reset();
+    }
+    TEST_METHOD(GPUOAMSearchTest)
+    {
+        std::unique_ptr<GPUTestsMMU> spMMU = std::unique_ptr<GPUTestsMMU>(new GPUTestsMMU(nullptr, 0));
+        std::unique_ptr<GPU> spGPU = std::unique_ptr<GPU>(new GPU(spMMU.get(), nullptr));
+
+        // 12 sprites on line 0, at X = 100, 99, 98, ... except sprite 5 which shares sprite 2's X
+        for (int obj = 0; obj < 12; obj++)
+        {
+            Assert::IsTrue(spGPU->WriteByte(0xFE00 + (obj * 4), 16));
+            Assert::IsTrue(spGPU->WriteByte(0xFE01 + (obj * 4), (obj == 5) ? 98 : 100 - obj));
+        }
+
+        // One more, below line 0, through DMA
+        for (int offset = 0; offset < (12 * 4); offset++)
+        {
+            spMMU->Write(0xC000 + offset, spGPU->m_OAM[offset]);
+        }
+        spMMU->Write(0xC000 + (12 * 4), 17);
+        Assert::IsTrue(spGPU->WriteByte(DMATransferAndStartAddress, 0xC0));
+        Assert::AreEqual(1, spGPU->m_OBJTop[12]);
+        Assert::AreEqual(92, spGPU->m_OBJLeft[0]);
+
+        // Enable LCD and finish the OAM search of line 0
+        Assert::IsTrue(spGPU->WriteByte(LCDControl, 0x80));
+        spGPU->Step(4);
+        Assert::AreEqual(ModeReadingOAM, (int)(spGPU->ReadByte(LCDControllerStatus) & 0x03));
+        spGPU->Step(ReadingOAMCycles - 4);
+        Assert::AreEqual(ModeReadingOAMVRAM, (int)(spGPU->ReadByte(LCDControllerStatus) & 0x03));
+
+        // Only the first 10 sprites count, drawn from the largest X to the smallest with the lower
+        // OAM index of equal X drawn last
+        const byte expected[] { 0, 1, 5, 2, 3, 4, 6, 7, 8, 9 };
+        Assert::AreEqual((int)ARRAYSIZE(expected), (int)spGPU->m_LineOBJCount);
+        for (unsigned int i = 0; i < ARRAYSIZE(expected); i++)
+        {
+            Assert::AreEqual((int)expected[i], (int)spGPU->m_LineOBJs[i]);
+        }
+
+        spGPU.reset();
+        spMMU.reset();
+    }
+    TEST_METHOD(GPUFrameSkipTest)
+    {
+        std::unique_ptr<GPUTestsMMU> spMMU = std::unique_ptr<GPUTestsMMU>(new GPUTestsMMU(nullptr, 0));
+        std::unique_ptr<GPU> spGPU = std::unique_ptr<GPU>(new GPU(spMMU.get(), nullptr));
+        std::unique_ptr<GPU> spSkippingGPU = std::unique_ptr<GPU>(new GPU(spMMU.get(), nullptr));
+
+        VSyncCount() = 0;
+        spSkippingGPU->SetVSyncCallback(&CountVSync);
+        spSkippingGPU->SetFrameSkip(2);
+
+        Assert::IsTrue(spGPU->WriteByte(LCDControl, 0x80));
+        Assert::IsTrue(spSkippingGPU->WriteByte(LCDControl, 0x80));
+        Assert::IsTrue(spGPU->WriteByte(LCDControllerStatus, 0x78));
+        Assert::IsTrue(spSkippingGPU->WriteByte(LCDControllerStatus, 0x78));
+
+        // 6 frames, only the 1st and 4th are drawn but the modes keep the same timing
+        for (int cycles = 0; cycles < 6 * 70224; cycles += 4)
+        {
+            spGPU->Step(4);
+            spSkippingGPU->Step(4);
+            Assert::AreEqual((int)spGPU->m_LCDControllerStatus, (int)spSkippingGPU->m_LCDControllerStatus);
+            Assert::AreEqual((int)spGPU->m_LCDControllerYCoordinate, (int)spSkippingGPU->m_LCDControllerYCoordinate);
+        }
+
+        Assert::AreEqual(6, (int)spSkippingGPU->GetFrameCount());
+        Assert::AreEqual(2, VSyncCount());
+
+        // The 7th frame has started and is drawn, then the next frame is drawn after the setting changes
+        spSkippingGPU->SetFrameSkip(FrameSkipUntilRequested);
+        for (int cycles = 0; cycles < 4 * 70224; cycles += 4)
+        {
+            spSkippingGPU->Step(4);
+        }
+
+        Assert::AreEqual(4, VSyncCount());
+
+        // After that, only the frame after a request is drawn
+        spSkippingGPU->RequestFrame();
+        for (int cycles = 0; cycles < 2 * 70224; cycles += 4)
+        {
+            spSkippingGPU->Step(4);
+        }
+
+        Assert::AreEqual(5, VSyncCount());
+
+        spSkippingGPU.reset();
+        spGPU.reset();
+        spMMU.reset();
+    }
+    TEST_METHOD(GPUFrameSinkTest)
+    {
+        std::unique_ptr<GPUTestsMMU> spMMU = std::unique_ptr<GPUTestsMMU>(new GPUTestsMMU(nullptr, 0));
+        std::unique_ptr<GPU> spGPU = std::unique_ptr<GPU>(new GPU(spMMU.get(), nullptr));
+        std::unique_ptr<GPUTestsFrameSink> spSink = std::unique_ptr<GPUTestsFrameSink>(new GPUTestsFrameSink());
+
+        // The BG is disabled, so every line is drawn white
+        spGPU->SetFrameSink(spSink.get());
+        Assert::IsTrue(spGPU->WriteByte(LCDControl, 0x80));
+        for (int cycles = 0; (cycles < 70224) && (spGPU->m_LCDControllerYCoordinate != 144); cycles += 4)
+        {
+            spGPU->Step(4);
+        }
+
+        Assert::AreEqual(1, spSink->m_beginCount);
+        Assert::AreEqual(1, spSink->m_endCount);
+        Assert::IsTrue(spGPU->m_DisplayPixels == nullptr);
+
+        // The lines are Pitch bytes apart, the rest of each line is left alone
+        const byte white = spSink->m_pixels[3];
+        Assert::AreEqual(0xFF, (int)spSink->m_pixels[0]);
+        Assert::AreEqual((int)white, (int)spSink->m_pixels[(143 * GPUTestsFrameSink::Pitch) + (159 * 4) + 3]);
+        Assert::AreEqual(0xFF, (int)spSink->m_pixels[(143 * GPUTestsFrameSink::Pitch) + (159 * 4)]);
+        Assert::AreEqual(0x5A, (int)spSink->m_pixels[(143 * GPUTestsFrameSink::Pitch) + (160 * 4)]);
+        Assert::AreEqual(0x5A, (int)spSink->m_pixels[(1 * GPUTestsFrameSink::Pitch) - 1]);
+
+        // Without the sink, frames go back to the GPU's own buffers
+        spGPU->SetFrameSink(nullptr);
+        for (int cycles = 0; cycles < 70224; cycles += 4)
+        {
+            spGPU->Step(4);
+        }
+
+        Assert::AreEqual(1, spSink->m_beginCount);
+        Assert::AreEqual((int)white, (int)spGPU->GetCurrentFrame()[(143 * 160 * 4) + (159 * 4) + 3]);
+
+        spSink.reset();
+        spGPU.reset();
+        spMMU.reset();
+    }
+    TEST_METHOD(TripleBufferTest)
+    {
+        std::unique_ptr<TripleBuffer> spFrames = std::unique_ptr<TripleBuffer>(new TripleBuffer());
+
+        // Nothing published yet
+        Assert::IsFalse(spFrames->Acquire());
+
+        // Only the latest of the published frames is acquired
+        for (byte frame = 1; frame <= 3; frame++)
+        {
+            memset(spFrames->GetBackBuffer(), frame, FrameBufferSize);
+            spFrames->Publish();
+            Assert::IsTrue(spFrames->GetBackBuffer() != spFrames->GetFrontBuffer());
+        }
+
+        Assert::IsTrue(spFrames->Acquire());
+        Assert::AreEqual(3, (int)spFrames->GetFrontBuffer()[0]);
+        Assert::IsFalse(spFrames->Acquire());
+
+        // A consumer thread only ever sees complete frames, in order
+        const int frameCount = 2000;
+        bool isTorn = false;
+        bool isOutOfOrder = false;
+        std::thread consumer([&spFrames, &isTorn, &isOutOfOrder]()
+        {
+            int lastFrame = 0;
+            while (lastFrame < frameCount)
+            {
+                if (!spFrames->Acquire())
+                {
+                    continue;
+                }
+
+                const byte* pFrame = spFrames->GetFrontBuffer();
+                int frame = pFrame[0] | (pFrame[1] << 8);
+                for (int i = 2; i < FrameBufferSize; i++)
+                {
+                    isTorn |= (pFrame[i] != (byte)frame);
+                }
+
+                isOutOfOrder |= (frame <= lastFrame);
+                lastFrame = frame;
+            }
+        });
+
+        for (int frame = 1; frame <= frameCount; frame++)
+        {
+            byte* pFrame = spFrames->GetBackBuffer();
+            memset(pFrame, (byte)frame, FrameBufferSize);
+            pFrame[0] = (byte)frame;
+            pFrame[1] = (byte)(frame >> 8);
+            spFrames->Publish();
+        }
+
+        consumer.join();
+        Assert::IsFalse(isTorn);
+        Assert::IsFalse(isOutOfOrder);
+    }
+    TEST_METHOD(CompositorKernelsTest)
+    {
+        // Every kernel this CPU supports must match the scalar one, including the odd sized tails
+        byte indexes[37];
+        byte bgPixels[37 * 4];
+        unsigned int isDrawn[37];
+        const byte colors[] { 0xEB, 0xC4, 0x60 };
+        memset(bgPixels, 0x11, sizeof(bgPixels));
+        for (unsigned int i = 0; i < ARRAYSIZE(indexes); i++)
+        {
+            indexes[i] = (byte)((i * 7 + i / 3) & 0x03);
+            bgPixels[(i * 4) + 3] = colors[i % 3];
+            isDrawn[i] = (i % 5 == 0) ? 0xFFFFFFFF : 0x00000000;
+        }
+        const unsigned int palette[] { 0x00000000, Compositor::MakePixel(0xC4, 0xC4, 0xC4), Compositor::MakePixel(0x60, 0x61, 0x62), 0x000000FF };
+        const unsigned int bgColor0 = Compositor::MakePixel(colors[1], colors[1], colors[1]);
+
+        Compositor scalar;
+        Assert::IsTrue(scalar.SetKernel(KernelScalar));
+
+        byte expectedRow[8];
+        byte expectedPixels[37 * 4];
+        byte expectedOverlay[37 * 4];
+        unsigned int expectedIsDrawn[37];
+        scalar.ExpandTileRow(0xA5, 0xC3, expectedRow);
+        scalar.WritePixels(indexes, palette, ARRAYSIZE(indexes), expectedPixels);
+        memcpy(expectedOverlay, bgPixels, sizeof(expectedOverlay));
+        memcpy(expectedIsDrawn, isDrawn, sizeof(expectedIsDrawn));
+        scalar.OverlayPixels(indexes, palette, true, bgColor0, ARRAYSIZE(indexes), expectedOverlay, expectedIsDrawn);
+
+        Assert::AreEqual(0x01, (int)expectedRow[2]);
+        Assert::AreEqual(0xC4, (int)expectedPixels[(4 * 4) + 3]);
+        Assert::AreEqual(0xFF, (int)expectedPixels[(4 * 4) + 0]);
+
+        // Pixel 7 is over BG color 0 so it is drawn, pixel 3 is not, and pixel 25 was already drawn
+        Assert::AreEqual(0x00, (int)expectedOverlay[(7 * 4) + 3]);
+        Assert::IsTrue(expectedIsDrawn[7] != 0);
+        Assert::AreEqual((int)colors[0], (int)expectedOverlay[(3 * 4) + 3]);
+        Assert::IsTrue(expectedIsDrawn[3] == 0);
+        Assert::AreEqual((int)colors[1], (int)expectedOverlay[(25 * 4) + 3]);
+
+        for (int kernel = KernelSSE2; kernel <= Compositor::GetBestKernel(); kernel++)
+        {
+            Compositor compositor;
+            Assert::IsTrue(compositor.SetKernel(kernel));
+
+            byte row[8];
+            compositor.ExpandTileRow(0xA5, 0xC3, row);
+            Assert::IsTrue(memcmp(expectedRow, row, sizeof(row)) == 0);
+
+            for (unsigned int count = 0; count <= ARRAYSIZE(indexes); count++)
+            {
+                byte pixels[37 * 4];
+                byte overlay[37 * 4];
+                unsigned int overlayIsDrawn[37];
+                memcpy(pixels, expectedOverlay, sizeof(pixels));
+                memcpy(overlay, bgPixels, sizeof(overlay));
+                memcpy(overlayIsDrawn, isDrawn, sizeof(overlayIsDrawn));
+
+                compositor.WritePixels(indexes, palette, count, pixels);
+                compositor.OverlayPixels(indexes, palette, true, bgColor0, count, overlay, overlayIsDrawn);
+                Assert::IsTrue(memcmp(expectedPixels, pixels, count * 4) == 0);
+                Assert::IsTrue(memcmp(expectedOverlay, overlay, count * 4) == 0);
+                Assert::IsTrue(memcmp(expectedIsDrawn, overlayIsDrawn, count * sizeof(unsigned int)) == 0);
+                Assert::IsTrue(memcmp(expectedOverlay + (count * 4), pixels + (count * 4), sizeof(pixels) - (count * 4)) == 0);
+                Assert::IsTrue(memcmp(bgPixels + (count * 4), overlay + (count * 4), sizeof(overlay) - (count * 4)) == 0);
+                Assert::IsTrue(memcmp(isDrawn + count, overlayIsDrawn + count, (ARRAYSIZE(isDrawn) - count) * sizeof(unsigned int)) == 0);
+            }
+
+            // The narrow pixel formats
+            for (int pixelFormat = PixelFormatRGB565; pixelFormat <= PixelFormatIndexed; pixelFormat++)
+            {
+                Compositor narrowScalar;
+                Assert::IsTrue(narrowScalar.SetKernel(KernelScalar));
+                Assert::IsTrue(narrowScalar.SetPixelFormat(pixelFormat));
+                Assert::IsTrue(compositor.SetPixelFormat(pixelFormat));
+                unsigned int pixelSize = compositor.GetPixelSize();
+
+                byte expectedNarrow[37 * 2];
+                narrowScalar.WritePixels(indexes, palette, ARRAYSIZE(indexes), expectedNarrow);
+                for (unsigned int count = 0; count <= ARRAYSIZE(indexes); count++)
+                {
+                    byte narrow[(37 * 2) + 1];
+                    memset(narrow, 0x11, sizeof(narrow));
+                    compositor.WritePixels(indexes, palette, count, narrow);
+                    Assert::IsTrue(memcmp(expectedNarrow, narrow, count * pixelSize) == 0);
+                    Assert::AreEqual(0x11, (int)narrow[count * pixelSize]);
+                }
+            }
+        }
+    }
+    TEST_METHOD(GPUPixelFormatTest)
+    {
+        std::unique_ptr<GPUTestsMMU> spMMU = std::unique_ptr<GPUTestsMMU>(new GPUTestsMMU(nullptr, 0));
+        std::unique_ptr<GPU> spGPU = std::unique_ptr<GPU>(new GPU(spMMU.get(), nullptr));
+
+        // Tiles, a window, and sprites in front of and behind the BG
+        for (ushort address = 0x8000; address < 0x9800; address++)
+        {
+            Assert::IsTrue(spGPU->WriteByte(address, (byte)((address * 37) ^ (address >> 3))));
+        }
+        for (ushort address = 0x9800; address < 0xA000; address++)
+        {
+            Assert::IsTrue(spGPU->WriteByte(address, (byte)(address * 13)));
+        }
+        for (int obj = 0; obj < OBJCount; obj++)
+        {
+            Assert::IsTrue(spGPU->WriteByte(0xFE00 + (obj * 4), (byte)(16 + (obj * 37) % 150)));
+            Assert::IsTrue(spGPU->WriteByte(0xFE01 + (obj * 4), (byte)((obj * 53) % 168)));
+            Assert::IsTrue(spGPU->WriteByte(0xFE02 + (obj * 4), (byte)(obj * 7)));
+            Assert::IsTrue(spGPU->WriteByte(0xFE03 + (obj * 4), (byte)(obj * 16)));
+        }
+        Assert::IsTrue(spGPU->WriteByte(LCDControl, 0xF3));
+        Assert::IsTrue(spGPU->WriteByte(ScrollX, 3));
+        Assert::IsTrue(spGPU->WriteByte(WindowYPosition, 100));
+        Assert::IsTrue(spGPU->WriteByte(WindowXPositionMinus7, 87));
+        Assert::IsTrue(spGPU->WriteByte(BGPaletteData, 0x1B));
+        Assert::IsTrue(spGPU->WriteByte(ObjectPalette0Data, 0xE4));
+        Assert::IsTrue(spGPU->WriteByte(ObjectPalette1Data, 0x93));
+
+        // Draw the same frame in each pixel format
+        std::unique_ptr<byte[]> spFrames[3];
+        for (int pixelFormat = PixelFormatRGBA8888; pixelFormat <= PixelFormatIndexed; pixelFormat++)
+        {
+            Assert::IsTrue(spGPU->SetPixelFormat(pixelFormat));
+            spGPU->BeginDisplayFrame();
+            for (int line = 0; line < 144; line++)
+            {
+                spGPU->m_LCDControllerYCoordinate = (byte)line;
+                spGPU->SearchOAM();
+                spGPU->RenderScanline();
+            }
+
+            spFrames[pixelFormat] = std::unique_ptr<byte[]>(new byte[160 * 144 * 4]);
+            memcpy(spFrames[pixelFormat].get(), spGPU->m_DisplayPixels, 160 * 144 * Compositor::GetPixelSize(pixelFormat));
+            spGPU->EndDisplayFrame();
+        }
+        Assert::IsFalse(spGPU->SetPixelFormat(3));
+
+        // The RGB565 and indexed pixels are the RGBA8888 ones converted
+        unsigned int shadePalette[4];
+        spGPU->GetShadePalette(shadePalette);
+        for (int pixel = 0; pixel < 160 * 144; pixel++)
+        {
+            unsigned int rgba;
+            ushort rgb565;
+            memcpy(&rgba, spFrames[PixelFormatRGBA8888].get() + (pixel * 4), 4);
+            memcpy(&rgb565, spFrames[PixelFormatRGB565].get() + (pixel * 2), 2);
+            byte shade = spFrames[PixelFormatIndexed][pixel];
+
+            Assert::AreEqual((int)Compositor::MakePixel565(rgba >> 24, (rgba >> 16) & 0xFF, (rgba >> 8) & 0xFF), (int)rgb565);
+            Assert::IsTrue(shade < 4);
+            Assert::IsTrue(shadePalette[shade] == rgba);
+        }
+
         spGPU.reset();
         spMMU.reset();
     }
@@ -77,6 +77,40 @@ public:
         spMBC.reset();
     }
 
+    TEST_METHOD(MBC1BankMemoryTest)
+    {
+        byte rom[0x10000];   //64 KB, 4 banks
+        memset(rom, 0x00, ARRAYSIZE(rom));
+
+        byte ram[0x8000];
+        memset(ram, 0x00, ARRAYSIZE(ram));
+
+        std::unique_ptr<MBC1_MBC> spMBC = std::unique_ptr<MBC1_MBC>(new MBC1_MBC(rom, ram));
+
+        // Default bank, RAM is not enabled
+        Assert::IsTrue(spMBC->GetROMBankMemory() == rom + 0x4000);
+        Assert::IsTrue(spMBC->GetRAMBankMemory() == nullptr);
+
+        // Change ROM to bank 2
+        Assert::IsTrue(spMBC->WriteByte(0x2000, 0x02));
+        Assert::IsTrue(spMBC->GetROMBankMemory() == rom + 0x8000);
+
+        // Enable RAM
+        Assert::IsTrue(spMBC->WriteByte(0x0000, 0x0A));
+        Assert::IsTrue(spMBC->GetRAMBankMemory() == ram);
+
+        // Change RAM to bank 1 and enable RAMBankMode
+        Assert::IsTrue(spMBC->WriteByte(0x4000, 0x01));
+        Assert::IsTrue(spMBC->WriteByte(0x6000, 0x01));
+        Assert::IsTrue(spMBC->GetRAMBankMemory() == ram + 0x2000);
+
+        // Disable RAM
+        Assert::IsTrue(spMBC->WriteByte(0x0000, 0x00));
+        Assert::IsTrue(spMBC->GetRAMBankMemory() == nullptr);
+
+        spMBC.reset();
+    }
+
     TEST_METHOD(MBC2Test)
     {
         byte rom[0x10000];   //64 KB, 4 banks
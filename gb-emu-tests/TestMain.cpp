@@ -2,6 +2,7 @@
 
 #if !WINDOWS
 #include <CPU.hpp>
+#include "APUTests.cpp"
 #include "CPUTests.cpp"
 #include "GPUTests.cpp"
 #include "JoypadTests.cpp"
@@ -22,6 +23,14 @@ int main(int arg, char** argv)
     TEST_CALL(CPUTests, GetLowByte_Test);
     TEST_CALL(CPUTests, GetByteRegister_Test);
     TEST_CALL(CPUTests, GetUShortRegister_Test);
+    TEST_CALL(CPUTests, BlockCache_Test);
+    TEST_CALL(CPUTests, IdleLoopSkipping_Test);
+    TEST_CALL(CPUTests, IdleLoopInterrupt_Test);
+    TEST_CALL(CPUTests, JITInterrupt_Test);
+    TEST_CALL(CPUTests, JITTranslation_Test);
+    TEST_CALL(CPUTests, RunCycles_Test);
+    TEST_CALL(CPUTests, HandleInterrupts_Test);
+    TEST_CALL(CPUTests, LazyFlags_Test);
 
     // TODO: Organize the following...
     // Z80 Instruction Set Tests
@@ -245,6 +254,14 @@ int main(int arg, char** argv)
 
     TEST_SETUP(GPUTests);
     TEST_CALL(GPUTests, GPUCycleTest);
+    TEST_CALL(GPUTests, GPUNextEventTest);
+    TEST_CALL(GPUTests, GPUTileCacheTest);
+    TEST_CALL(GPUTests, GPUOAMSearchTest);
+    TEST_CALL(GPUTests, GPUFrameSkipTest);
+    TEST_CALL(GPUTests, GPUFrameSinkTest);
+    TEST_CALL(GPUTests, TripleBufferTest);
+    TEST_CALL(GPUTests, CompositorKernelsTest);
+    TEST_CALL(GPUTests, GPUPixelFormatTest);
     TEST_CLEANUP();
 
     TEST_SETUP(JoypadTests);
@@ -254,10 +271,22 @@ int main(int arg, char** argv)
     TEST_SETUP(MBCTests);
     TEST_CALL(MBCTests, ROMOnlyTest);
     TEST_CALL(MBCTests, MBC1Test);
+    TEST_CALL(MBCTests, MBC1BankMemoryTest);
     TEST_CALL(MBCTests, MBC2Test);
     TEST_CALL(MBCTests, MBC3Test);
     TEST_CLEANUP();
 
+    TEST_SETUP(APUTests);
+    TEST_CALL(APUTests, BlipBufferStepTest);
+    TEST_CALL(APUTests, SampleRingTest);
+    TEST_CALL(APUTests, APUSquareWaveTest);
+    TEST_CALL(APUTests, APUMixerTest);
+    TEST_CALL(APUTests, APURateAdjustmentTest);
+    TEST_CALL(APUTests, APUCatchUpTest);
+    TEST_CALL(APUTests, APULengthTest);
+    TEST_CALL(APUTests, APUStepSplitTest);
+    TEST_CLEANUP();
+
     std::cout << "----------------------------------" << std::endl;
     std::cout << "Passed: " << passed << "   Failed: " << failed << "   Total: " << passed + failed << std::endl;
 
@@ -1,11 +1,24 @@
 #include "PCH.hpp"
 #include <Emulator.hpp>
 
-// 60 FPS or 16.67ms
-const double TimePerFrame = 1.0 / 60.0;
-
-// The number of CPU cycles per frame
-const unsigned int CyclesPerFrame = 70224;
+// The Game Boy draws a frame every 70224 cycles at 4194304Hz, 59.73 FPS or 16.74ms
+const double TimePerFrame = 70224.0 / 4194304.0;
+
+// Keep 1/20 of a second queued for the audio device, half of what the queue holds
+const int AudioTargetLevel = AudioSampleRate / 20;
+
+/*
+    How the emulation thread keeps to the Game Boy's speed
+    PacingTimer - Each frame has a deadline on the performance counter, and the audio sample rate is
+                  nudged to keep the audio device's queue level
+    PacingAudio - The emulation sleeps while the audio device's queue is above its target level, so
+                  the device's own clock sets the speed. Only used while audio is playing.
+*/
+enum Pacing
+{
+    PacingTimer,
+    PacingAudio
+};
 
 struct SDLWindowDeleter
 {
@@ -67,13 +80,87 @@ std::unique_ptr<SDL_Renderer, SDLRendererDeleter> spRenderer;
 std::unique_ptr<SDL_Texture, SDLTextureDeleter> spTexture;
 Emulator emulator;
 
-// The emulator will call this whenever we hit VBlank
+// The emulator runs on its own thread, the main thread handles the window, input, and rendering
+std::atomic<bool> isEmulating(true);
+std::atomic<byte> joypadInput(JOYPAD_NONE);
+std::atomic<byte> joypadButtons(JOYPAD_NONE);
+Uint32 frameReadyEvent = 0;
+bool isAudioPlaying = false;
+Pacing pacing = PacingTimer;
+
+// The emulator will call this whenever we hit VBlank, on the emulation thread
 void VSyncCallback()
 {
-    Render(spRenderer.get(), spTexture.get(), emulator);
+    // Wake up the main thread, it grabs the latest frame from the emulator
+    SDL_Event event;
+    SDL_zero(event);
+    event.type = frameReadyEvent;
+    SDL_PushEvent(&event);
+}
+
+// Nudges the audio sample rate so the device's queue stays around AudioTargetLevel
+void AdjustAudioRate()
+{
+    // The further the queue is from the target, the harder the push, up to AudioMaxRateAdjustment.
+    // That absorbs the drift between the performance counter and the audio device's clock.
+    int level = static_cast<int>(emulator.GetAudioQueueLevel());
+    int adjustment = ((AudioTargetLevel - level) * AudioMaxRateAdjustment) / AudioTargetLevel;
+    adjustment = std::max(-AudioMaxRateAdjustment, std::min(AudioMaxRateAdjustment, adjustment));
+    emulator.SetAudioRateAdjustment(adjustment);
+}
+
+// Sleeps off what is queued for the audio device beyond AudioTargetLevel
+void WaitForAudio()
+{
+    // When behind, the queue is below the target and the next frames run right away to refill it
+    int level = static_cast<int>(emulator.GetAudioQueueLevel());
+    if (level > AudioTargetLevel)
+    {
+        SDL_Delay(static_cast<Uint32>(((level - AudioTargetLevel) * 1000) / AudioSampleRate));
+    }
+}
+
+void RunEmulator()
+{
+    const Uint64 frequency = SDL_GetPerformanceFrequency();
+    const Uint64 ticksPerFrame = static_cast<Uint64>(TimePerFrame * frequency);
+    Uint64 nextFrame = SDL_GetPerformanceCounter() + ticksPerFrame;
+    while (isEmulating)
+    {
+        emulator.SetInput(joypadInput, joypadButtons);
+
+        // Run up to the next VBlank
+        emulator.RunFrame();
+
+        if (pacing == PacingAudio)
+        {
+            WaitForAudio();
+            continue;
+        }
+
+        if (isAudioPlaying)
+        {
+            AdjustAudioRate();
+        }
+
+        // Sleep through the rest of the frame's time instead of spinning
+        Uint64 now = SDL_GetPerformanceCounter();
+        if (now < nextFrame)
+        {
+            SDL_Delay(static_cast<Uint32>(((nextFrame - now) * 1000) / frequency));
+        }
+        else if ((now - nextFrame) > ticksPerFrame)
+        {
+            // More than a frame behind, don't rush through frames to catch up
+            nextFrame = now;
+        }
+
+        // The next deadline follows from this one, so the milliseconds SDL_Delay drops don't add up
+        nextFrame += ticksPerFrame;
+    }
 }
 
-void ProcessInput(Emulator& emulator)
+void ProcessInput()
 {
     SDL_PumpEvents();
     const Uint8 *keys = SDL_GetKeyboardState(NULL);
@@ -120,7 +207,8 @@ void ProcessInput(Emulator& emulator)
         buttons |= JOYPAD_BUTTONS_SELECT;
     }
 
-    emulator.SetInput(input, buttons);
+    joypadInput = input;
+    joypadButtons = buttons;
 }
 
 int main(int argc, char** argv)
@@ -178,6 +266,9 @@ int main(int argc, char** argv)
         romPath = argv[2];
     }
 
+    // Pace by the audio device unless asked for the timer
+    bool isTimerPacing = (argc > 3) && (strcmp(argv[3], "timer") == 0);
+
     bool isRunning = true;
     std::unique_ptr<SDL_Window, SDLWindowDeleter> spWindow;
 
@@ -217,54 +308,39 @@ int main(int argc, char** argv)
     spTexture = std::unique_ptr<SDL_Texture, SDLTextureDeleter>(
         SDL_CreateTexture(spRenderer.get(), SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_STREAMING, 160, 144));
 
+    frameReadyEvent = SDL_RegisterEvents(1);
+
     if (emulator.Initialize(bootROM.empty() ? nullptr : bootROM.data(), romPath.data()))
     {
         emulator.SetVSyncCallback(&VSyncCallback);
+        isAudioPlaying = emulator.SetAudioOutput(true);
+
+        // Without audio, or when it failed to open, only the timer is left to pace by
+        pacing = (isAudioPlaying && !isTimerPacing) ? PacingAudio : PacingTimer;
+        std::thread emulationThread(RunEmulator);
 
-        unsigned int cycles = 0;
-        Uint64 frameStart = SDL_GetPerformanceCounter();
         while (isRunning)
         {
-            // Poll for window input
-            while (SDL_PollEvent(&event) != 0)
+            // Wait for window input or a new frame
+            if (SDL_WaitEvent(&event) != 0)
             {
                 if (event.type == SDL_QUIT)
                 {
                     isRunning = false;
-                    emulator.SetVSyncCallback(nullptr);
                 }
-            }
-
-            if (!isRunning)
-            {
-                // Exit early if the app is closing
-                continue;
-            }
-
-            ProcessInput(emulator);
-            while (cycles < CyclesPerFrame)
-            {
-                cycles += emulator.Step();
-            }
-
-            cycles -= CyclesPerFrame;
-
-            Uint64 frameEnd = SDL_GetPerformanceCounter();
-            // Loop until we use up the rest of our frame time
-            while (true)
-            {
-                frameEnd = SDL_GetPerformanceCounter();
-                double frameElapsedInSec = (double)(frameEnd - frameStart) / SDL_GetPerformanceFrequency();
-
-                // Break out once we use up our time per frame
-                if (frameElapsedInSec >= TimePerFrame)
+                else if (event.type == frameReadyEvent)
                 {
-                    break;
+                    Render(spRenderer.get(), spTexture.get(), emulator);
                 }
             }
 
-            frameStart = frameEnd;
+            ProcessInput();
         }
+
+        isEmulating = false;
+        emulationThread.join();
+        emulator.SetVSyncCallback(nullptr);
+        emulator.SetAudioOutput(false);
     }
 
     emulator.Stop();
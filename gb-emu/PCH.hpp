@@ -4,6 +4,9 @@
 #include <string>
 #include <memory>
 #include <cstdlib>
+#include <atomic>
+#include <thread>
+#include <algorithm>
 
 #if WINDOWS
     #include <SDL.h>